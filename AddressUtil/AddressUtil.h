@@ -17,6 +17,11 @@ namespace Base58 {
 
 	void toHash160(const std::string &s, unsigned int hash[5]);
 
+	// Decodes a P2PKH address into its hash160 and checksum words without allocating, safe
+	// to call from several threads. Returns false on a bad prefix, an invalid character or a
+	// value too large for 24 bytes. The checksum is not verified
+	bool decodeAddress(const char *s, size_t len, unsigned int hash[5], unsigned int &checksum);
+
 	bool isBase58(std::string s);
 	// Encode arbitrary bytes to Base58
 	std::string encode(const unsigned char *bytes, size_t len);
@@ -33,6 +38,11 @@ namespace Hash {
 	void hashPublicKey(const unsigned int *x, const unsigned int *y, unsigned int *digest);
 	void hashPublicKeyCompressed(const unsigned int *x, const unsigned int *y, unsigned int *digest);
 
+	// Hash count public keys at once using the multi-buffer SHA-256 and RIPEMD-160. x and y hold
+	// count * 8 big-endian words, digest receives count * 5 words.
+	void hashPublicKeyBatch(const unsigned int *x, const unsigned int *y, unsigned int *digest, int count);
+	void hashPublicKeyCompressedBatch(const unsigned int *x, const unsigned int *y, unsigned int *digest, int count);
+
 };
 
 
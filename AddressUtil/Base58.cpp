@@ -4,6 +4,7 @@
 #include "CryptoUtil.h"
 
 #include "AddressUtil.h"
+#include "field.h"
 
 
 static const std::string BASE58_STRING = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
@@ -24,6 +25,24 @@ struct Base58Map {
 
 std::map<char, int> Base58Map::myMap = Base58Map::createBase58Map();
 
+// Digit value of each character, -1 for characters outside the alphabet
+struct Base58Table {
+	signed char digit[256];
+
+	Base58Table()
+	{
+		for(int i = 0; i < 256; i++) {
+			digit[i] = -1;
+		}
+
+		for(int i = 0; i < 58; i++) {
+			digit[(unsigned char)BASE58_STRING[i]] = (signed char)i;
+		}
+	}
+};
+
+static const Base58Table base58Table;
+
 
 
 /**
@@ -56,6 +75,60 @@ void Base58::toHash160(const std::string &s, unsigned int hash[5])
 	}
 }
 
+bool Base58::decodeAddress(const char *s, size_t len, unsigned int hash[5], unsigned int &checksum)
+{
+	// Version byte 0 encodes as a leading '1'
+	if(len < 2 || s[0] != '1') {
+		return false;
+	}
+
+	// 192-bit value in 64-bit little-endian limbs
+	uint64_t v[3] = { 0, 0, 0 };
+
+	size_t i = 1;
+	while(i < len) {
+
+		// Up to 10 digits at a time, 58^10 < 2^59
+		uint64_t chunk = 0;
+		uint64_t mul = 1;
+		for(int j = 0; j < 10 && i < len; j++, i++) {
+			int d = base58Table.digit[(unsigned char)s[i]];
+			if(d < 0) {
+				return false;
+			}
+			chunk = chunk * 58 + d;
+			mul *= 58;
+		}
+
+		// v = v * mul + chunk
+		uint64_t carry = chunk;
+		for(int k = 0; k < 3; k++) {
+			uint64_t hi;
+			uint64_t lo = secp256k1::mul64(v[k], mul, hi);
+
+			lo += carry;
+			hi += (lo < carry);
+
+			v[k] = lo;
+			carry = hi;
+		}
+
+		if(carry != 0) {
+			return false;
+		}
+	}
+
+	// The 24 bytes are the hash160 followed by the checksum, most significant first
+	hash[0] = (unsigned int)(v[2] >> 32);
+	hash[1] = (unsigned int)v[2];
+	hash[2] = (unsigned int)(v[1] >> 32);
+	hash[3] = (unsigned int)v[1];
+	hash[4] = (unsigned int)(v[0] >> 32);
+	checksum = (unsigned int)v[0];
+
+	return true;
+}
+
 bool Base58::isBase58(std::string s)
 {
 	for(unsigned int i = 0; i < s.length(); i++) {
@@ -88,12 +88,12 @@ void Hash::hashPublicKeyCompressed(const secp256k1::ecpoint &p, unsigned int *di
 	hashPublicKeyCompressed(xWords, yWords, digest);
 }
 
-void Hash::hashPublicKey(const unsigned int *x, const unsigned int *y, unsigned int *digest)
-{
-	unsigned int msg[16];
-	unsigned int sha256Digest[8];
+// Number of keys hashed per call to the multi-buffer hash160
+#define HASH_BATCH_SIZE 64
 
-	// 0x04 || x || y
+// Builds the two padded SHA-256 blocks for 0x04 || x || y
+static void publicKeyMessage(const unsigned int *x, const unsigned int *y, unsigned int *msg)
+{
 	msg[15] = (y[7] >> 8) | (y[6] << 24);
 	msg[14] = (y[6] >> 8) | (y[5] << 24);
 	msg[13] = (y[5] >> 8) | (y[4] << 24);
@@ -111,44 +111,20 @@ void Hash::hashPublicKey(const unsigned int *x, const unsigned int *y, unsigned
 	msg[1] = (x[1] >> 8) | (x[0] << 24);
 	msg[0] = (x[0] >> 8) | 0x04000000;
 
-
-	crypto::sha256Init(sha256Digest);
-	crypto::sha256(msg, sha256Digest);
-
-	// Zero out the message
-	for(int i = 0; i < 16; i++) {
-		msg[i] = 0;
-	}
-
-	// Set first byte, padding, and length
-	msg[0] = (y[7] << 24) | 0x00800000;
-	msg[15] = 65 * 8;
-
-	crypto::sha256(msg, sha256Digest);
-
-	for(int i = 0; i < 16; i++) {
+	// Second block: last byte, padding, and length
+	for(int i = 16; i < 32; i++) {
 		msg[i] = 0;
 	}
-
-	// Swap to little-endian
-	for(int i = 0; i < 8; i++) {
-		msg[i] = endian(sha256Digest[i]);
-	}
-
-	// Message length, little endian
-	msg[8] = 0x00000080;
-	msg[14] = 256;
-	msg[15] = 0;
-
-	crypto::ripemd160(msg, digest);
+	msg[16] = (y[7] << 24) | 0x00800000;
+	msg[31] = 65 * 8;
 }
 
-
-
-void Hash::hashPublicKeyCompressed(const unsigned int *x, const unsigned int *y, unsigned int *digest)
+// Builds the padded SHA-256 block for (0x02 | parity) || x
+static void compressedPublicKeyMessage(const unsigned int *x, const unsigned int *y, unsigned int *msg)
 {
-	unsigned int msg[16] = { 0 };
-	unsigned int sha256Digest[8];
+	for(int i = 9; i < 16; i++) {
+		msg[i] = 0;
+	}
 
 	// Compressed public key format
 	msg[15] = 33 * 8;
@@ -167,13 +143,12 @@ void Hash::hashPublicKeyCompressed(const unsigned int *x, const unsigned int *y,
 	} else {
 		msg[0] = (x[0] >> 8) | 0x02000000;
 	}
+}
 
-	crypto::sha256Init(sha256Digest);
-	crypto::sha256(msg, sha256Digest);
-
-	for(int i = 0; i < 16; i++) {
-		msg[i] = 0;
-	}
+// RIPEMD160 of a SHA256 digest
+static void ripemd160OfDigest(const unsigned int *sha256Digest, unsigned int *digest)
+{
+	unsigned int msg[16] = { 0 };
 
 	// Swap to little-endian
 	for(int i = 0; i < 8; i++) {
@@ -188,6 +163,63 @@ void Hash::hashPublicKeyCompressed(const unsigned int *x, const unsigned int *y,
 	crypto::ripemd160(msg, digest);
 }
 
+void Hash::hashPublicKey(const unsigned int *x, const unsigned int *y, unsigned int *digest)
+{
+	unsigned int msg[32];
+	unsigned int sha256Digest[8];
+
+	publicKeyMessage(x, y, msg);
+
+	crypto::sha256Init(sha256Digest);
+	crypto::sha256(msg, sha256Digest);
+	crypto::sha256(msg + 16, sha256Digest);
+
+	ripemd160OfDigest(sha256Digest, digest);
+}
+
+void Hash::hashPublicKeyCompressed(const unsigned int *x, const unsigned int *y, unsigned int *digest)
+{
+	unsigned int msg[16];
+	unsigned int sha256Digest[8];
+
+	compressedPublicKeyMessage(x, y, msg);
+
+	crypto::sha256Init(sha256Digest);
+	crypto::sha256(msg, sha256Digest);
+
+	ripemd160OfDigest(sha256Digest, digest);
+}
+
+void Hash::hashPublicKeyBatch(const unsigned int *x, const unsigned int *y, unsigned int *digest, int count)
+{
+	unsigned int msg[HASH_BATCH_SIZE * 32];
+
+	for(int i = 0; i < count; i += HASH_BATCH_SIZE) {
+		int n = count - i < HASH_BATCH_SIZE ? count - i : HASH_BATCH_SIZE;
+
+		for(int j = 0; j < n; j++) {
+			publicKeyMessage(&x[(i + j) * 8], &y[(i + j) * 8], &msg[j * 32]);
+		}
+
+		crypto::hash160Batch(msg, 2, &digest[i * 5], n);
+	}
+}
+
+void Hash::hashPublicKeyCompressedBatch(const unsigned int *x, const unsigned int *y, unsigned int *digest, int count)
+{
+	unsigned int msg[HASH_BATCH_SIZE * 16];
+
+	for(int i = 0; i < count; i += HASH_BATCH_SIZE) {
+		int n = count - i < HASH_BATCH_SIZE ? count - i : HASH_BATCH_SIZE;
+
+		for(int j = 0; j < n; j++) {
+			compressedPublicKeyMessage(&x[(i + j) * 8], &y[(i + j) * 8], &msg[j * 16]);
+		}
+
+		crypto::hash160Batch(msg, 1, &digest[i * 5], n);
+	}
+}
+
 static void writeUint32BE(unsigned int x, unsigned char *out)
 {
 	out[0] = (unsigned char)((x >> 24) & 0xff);
@@ -1,13 +1,36 @@
 #include <cmath>
+#include <cstring>
 #include "Logger.h"
 #include "util.h"
 #include "CLKeySearchDevice.h"
+#include "CryptoUtil.h"
+#include "BlockedBloomFilter.h"
+#include "BinaryFuseFilter.h"
+#include "LookupPlanner.h"
 
 // Defined in bitcrack_cl.cpp which gets build in the pre-build event
 extern char _bitcrack_cl[];
 
+// Every false positive is written to the results buffer and checked on the host,
+// so the filter is sized for about 1 in 10^7
+static const unsigned int BLOOM_FILTER_BITS_PER_KEY = 64;
+
+// Matches TARGET_LIST, TARGET_BLOOM and TARGET_FUSE in keysearch.cl
+enum {
+    TARGET_LIST = 0,
+    TARGET_BLOOM = 1,
+    TARGET_FUSE = 2
+};
+
+// Words in front of the filter data, matches FILTER_HEADER_WORDS in keysearch.cl
+static const int FILTER_HEADER_WORDS = 16;
+
+// Every work item compares each hash against the whole list
+static const size_t MAX_LIST_TARGETS = 16;
+
 typedef struct {
     int idx;
+    int image;
     bool compressed;
     unsigned int x[8];
     unsigned int y[8];
@@ -15,24 +38,17 @@ typedef struct {
 }CLDeviceResult;
 
 
-static void undoRMD160FinalRound(const unsigned int hIn[5], unsigned int hOut[5])
+CLKeySearchDevice::CLKeySearchDevice(uint64_t device, int threads, int pointsPerThread, int blocks, bool endomorphism, bool centreOut)
 {
-    unsigned int iv[5] = {
-        0x67452301,
-        0xefcdab89,
-        0x98badcfe,
-        0x10325476,
-        0xc3d2e1f0
-    };
-
-    for(int i = 0; i < 5; i++) {
-        hOut[i] = util::endian(hIn[i]) - iv[(i + 1) % 5];
+    // Centre-out work items hold the centre and m points on either side
+    if(centreOut) {
+        _centreHalfWidth = pointsPerThread / 2 > 0 ? pointsPerThread / 2 : 1;
+        pointsPerThread = 2 * _centreHalfWidth + 1;
     }
-}
 
-CLKeySearchDevice::CLKeySearchDevice(uint64_t device, int threads, int pointsPerThread, int blocks)
-{
     _threads = threads;
+    _endomorphism = endomorphism;
+    _centreOut = centreOut;
     _blocks = blocks;
     _points = pointsPerThread * threads * blocks;
     _device = (cl_device_id)device;
@@ -58,6 +74,8 @@ CLKeySearchDevice::CLKeySearchDevice(uint64_t device, int threads, int pointsPer
 
         _stepKernel = new cl::CLKernel(*_clProgram, "keyFinderKernel");
         _stepKernelWithDouble = new cl::CLKernel(*_clProgram, "keyFinderKernelWithDouble");
+        _stepKernelCentreOut = new cl::CLKernel(*_clProgram, "keyFinderKernelCentreOut");
+        _addPointKernel = new cl::CLKernel(*_clProgram, "addPointKernel");
 
         _globalMemSize = _clContext->getGlobalMemorySize();
 
@@ -67,82 +85,59 @@ CLKeySearchDevice::CLKeySearchDevice(uint64_t device, int threads, int pointsPer
     }
 
     _iterations = 0;
+
+    setFalsePositiveRate(0.0);
 }
 
 CLKeySearchDevice::~CLKeySearchDevice()
 {
-    _clContext->free(_x);
-    _clContext->free(_y);
-    _clContext->free(_xTable);
-    _clContext->free(_yTable);
-    _clContext->free(_xInc);
-    _clContext->free(_yInc);
-    _clContext->free(_deviceResults);
-    _clContext->free(_deviceResultsCount);
+    freeBuffers();
 
     delete _stepKernel;
     delete _stepKernelWithDouble;
+    delete _stepKernelCentreOut;
+    delete _addPointKernel;
     delete _initKeysKernel;
     delete _clContext;
 }
 
-uint64_t CLKeySearchDevice::getOptimalBloomFilterMask(double p, size_t n)
+void CLKeySearchDevice::freeBuffers()
 {
-    double m = 3.6 * ceil((n * std::log(p)) / std::log(1 / std::pow(2, std::log(2))));
-
-    unsigned int bits = (unsigned int)std::ceil(std::log(m) / std::log(2));
+    cl_mem *buffers[] = {&_x, &_y, &_chain, &_privateKeys, &_xTable, &_yTable, &_xInc, &_yInc, &_deviceResults, &_deviceResultsCount};
 
-    return ((uint64_t)1 << bits) - 1;
+    for(cl_mem *buf : buffers) {
+        if(*buf != NULL) {
+            _clContext->free(*buf);
+            *buf = NULL;
+        }
+    }
 }
 
-void CLKeySearchDevice::initializeBloomFilter(const std::vector<struct hash160> &targets, uint64_t mask)
+void CLKeySearchDevice::allocateBuffers()
 {
-    size_t sizeInWords = (mask + 1) / 32;
-
-    uint32_t *buf = new uint32_t[sizeInWords];
+    // init() is called again when the search moves to another part of the keyspace
+    freeBuffers();
 
-    for(size_t i = 0; i < sizeInWords; i++) {
-        buf[i] = 0;
-    }
+    if(_useCentreOut) {
+        // One centre per work item, m + 1 chain entries per work item and m + 1 table points
+        size_t workItems = (size_t)_threads * _blocks;
+        size_t tableSize = (size_t)(_centreHalfWidth + 1) * 8 * sizeof(unsigned int);
 
-    for(unsigned int k = 0; k < targets.size(); k++) {
+        _x = _clContext->malloc(workItems * 8 * sizeof(unsigned int));
+        _y = _clContext->malloc(workItems * 8 * sizeof(unsigned int));
+        _chain = _clContext->malloc(workItems * tableSize);
 
-        unsigned int hash[5];
-        unsigned int h5 = 0;
+        _xTable = _clContext->malloc(tableSize, CL_MEM_READ_ONLY);
+        _yTable = _clContext->malloc(tableSize, CL_MEM_READ_ONLY);
 
-        uint64_t idx[5];
+        _xInc = _clContext->malloc(8 * sizeof(unsigned int), CL_MEM_READ_ONLY);
+        _yInc = _clContext->malloc(8 * sizeof(unsigned int), CL_MEM_READ_ONLY);
 
-        undoRMD160FinalRound(targets[k].h, hash);
+        allocateResults();
 
-        for(int i = 0; i < 5; i++) {
-            h5 += hash[i];
-        }
-
-        idx[0] = ((hash[0] << 6) | (h5 & 0x3f)) & mask;
-        idx[1] = ((hash[1] << 6) | ((h5 >> 6) & 0x3f)) & mask;
-        idx[2] = ((hash[2] << 6) | ((h5 >> 12) & 0x3f)) & mask;
-        idx[3] = ((hash[3] << 6) | ((h5 >> 18) & 0x3f)) & mask;
-        idx[4] = ((hash[4] << 6) | ((h5 >> 24) & 0x3f)) & mask;
-
-        for(int i = 0; i < 5; i++) {
-            uint64_t j = idx[i];
-            buf[j / 32] |= 1 << (j % 32);
-        }
+        return;
     }
 
-
-    _targetMemSize = sizeInWords * sizeof(uint32_t);
-
-    _deviceTargetList.mask = mask;
-    _deviceTargetList.ptr = _clContext->malloc(sizeInWords * sizeof(uint32_t));
-    _deviceTargetList.size = targets.size();
-    _clContext->copyHostToDevice(buf, _deviceTargetList.ptr, sizeInWords * sizeof(uint32_t));
-
-    delete[] buf;
-}
-
-void CLKeySearchDevice::allocateBuffers()
-{
     size_t numKeys = (size_t)_points;
     size_t size = numKeys * 8 * sizeof(unsigned int);
 
@@ -168,9 +163,20 @@ void CLKeySearchDevice::allocateBuffers()
     _xInc = _clContext->malloc(8 * sizeof(unsigned int), CL_MEM_READ_ONLY);
     _yInc = _clContext->malloc(8 * sizeof(unsigned int), CL_MEM_READ_ONLY);
 
+    allocateResults();
+}
+
+void CLKeySearchDevice::allocateResults()
+{
+    _resultCapacity = CandidateVerifier::resultCapacity(hashesPerStep(), _falsePositiveRate);
+
     // Buffer for storing results
-    _deviceResults = _clContext->malloc(128 * sizeof(CLDeviceResult));
-    _deviceResultsCount = _clContext->malloc(sizeof(unsigned int));
+    _deviceResults = _clContext->malloc(_resultCapacity * sizeof(CLDeviceResult));
+
+    // The count, then the capacity the kernel stops writing at
+    unsigned int count[2] = {0, _resultCapacity};
+    _deviceResultsCount = _clContext->malloc(sizeof(count));
+    _clContext->copyHostToDevice(count, _deviceResultsCount, sizeof(count));
 }
 
 void CLKeySearchDevice::setIncrementor(secp256k1::ecpoint &p)
@@ -196,9 +202,18 @@ void CLKeySearchDevice::init(const secp256k1::uint256 &start, int compression, c
 
     _compression = compression;
 
+    _iterations = 0;
+
+    _useCentreOut = _centreOut && _start.cmp(secp256k1::uint256((uint64_t)_points) * _stride) > 0;
+
     try {
         allocateBuffers();
 
+        if(_useCentreOut) {
+            generateCentres();
+            return;
+        }
+
         generateStartingPoints();
 
         // Set the incrementor
@@ -211,16 +226,123 @@ void CLKeySearchDevice::init(const secp256k1::uint256 &start, int compression, c
     }
 }
 
+size_t CLKeySearchDevice::getPointsSize()
+{
+    // The centre-out points are rebuilt from the centres at each step
+    return _centreOut ? 0 : (size_t)_points * 8 * sizeof(unsigned int) * 2;
+}
+
+void CLKeySearchDevice::savePoints(void *buf)
+{
+    size_t size = (size_t)_points * 8 * sizeof(unsigned int);
+
+    try {
+        _clContext->copyDeviceToHost(_x, buf, size);
+        _clContext->copyDeviceToHost(_y, (uint8_t *)buf + size, size);
+    } catch(cl::CLException ex) {
+        throw KeySearchException(ex.msg);
+    }
+}
+
+void CLKeySearchDevice::initFromPoints(const secp256k1::uint256 &start, int compression, const secp256k1::uint256 &stride, uint64_t iterations, const void *buf)
+{
+    if(_centreOut) {
+        throw KeySearchException("Saved points are not supported in centre-out mode");
+    }
+
+    if(start.cmp(secp256k1::N) >= 0) {
+        throw KeySearchException("Starting key is out of range");
+    }
+
+    _start = start;
+
+    _stride = stride;
+
+    _compression = compression;
+
+    _iterations = iterations;
+
+    _useCentreOut = false;
+
+    size_t size = (size_t)_points * 8 * sizeof(unsigned int);
+
+    try {
+        allocateBuffers();
+
+        _clContext->copyHostToDevice(buf, _x, size);
+        _clContext->copyHostToDevice((const uint8_t *)buf + size, _y, size);
+
+        secp256k1::ecpoint p = secp256k1::multiplyPoint(secp256k1::uint256((uint64_t)_points) * _stride, secp256k1::G());
+
+        setIncrementor(p);
+    } catch(cl::CLException ex) {
+        throw KeySearchException(ex.msg);
+    }
+}
+
+void CLKeySearchDevice::jump(const secp256k1::uint256 &key)
+{
+    if(key.cmp(secp256k1::N) >= 0) {
+        throw KeySearchException("Key is out of range");
+    }
+
+    secp256k1::uint256 offset = secp256k1::subModN(key, getNextKey());
+
+    try {
+        if(!offset.isZero()) {
+            // The jump is added with the incrementor buffer, which centre-out mode does not use
+            secp256k1::ecpoint p = secp256k1::multiplyPoint(offset, secp256k1::G());
+
+            setIncrementor(p);
+
+            // In centre-out mode only the centres are kept between steps
+            unsigned int count = _useCentreOut ? _threads * _blocks : _points;
+
+            _addPointKernel->set_args(count, _chain, _x, _y, _xInc, _yInc);
+            _addPointKernel->call(_blocks, _threads);
+
+            if(!_useCentreOut) {
+                secp256k1::ecpoint inc = secp256k1::multiplyPoint(secp256k1::uint256((uint64_t)_points) * _stride, secp256k1::G());
+
+                setIncrementor(inc);
+            }
+        }
+    } catch(cl::CLException ex) {
+        throw KeySearchException(ex.msg);
+    }
+
+    _start = key;
+
+    _iterations = 0;
+}
+
 void CLKeySearchDevice::doStep()
 {
     try {
         uint64_t numKeys = (uint64_t)_points;
 
-        if(_iterations < 2 && _start.cmp(numKeys) <= 0) {
+        if(_useCentreOut) {
+            _stepKernelCentreOut->set_args(
+                _centreHalfWidth,
+                _compression,
+                _endomorphism ? 1 : 0,
+                _chain,
+                _x,
+                _y,
+                _xTable,
+                _yTable,
+                _deviceTargetList.ptr,
+                _deviceTargetList.size,
+                _deviceTargetList.filter,
+                _deviceResults,
+                _deviceResultsCount);
+            _stepKernelCentreOut->call(_blocks, _threads);
+        } else if(_iterations < 2 && _start.cmp(numKeys) <= 0) {
 
             _stepKernelWithDouble->set_args(
                 _points,
                 _compression,
+                _endomorphism ? 1 : 0,
                 _chain,
                 _x,
                 _y,
@@ -228,7 +350,7 @@ void CLKeySearchDevice::doStep()
                 _yInc,
                 _deviceTargetList.ptr,
                 _deviceTargetList.size,
-                _deviceTargetList.mask,
+                _deviceTargetList.filter,
                 _deviceResults,
                 _deviceResultsCount);
             _stepKernelWithDouble->call(_blocks, _threads);
@@ -237,6 +359,7 @@ void CLKeySearchDevice::doStep()
             _stepKernel->set_args(
                 _points,
                 _compression,
+                _endomorphism ? 1 : 0,
                 _chain,
                 _x,
                 _y,
@@ -244,7 +367,7 @@ void CLKeySearchDevice::doStep()
                 _yInc,
                 _deviceTargetList.ptr,
                 _deviceTargetList.size,
-                _deviceTargetList.mask,
+                _deviceTargetList.filter,
                 _deviceResults,
                 _deviceResultsCount);
             _stepKernel->call(_blocks, _threads);
@@ -259,62 +382,203 @@ void CLKeySearchDevice::doStep()
     }
 }
 
-void CLKeySearchDevice::setTargetsList()
+void CLKeySearchDevice::buildTargetList(const std::vector<hash160> &hashes, CLTargetBuffer &buffer)
 {
-    size_t count = _targetList.size();
+    buffer.filter = TARGET_LIST;
+    buffer.size = hashes.size();
+    buffer.words.resize(hashes.size() * 5);
 
-    _targets = _clContext->malloc(5 * sizeof(unsigned int) * count);
+    for(size_t i = 0; i < hashes.size(); i++) {
+        memcpy(&buffer.words[i * 5], hashes[i].h, 5 * sizeof(unsigned int));
+    }
+}
 
-    for(size_t i = 0; i < count; i++) {
-        unsigned int h[5];
+void CLKeySearchDevice::buildBloomFilter(const std::vector<hash160> &hashes, CLTargetBuffer &buffer)
+{
+    BlockedBloomFilter filter;
+    filter.init(hashes.size(), _bloomBitsPerKey);
 
-        undoRMD160FinalRound(_targetList[i].h, h);
+    Logger::log(LogLevel::Info, "Allocating bloom filter (" + util::format("%.1f", (double)filter.size() / (double)(1024 * 1024)) + "MB)");
 
-        _clContext->copyHostToDevice(h, _targets, i * 5 * sizeof(unsigned int), 5 * sizeof(unsigned int));
+    for(size_t i = 0; i < hashes.size(); i++) {
+        filter.insert(hashes[i].h);
     }
 
-    _targetMemSize = count * 5 * sizeof(unsigned int);
-    _deviceTargetList.ptr = _targets;
-    _deviceTargetList.size = count;
+    buffer.filter = TARGET_BLOOM;
+    buffer.size = hashes.size();
+    buffer.words.assign(FILTER_HEADER_WORDS, 0);
+    buffer.words[0] = filter.blocks();
+    buffer.words.insert(buffer.words.end(), filter.data(), filter.data() + filter.size() / sizeof(uint32_t));
 }
 
-void CLKeySearchDevice::setBloomFilter()
+bool CLKeySearchDevice::buildFuseFilter(const std::vector<hash160> &hashes, CLTargetBuffer &buffer)
 {
-    uint64_t bloomFilterMask = getOptimalBloomFilterMask(1.0e-9, _targetList.size());
+    std::vector<uint64_t> keys;
+    keys.reserve(hashes.size());
+
+    for(size_t i = 0; i < hashes.size(); i++) {
+        keys.push_back(BinaryFuseFilter::key(hashes[i].h));
+    }
+
+    BinaryFuseFilter filter;
+
+    if(!filter.build(keys, 32)) {
+        Logger::log(LogLevel::Warning, "Unable to build the fuse filter, using a bloom filter");
+        return false;
+    }
 
-    initializeBloomFilter(_targetList, bloomFilterMask);
+    Logger::log(LogLevel::Info, "Allocating fuse filter (" + util::format("%.1f", (double)filter.size() / (double)(1024 * 1024)) + "MB)");
+
+    buffer.filter = TARGET_FUSE;
+    buffer.size = hashes.size();
+    buffer.words.assign(FILTER_HEADER_WORDS, 0);
+    buffer.words[0] = (uint32_t)filter.seed();
+    buffer.words[1] = (uint32_t)(filter.seed() >> 32);
+    buffer.words[2] = filter.segmentLength();
+    buffer.words[3] = filter.segmentCountLength();
+
+    const uint32_t *data = (const uint32_t *)filter.data();
+    buffer.words.insert(buffer.words.end(), data, data + filter.size() / sizeof(uint32_t));
+
+    return true;
 }
 
-void CLKeySearchDevice::setTargetsInternal()
+void CLKeySearchDevice::buildTargets(const TargetSet &targets, CLTargetBuffer &buffer)
+{
+    LookupConstraints constraints;
+    constraints.strategies = (1 << LookupStrategy::LIST) | (1 << LookupStrategy::BLOOM) | (1 << LookupStrategy::FUSE32);
+    constraints.maxListSize = MAX_LIST_TARGETS;
+    constraints.memoryBudget = _globalMemSize > _pointsMemSize ? _globalMemSize - _pointsMemSize : 0;
+    constraints.bloomBitsPerKey = _bloomBitsPerKey;
+    constraints.bloomHashes = BlockedBloomFilter::HASHES;
+    constraints.bloomBlocked = true;
+    constraints.benchmark = false;
+
+    LookupPlan plan = LookupPlanner::plan(targets, constraints, _targetFilter);
+    LookupPlanner::log(plan, targets.size());
+
+    // The kernel compares hashes before the final RIPEMD160 round
+    std::vector<hash160> hashes;
+    targets.getTargets(hashes);
+
+    for(size_t i = 0; i < hashes.size(); i++) {
+        unsigned int h[5];
+
+        crypto::undoRMD160FinalRound(hashes[i].h, h);
+
+        memcpy(hashes[i].h, h, sizeof(h));
+    }
+
+    if(plan.strategy == LookupStrategy::LIST) {
+        buildTargetList(hashes, buffer);
+    } else if(plan.strategy != LookupStrategy::FUSE32 || !buildFuseFilter(hashes, buffer)) {
+        buildBloomFilter(hashes, buffer);
+    }
+}
+
+void CLKeySearchDevice::uploadTargets(const CLTargetBuffer &buffer)
 {
     // Clean up existing list
     if(_deviceTargetList.ptr != NULL) {
         _clContext->free(_deviceTargetList.ptr);
+        _deviceTargetList.ptr = NULL;
     }
 
-    if(_targetList.size() < 16) {
-        setTargetsList();
-    } else {
-        setBloomFilter();
+    size_t bytes = buffer.words.size() * sizeof(uint32_t);
+
+    // OpenCL buffers cannot be empty
+    _deviceTargetList.ptr = _clContext->malloc(bytes > 0 ? bytes : sizeof(uint32_t));
+
+    if(bytes > 0) {
+        _clContext->copyHostToDevice(buffer.words.data(), _deviceTargetList.ptr, bytes);
     }
+
+    _deviceTargetList.filter = buffer.filter;
+    _deviceTargetList.size = buffer.size;
+    _targetMemSize = bytes;
 }
 
-void CLKeySearchDevice::setTargets(const std::set<KeySearchTarget> &targets)
+void CLKeySearchDevice::setTargets(const TargetSet &targets)
 {
     try {
-        _targetList.clear();
+        _targetSet = targets;
 
-        for(std::set<KeySearchTarget>::iterator i = targets.begin(); i != targets.end(); ++i) {
-            hash160 h(i->value);
-            _targetList.push_back(h);
-        }
+        CLTargetBuffer buffer;
+        buildTargets(_targetSet, buffer);
 
-        setTargetsInternal();
+        uploadTargets(buffer);
     } catch(cl::CLException ex) {
         throw KeySearchException(ex.msg);
     }
 }
 
+void CLKeySearchDevice::prepareTargets(const TargetSet &targets)
+{
+    // Only host memory is touched here, the kernels keep running
+    CLTargetBuffer buffer;
+    buildTargets(targets, buffer);
+
+    std::lock_guard<std::mutex> lock(_pendingMutex);
+    _pendingTargetSet = targets;
+    _pendingTargets = std::move(buffer);
+    _targetsPending = true;
+}
+
+bool CLKeySearchDevice::swapTargets()
+{
+    std::lock_guard<std::mutex> lock(_pendingMutex);
+
+    if(!_targetsPending) {
+        return false;
+    }
+
+    try {
+        uploadTargets(_pendingTargets);
+    } catch(cl::CLException ex) {
+        throw KeySearchException(ex.msg);
+    }
+
+    _targetSet = _pendingTargetSet;
+    _pendingTargets = CLTargetBuffer();
+    _pendingTargetSet = TargetSet();
+    _targetsPending = false;
+
+    return true;
+}
+
+void CLKeySearchDevice::setFalsePositiveRate(double rate)
+{
+    if(rate > 0.0) {
+        _bloomBitsPerKey = LookupPlanner::bloomBitsPerKey(rate, BlockedBloomFilter::HASHES, true);
+    } else {
+        _bloomBitsPerKey = BLOOM_FILTER_BITS_PER_KEY;
+    }
+
+    _falsePositiveRate = LookupPlanner::bloomFalsePositiveRate(_bloomBitsPerKey, BlockedBloomFilter::HASHES, true);
+}
+
+void CLKeySearchDevice::setVerifyThreads(int threads)
+{
+    _verifier.setThreads(threads);
+}
+
+KeySearchVerifierStats CLKeySearchDevice::getVerifierStats()
+{
+    return _verifier.getStats();
+}
+
+void CLKeySearchDevice::setTargetFilter(int filter)
+{
+    // The kernel only reads 32-bit fingerprints. With fewer bits most steps would
+    // report more false positives than the results buffer holds
+    if(filter == TargetFilterType::FUSE8 || filter == TargetFilterType::FUSE16) {
+        Logger::log(LogLevel::Warning, "OpenCL devices use 32-bit fuse filter fingerprints");
+        filter = TargetFilterType::FUSE32;
+    }
+
+    _targetFilter = filter;
+}
+
 size_t CLKeySearchDevice::getResults(std::vector<KeySearchResult> &results)
 {
     size_t count = _results.size();
@@ -328,7 +592,12 @@ size_t CLKeySearchDevice::getResults(std::vector<KeySearchResult> &results)
 
 uint64_t CLKeySearchDevice::keysPerStep()
 {
-    return (uint64_t)_points;
+    return (uint64_t)_points * (_endomorphism ? secp256k1::ENDOMORPHISM_IMAGES : 1);
+}
+
+uint64_t CLKeySearchDevice::hashesPerStep()
+{
+    return keysPerStep() * (_compression == PointCompressionType::BOTH ? 2 : 1);
 }
 
 std::string CLKeySearchDevice::getDeviceName()
@@ -352,77 +621,50 @@ void CLKeySearchDevice::splatBigInt(unsigned int *ptr, int idx, secp256k1::uint2
 
 }
 
-bool CLKeySearchDevice::isTargetInList(const unsigned int hash[5])
-{
-    size_t count = _targetList.size();
-
-    while(count) {
-        if(memcmp(hash, _targetList[count - 1].h, 20) == 0) {
-            return true;
-        }
-        count--;
-    }
-
-    return false;
-}
-
-void CLKeySearchDevice::removeTargetFromList(const unsigned int hash[5])
-{
-    size_t count = _targetList.size();
-
-    while(count) {
-        if(memcmp(hash, _targetList[count - 1].h, 20) == 0) {
-            _targetList.erase(_targetList.begin() + count - 1);
-            return;
-        }
-        count--;
-    }
-}
-
-
 void CLKeySearchDevice::getResultsInternal()
 {
+    _verifier.addHashes(hashesPerStep());
+
     unsigned int numResults = 0;
 
     _clContext->copyDeviceToHost(_deviceResultsCount, &numResults, sizeof(unsigned int));
 
-    if(numResults > 0) {
-        CLDeviceResult *ptr = new CLDeviceResult[numResults];
-
-        _clContext->copyDeviceToHost(_deviceResults, ptr, sizeof(CLDeviceResult) * numResults);
-
-        unsigned int actualCount = 0;
-
-        for(unsigned int i = 0; i < numResults; i++) {
-
-            // might be false-positive
-            if(!isTargetInList(ptr[i].digest)) {
-                continue;
-            }
-            actualCount++;
+    if(numResults == 0) {
+        return;
+    }
 
-            KeySearchResult minerResult;
+    if(numResults > _resultCapacity) {
+        Logger::log(LogLevel::Warning, util::formatThousands(numResults - _resultCapacity) + " filter hits did not fit in the results list and were not checked. Lower the filter false positive rate");
+        numResults = _resultCapacity;
+    }
 
-            // Calculate the private key based on the number of iterations and the current thread
-            secp256k1::uint256 offset = secp256k1::uint256((uint64_t)_points * _iterations) + secp256k1::uint256(ptr[i].idx) * _stride;
-            secp256k1::uint256 privateKey = secp256k1::addModN(_start, offset);
+    std::vector<CLDeviceResult> deviceResults(numResults);
 
-            minerResult.privateKey = privateKey;
-            minerResult.compressed = ptr[i].compressed;
+    _clContext->copyDeviceToHost(_deviceResults, deviceResults.data(), sizeof(CLDeviceResult) * numResults);
 
-            memcpy(minerResult.hash, ptr[i].digest, 20);
+    // Reset device counter
+    unsigned int zero = 0;
+    _clContext->copyHostToDevice(&zero, _deviceResultsCount, sizeof(unsigned int));
 
-            minerResult.publicKey = secp256k1::ecpoint(secp256k1::uint256(ptr[i].x, secp256k1::uint256::BigEndian), secp256k1::uint256(ptr[i].y, secp256k1::uint256::BigEndian));
+    std::vector<KeySearchCandidate> candidates(numResults);
 
-            removeTargetFromList(ptr[i].digest);
+    for(unsigned int i = 0; i < numResults; i++) {
+        const CLDeviceResult &r = deviceResults[i];
+        KeySearchCandidate &c = candidates[i];
 
-            _results.push_back(minerResult);
-        }
+        // Calculate the private key based on the number of iterations and the current thread
+        secp256k1::uint256 offset = (secp256k1::uint256((uint64_t)_points) * _iterations + secp256k1::uint256(r.idx)) * _stride;
+        secp256k1::uint256 privateKey = secp256k1::addModN(_start, offset);
 
-        // Reset device counter
-        numResults = 0;
-        _clContext->copyHostToDevice(&numResults, _deviceResultsCount, sizeof(unsigned int));
+        // The kernel reports which image of the point matched, the public key is already that image
+        c.privateKey = secp256k1::endomorphismKey(privateKey, r.image);
+        c.publicKey = secp256k1::ecpoint(secp256k1::uint256(r.x, secp256k1::uint256::BigEndian), secp256k1::uint256(r.y, secp256k1::uint256::BigEndian));
+        c.compressed = r.compressed;
+        memcpy(c.digest, r.digest, sizeof(c.digest));
     }
+
+    // Most candidates are false positives
+    _verifier.verify(candidates, _targetSet, _results);
 }
 
 void CLKeySearchDevice::selfTest()
@@ -573,9 +815,54 @@ void CLKeySearchDevice::generateStartingPoints()
 }
 
 
-secp256k1::uint256 CLKeySearchDevice::getNextKey()
+/**
+ * Centre-out mode: work item i is centred on key start + (i * (2m + 1) + m) * stride and the
+ * table holds (j + 1) * stride * G for j < m, followed by the incrementor
+ */
+void CLKeySearchDevice::generateCentres()
 {
-    uint64_t totalPoints = (uint64_t)_points * _threads * _blocks;
+    uint64_t workItems = (uint64_t)_threads * _blocks;
+    int m = _centreHalfWidth;
+
+    _pointsMemSize = workItems * (m + 3) * 8 * sizeof(unsigned int);
+
+    Logger::log(LogLevel::Info, "Generating " + util::formatThousands(workItems) + " centre points");
+
+    std::vector<secp256k1::uint256> exponents;
+    std::vector<secp256k1::ecpoint> points;
+
+    for(uint64_t i = 0; i < workItems; i++) {
+        exponents.push_back(_start + secp256k1::uint256(i * (2 * m + 1) + m) * _stride);
+    }
+
+    for(int j = 0; j < m; j++) {
+        exponents.push_back(secp256k1::uint256(j + 1) * _stride);
+    }
+
+    exponents.push_back(secp256k1::uint256((uint64_t)_points) * _stride);
+
+    secp256k1::generateKeyPairsBulk(secp256k1::G(), exponents, points);
+
+    std::vector<unsigned int> xBuf(exponents.size() * 8);
+    std::vector<unsigned int> yBuf(exponents.size() * 8);
+
+    for(size_t i = 0; i < points.size(); i++) {
+        points[i].x.exportWords(&xBuf[i * 8], 8, secp256k1::uint256::BigEndian);
+        points[i].y.exportWords(&yBuf[i * 8], 8, secp256k1::uint256::BigEndian);
+    }
+
+    size_t centreBytes = workItems * 8 * sizeof(unsigned int);
+    size_t tableBytes = (size_t)(m + 1) * 8 * sizeof(unsigned int);
 
-    return _start + secp256k1::uint256(totalPoints) * _iterations * _stride;
+    _clContext->copyHostToDevice(&xBuf[0], _x, centreBytes);
+    _clContext->copyHostToDevice(&yBuf[0], _y, centreBytes);
+    _clContext->copyHostToDevice(&xBuf[workItems * 8], _xTable, tableBytes);
+    _clContext->copyHostToDevice(&yBuf[workItems * 8], _yTable, tableBytes);
+
+    Logger::log(LogLevel::Info, "Done");
+}
+
+secp256k1::uint256 CLKeySearchDevice::getNextKey()
+{
+    return _start + secp256k1::uint256((uint64_t)_points) * _iterations * _stride;
 }
\ No newline at end of file
@@ -1,16 +1,27 @@
 #ifndef _CL_KEYSEARCH_DEVICE_H
 #define _CL_KEYSEARCH_DEVICE_H
 
+#include <mutex>
 #include "KeySearchDevice.h"
+#include "CandidateVerifier.h"
 #include "clContext.h"
 
 typedef struct CLTargetList_
 {
-    cl_ulong mask = 0;
+    // TARGET_LIST, TARGET_BLOOM or TARGET_FUSE in keysearch.cl
+    cl_ulong filter = 0;
     cl_ulong size = 0;
     cl_mem ptr = 0;
 }CLTargetList;
 
+// Host copy of a target list or filter in the layout the kernel reads
+typedef struct CLTargetBuffer_
+{
+    cl_ulong filter = 0;
+    cl_ulong size = 0;
+    std::vector<uint32_t> words;
+}CLTargetBuffer;
+
 class CLKeySearchDevice : public KeySearchDevice {
 
 private:
@@ -19,6 +30,8 @@ private:
     cl::CLKernel *_initKeysKernel = NULL;
     cl::CLKernel *_stepKernel = NULL;
     cl::CLKernel *_stepKernelWithDouble = NULL;
+    cl::CLKernel *_stepKernelCentreOut = NULL;
+    cl::CLKernel *_addPointKernel = NULL;
 
     uint64_t _globalMemSize = 0;
     uint64_t _pointsMemSize = 0;
@@ -28,7 +41,7 @@ private:
 
     secp256k1::uint256 _start;
     
-    std::vector<hash160> _targetList;
+    TargetSet _targetSet;
 
     std::vector<KeySearchResult> _results;
 
@@ -42,6 +55,19 @@ private:
 
     int _compression = PointCompressionType::COMPRESSED;
 
+    // Also check the endomorphism and negation images of every point
+    bool _endomorphism = false;
+
+    // Each work item keeps one centre point and checks it +/- a table of multiples of G
+    bool _centreOut = false;
+
+    // Centre-out stepping in use for the current range. Small starting keys use the
+    // default kernels, which handle points that meet the incrementor.
+    bool _useCentreOut = false;
+
+    // Table points on either side of each centre
+    int _centreHalfWidth = 0;
+
     uint64_t _iterations = 0;
 
     secp256k1::uint256 _stride = 1;
@@ -69,16 +95,18 @@ private:
 
     cl_mem _deviceResultsCount = NULL;
 
-    cl_mem _targets = NULL;
-
     void generateStartingPoints();
 
+    void generateCentres();
+
     void setIncrementor(secp256k1::ecpoint &p);
 
     void splatBigInt(secp256k1::uint256 &k, unsigned int *ptr);
 
     void allocateBuffers();
 
+    void freeBuffers();
+
     void initializeBasePoints();
 
     int getIndex(int block, int thread, int idx);
@@ -91,25 +119,43 @@ private:
 
     bool _useBloomFilter = false;
 
-    void setTargetsInternal();
-    void setTargetsList();
-    void setBloomFilter();
+    // Build the kernel's target buffer in host memory only. The list and filter builders
+    // take hashes before the final RIPEMD160 round
+    void buildTargets(const TargetSet &targets, CLTargetBuffer &buffer);
+    void buildTargetList(const std::vector<hash160> &hashes, CLTargetBuffer &buffer);
+    void buildBloomFilter(const std::vector<hash160> &hashes, CLTargetBuffer &buffer);
+    bool buildFuseFilter(const std::vector<hash160> &hashes, CLTargetBuffer &buffer);
+    void uploadTargets(const CLTargetBuffer &buffer);
+
+    int _targetFilter = TargetFilterType::AUTO;
+
+    // Built by prepareTargets() on another thread, uploaded by swapTargets()
+    TargetSet _pendingTargetSet;
+    CLTargetBuffer _pendingTargets;
+    bool _targetsPending = false;
+    std::mutex _pendingMutex;
 
     void getResultsInternal();
 
-    bool isTargetInList(const unsigned int hash[5]);
+    void allocateResults();
 
-    void removeTargetFromList(const unsigned int hash[5]);
+    uint64_t hashesPerStep();
 
-    uint32_t getPrivateKeyOffset(int thread, int block, int idx);
+    // Checks the filter hits against the targets on the host
+    CandidateVerifier _verifier;
 
-    void initializeBloomFilter(const std::vector<struct hash160> &targets, uint64_t mask);
+    // False positive rate of the bloom filter, and the bits per key that give it
+    double _falsePositiveRate = 0.0;
+    unsigned int _bloomBitsPerKey = 0;
 
-    uint64_t getOptimalBloomFilterMask(double p, size_t n);
+    // Results the kernel can store each step
+    unsigned int _resultCapacity = 0;
+
+    uint32_t getPrivateKeyOffset(int thread, int block, int idx);
 
 public:
 
-    CLKeySearchDevice(uint64_t device, int threads, int pointsPerThread, int blocks = 0);
+    CLKeySearchDevice(uint64_t device, int threads, int pointsPerThread, int blocks = 0, bool endomorphism = false, bool centreOut = false);
     ~CLKeySearchDevice();
 
 
@@ -119,8 +165,28 @@ public:
     // Perform one iteration
     virtual void doStep();
 
+    virtual size_t getPointsSize();
+
+    virtual void savePoints(void *buf);
+
+    virtual void initFromPoints(const secp256k1::uint256 &start, int compression, const secp256k1::uint256 &stride, uint64_t iterations, const void *buf);
+
+    virtual void jump(const secp256k1::uint256 &key);
+
     // Tell the device which addresses to search for
-    virtual void setTargets(const std::set<KeySearchTarget> &targets);
+    virtual void setTargets(const TargetSet &targets);
+
+    virtual void prepareTargets(const TargetSet &targets);
+
+    virtual bool swapTargets();
+
+    virtual void setTargetFilter(int filter);
+
+    virtual void setFalsePositiveRate(double rate);
+
+    virtual void setVerifyThreads(int threads);
+
+    virtual KeySearchVerifierStats getVerifierStats();
 
     // Get the private keys that have been found so far
     virtual size_t getResults(std::vector<KeySearchResult> &results);
@@ -9,6 +9,7 @@ unsigned int endian(unsigned int x)
 
 typedef struct {
     int idx;
+    int image;
     bool compressed;
     unsigned int x[8];
     unsigned int y[8];
@@ -36,40 +37,75 @@ bool isInList(unsigned int hash[5], __global unsigned int *targetList, size_t nu
     return found;
 }
 
-bool isInBloomFilter(unsigned int hash[5], __global unsigned int *targetList, ulong mask)
+// How the kernels test a hash, matches the host side CLTargetList
+#define TARGET_LIST 0
+#define TARGET_BLOOM 1
+#define TARGET_FUSE 2
+
+// Words before the filter data. Keeps the Bloom filter blocks on 64-byte boundaries
+#define FILTER_HEADER_WORDS 16
+
+/**
+ Blocked Bloom filter, the layout is described in BlockedBloomFilter.h. All
+ 12 bits for a hash are in the same 16-word block, selected by h[0].
+ Header: number of blocks
+ */
+bool isInBloomFilter(unsigned int hash[5], __global unsigned int *filter)
 {
-    bool foundMatch = true;
+    unsigned int blocks = filter[0];
+    __global unsigned int *block = filter + FILTER_HEADER_WORDS + 16 * (size_t)mul_hi(hash[0], blocks);
 
-    unsigned int h5 = 0;
+    unsigned int missing = 0;
 
-    for(int i = 0; i < 5; i++) {
-        h5 += hash[i];
+    for(int i = 0; i < 12; i++) {
+        unsigned int bit = (hash[1 + i / 3] >> (9 * (i % 3))) & 0x1ff;
+
+        missing |= ~block[bit / 32] & (1u << (bit % 32));
     }
 
-    uint64_t idx[5];
+    return missing == 0;
+}
 
-    idx[0] = ((hash[0] << 6) | (h5 & 0x3f)) & mask;
-    idx[1] = ((hash[1] << 6) | ((h5 >> 6) & 0x3f)) & mask;
-    idx[2] = ((hash[2] << 6) | ((h5 >> 12) & 0x3f)) & mask;
-    idx[3] = ((hash[3] << 6) | ((h5 >> 18) & 0x3f)) & mask;
-    idx[4] = ((hash[4] << 6) | ((h5 >> 24) & 0x3f)) & mask;
+ulong fuseMix(ulong x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdUL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53UL;
+    x ^= x >> 33;
 
-    for(int i = 0; i < 5; i++) {
-        unsigned int j = idx[i];
-        unsigned int f = targetList[j / 32];
+    return x;
+}
 
-        if((f & (0x01 << (j % 32))) == 0) {
-            foundMatch = false;
-        }
-    }
+/**
+ Binary fuse filter with 32-bit fingerprints, the lookup is described in
+ BinaryFuseFilter.h.
+ Header: seed (low word first), segment length, segment count * segment length
+ */
+bool isInFuseFilter(unsigned int hash[5], __global unsigned int *filter)
+{
+    ulong seed = ((ulong)filter[1] << 32) | filter[0];
+    unsigned int segmentLength = filter[2];
+    unsigned int segmentCountLength = filter[3];
+    __global unsigned int *fingerprints = filter + FILTER_HEADER_WORDS;
+
+    ulong x = fuseMix(((((ulong)hash[0]) << 32) | hash[1]) + seed);
 
-    return foundMatch;
+    unsigned int h0 = (unsigned int)mul_hi(x, (ulong)segmentCountLength);
+    unsigned int h1 = (h0 + segmentLength) ^ ((unsigned int)(x >> 18) & (segmentLength - 1));
+    unsigned int h2 = (h0 + 2 * segmentLength) ^ ((unsigned int)x & (segmentLength - 1));
+
+    unsigned int f = (unsigned int)(x ^ (x >> 32));
+
+    return (f ^ fingerprints[h0] ^ fingerprints[h1] ^ fingerprints[h2]) == 0;
 }
 
-bool checkHash(unsigned int hash[5], __global unsigned int *targetList, size_t numTargets, ulong mask)
+bool checkHash(unsigned int hash[5], __global unsigned int *targetList, size_t numTargets, ulong targetFilter)
 {
-    if(numTargets > 16) {
-        return isInBloomFilter(hash, targetList, mask);
+    if(targetFilter == TARGET_BLOOM) {
+        return isInBloomFilter(hash, targetList);
+    } else if(targetFilter == TARGET_FUSE) {
+        return isInFuseFilter(hash, targetList);
     } else {
         return isInList(hash, targetList, numTargets);
     }
@@ -192,18 +228,23 @@ void hashPublicKeyCompressed(uint256_t x, unsigned int yParity, unsigned int* di
 
 }
 
+// numResults[1] is the size of the results buffer. The count keeps going past it so the
+// host can tell the buffer overflowed
 void atomicListAdd(__global CLDeviceResult *results, __global unsigned int *numResults, CLDeviceResult *r)
 {
     unsigned int count = atomic_add(numResults, 1);
 
-    results[count] = *r;
+    if(count < numResults[1]) {
+        results[count] = *r;
+    }
 }
 
-void setResultFound(int idx, bool compressed, uint256_t x, uint256_t y, unsigned int digest[5], __global CLDeviceResult* results, __global unsigned int* numResults)
+void setResultFound(int idx, int image, bool compressed, uint256_t x, uint256_t y, unsigned int digest[5], __global CLDeviceResult* results, __global unsigned int* numResults)
 {
     CLDeviceResult r;
 
     r.idx = idx;
+    r.image = image;
     r.compressed = compressed;
 
     for(int i = 0; i < 8; i++) {
@@ -216,9 +257,101 @@ void setResultFound(int idx, bool compressed, uint256_t x, uint256_t y, unsigned
     atomicListAdd(results, numResults, &r);
 }
 
+/**
+ * Checks the other images of the point under the endomorphism and negation.
+ * Image i is (beta^(i / 2) * x, y) with y negated when i is odd, the public key of
+ * lambda^(i / 2) * k negated when i is odd. The host recovers the key from the image.
+ */
+void checkEndomorphismImages(
+    int idx,
+    int compression,
+    uint256_t x,
+    uint256_t y,
+    __global unsigned int *targetList,
+    size_t numTargets,
+    ulong targetFilter,
+    __global CLDeviceResult *results,
+    __global unsigned int *numResults)
+{
+    uint256_t beta;
+    uint256_t beta2;
+
+    for(int i = 0; i < 8; i++) {
+        beta.v[i] = _BETA[i];
+        beta2.v[i] = _BETA2[i];
+    }
+
+    uint256_t negY = negModP256k(y);
+
+    for(int image = 1; image < 6; image++) {
+        uint256_t ix = x;
+        uint256_t iy = (image & 1) ? negY : y;
+
+        if(image / 2 == 1) {
+            ix = mulModP256k(x, beta);
+        } else if(image / 2 == 2) {
+            ix = mulModP256k(x, beta2);
+        }
+
+        unsigned int digest[5];
+
+        if((compression == UNCOMPRESSED) || (compression == BOTH)) {
+            hashPublicKey(ix, iy, digest);
+
+            if(checkHash(digest, targetList, numTargets, targetFilter)) {
+                setResultFound(idx, image, false, ix, iy, digest, results, numResults);
+            }
+        }
+
+        if((compression == COMPRESSED) || (compression == BOTH)) {
+            hashPublicKeyCompressed(ix, iy.v[7], digest);
+
+            if(checkHash(digest, targetList, numTargets, targetFilter)) {
+                setResultFound(idx, image, true, ix, iy, digest, results, numResults);
+            }
+        }
+    }
+}
+
+void checkPublicKey(
+    int idx,
+    int compression,
+    int endomorphism,
+    uint256_t x,
+    uint256_t y,
+    __global unsigned int *targetList,
+    size_t numTargets,
+    ulong targetFilter,
+    __global CLDeviceResult *results,
+    __global unsigned int *numResults)
+{
+    unsigned int digest[5];
+
+    if((compression == UNCOMPRESSED) || (compression == BOTH)) {
+        hashPublicKey(x, y, digest);
+
+        if(checkHash(digest, targetList, numTargets, targetFilter)) {
+            setResultFound(idx, 0, false, x, y, digest, results, numResults);
+        }
+    }
+
+    if((compression == COMPRESSED) || (compression == BOTH)) {
+        hashPublicKeyCompressed(x, y.v[7], digest);
+
+        if(checkHash(digest, targetList, numTargets, targetFilter)) {
+            setResultFound(idx, 0, true, x, y, digest, results, numResults);
+        }
+    }
+
+    if(endomorphism) {
+        checkEndomorphismImages(idx, compression, x, y, targetList, numTargets, targetFilter, results, numResults);
+    }
+}
+
 void doIteration(
     size_t totalPoints,
     int compression,
+    int endomorphism,
     __global uint256_t* chain,
     __global uint256_t* xPtr,
     __global uint256_t* yPtr,
@@ -226,7 +359,7 @@ void doIteration(
     __global uint256_t* incYPtr,
     __global unsigned int *targetList,
     size_t numTargets,
-    ulong mask,
+    ulong targetFilter,
     __global CLDeviceResult *results,
     __global unsigned int *numResults)
 {
@@ -253,8 +386,8 @@ void doIteration(
 
             hashPublicKey(x, y, digest);
 
-            if(checkHash(digest, targetList, numTargets, mask)) {
-                setResultFound(i, false, x, y, digest, results, numResults);
+            if(checkHash(digest, targetList, numTargets, targetFilter)) {
+                setResultFound(i, 0, false, x, y, digest, results, numResults);
             }
         }
 
@@ -262,12 +395,16 @@ void doIteration(
 
             hashPublicKeyCompressed(x, readLSW256k(yPtr, i), digest);
 
-            if(checkHash(digest, targetList, numTargets, mask)) {
+            if(checkHash(digest, targetList, numTargets, targetFilter)) {
                 uint256_t y = yPtr[i];
-                setResultFound(i, true, x, y, digest, results, numResults);
+                setResultFound(i, 0, true, x, y, digest, results, numResults);
             }
         }
 
+        if(endomorphism) {
+            checkEndomorphismImages(i, compression, x, yPtr[i], targetList, numTargets, targetFilter, results, numResults);
+        }
+
         beginBatchAdd256k(incX, x, chain, i, batchIdx, &inverse);
         batchIdx++;
     }
@@ -292,6 +429,7 @@ void doIteration(
 void doIterationWithDouble(
     size_t totalPoints,
     int compression,
+    int endomorphism,
     __global uint256_t* chain,
     __global uint256_t* xPtr,
     __global uint256_t* yPtr,
@@ -299,7 +437,7 @@ void doIterationWithDouble(
     __global uint256_t* incYPtr,
     __global unsigned int* targetList,
     size_t numTargets,
-    ulong mask,
+    ulong targetFilter,
     __global CLDeviceResult *results,
     __global unsigned int *numResults)
 {
@@ -326,8 +464,8 @@ void doIterationWithDouble(
             uint256_t y = yPtr[i];
             hashPublicKey(x, y, digest);
 
-            if(checkHash(digest, targetList, numTargets, mask)) {
-                setResultFound(i, false, x, y, digest, results, numResults);
+            if(checkHash(digest, targetList, numTargets, targetFilter)) {
+                setResultFound(i, 0, false, x, y, digest, results, numResults);
             }
         }
 
@@ -336,13 +474,17 @@ void doIterationWithDouble(
 
             hashPublicKeyCompressed(x, readLSW256k(yPtr, i), digest);
 
-            if(checkHash(digest, targetList, numTargets, mask)) {
+            if(checkHash(digest, targetList, numTargets, targetFilter)) {
 
                 uint256_t y = yPtr[i];
-                setResultFound(i, true, x, y, digest, results, numResults);
+                setResultFound(i, 0, true, x, y, digest, results, numResults);
             }
         }
 
+        if(endomorphism) {
+            checkEndomorphismImages(i, compression, x, yPtr[i], targetList, numTargets, targetFilter, results, numResults);
+        }
+
         beginBatchAddWithDouble256k(incX, incY, xPtr, chain, i, batchIdx, &inverse);
         batchIdx++;
     }
@@ -368,6 +510,7 @@ void doIterationWithDouble(
 __kernel void keyFinderKernel(
     unsigned int totalPoints,
     int compression,
+    int endomorphism,
     __global uint256_t* chain,
     __global uint256_t* xPtr,
     __global uint256_t* yPtr,
@@ -375,16 +518,17 @@ __kernel void keyFinderKernel(
     __global uint256_t* incYPtr,
     __global unsigned int* targetList,
     ulong numTargets,
-    ulong mask,
+    ulong targetFilter,
     __global CLDeviceResult *results,
     __global unsigned int *numResults)
 {
-    doIteration(totalPoints, compression, chain, xPtr, yPtr, incXPtr, incYPtr, targetList, numTargets, mask, results, numResults);
+    doIteration(totalPoints, compression, endomorphism, chain, xPtr, yPtr, incXPtr, incYPtr, targetList, numTargets, targetFilter, results, numResults);
 }
 
 __kernel void keyFinderKernelWithDouble(
     unsigned int totalPoints,
     int compression,
+    int endomorphism,
     __global uint256_t* chain,
     __global uint256_t* xPtr,
     __global uint256_t* yPtr,
@@ -392,9 +536,126 @@ __kernel void keyFinderKernelWithDouble(
     __global uint256_t* incYPtr,
     __global unsigned int* targetList,
     ulong numTargets,
-    ulong mask,
+    ulong targetFilter,
     __global CLDeviceResult *results,
     __global unsigned int *numResults)
 {
-    doIterationWithDouble(totalPoints, compression, chain, xPtr, yPtr, incXPtr, incYPtr, targetList, numTargets, mask, results, numResults);
+    doIterationWithDouble(totalPoints, compression, endomorphism, chain, xPtr, yPtr, incXPtr, incYPtr, targetList, numTargets, targetFilter, results, numResults);
+}
+
+/**
+* Adds the incrementor to every point without checking them
+*/
+__kernel void addPointKernel(
+    unsigned int totalPoints,
+    __global uint256_t* chain,
+    __global uint256_t* xPtr,
+    __global uint256_t* yPtr,
+    __global uint256_t* incXPtr,
+    __global uint256_t* incYPtr)
+{
+    int gid = get_local_size(0) * get_group_id(0) + get_local_id(0);
+    int dim = get_global_size(0);
+
+    uint256_t incX = *incXPtr;
+    uint256_t incY = *incYPtr;
+
+    uint256_t inverse = { {0,0,0,0,0,0,0,1} };
+
+    int i = gid;
+    int batchIdx = 0;
+    for(; i < totalPoints; i += dim) {
+        beginBatchAddWithDouble256k(incX, incY, xPtr, chain, i, batchIdx, &inverse);
+        batchIdx++;
+    }
+
+    inverse = doBatchInverse256k(inverse);
+
+    i -= dim;
+
+    for(; i >= 0; i -= dim) {
+        uint256_t newX;
+        uint256_t newY;
+        batchIdx--;
+        completeBatchAddWithDouble256k(incX, incY, xPtr, yPtr, i, batchIdx, chain, &inverse, &newX, &newY);
+
+        xPtr[i] = newX;
+        yPtr[i] = newY;
+    }
+}
+
+/**
+* Centre-out step. Each work item holds a centre point C and checks C and C +/- T[j]
+* for the table points T[j] = (j + 1) * stride * G, j < m. C + T[j] and C - T[j] share
+* the denominator (Tx - Cx), so one inversion covers 2m + 1 keys. Table entry m is
+* the incrementor that moves the centre to its next group.
+*/
+__kernel void keyFinderKernelCentreOut(
+    int m,
+    int compression,
+    int endomorphism,
+    __global uint256_t* chain,
+    __global uint256_t* xPtr,
+    __global uint256_t* yPtr,
+    __global uint256_t* tableX,
+    __global uint256_t* tableY,
+    __global unsigned int* targetList,
+    ulong numTargets,
+    ulong targetFilter,
+    __global CLDeviceResult *results,
+    __global unsigned int *numResults)
+{
+    int gid = get_local_size(0) * get_group_id(0) + get_local_id(0);
+    int dim = get_global_size(0);
+
+    // Keys of this work item are centreIdx - m ... centreIdx + m
+    int centreIdx = gid * (2 * m + 1) + m;
+
+    uint256_t cx = xPtr[gid];
+    uint256_t cy = yPtr[gid];
+
+    checkPublicKey(centreIdx, compression, endomorphism, cx, cy, targetList, numTargets, targetFilter, results, numResults);
+
+    // Multiply together all (Tx - Cx) and then invert
+    uint256_t inverse = { {0,0,0,0,0,0,0,1} };
+
+    for(int j = 0; j <= m; j++) {
+        inverse = mulModP256k(inverse, subModP256k(tableX[j], cx));
+        chain[j * dim + gid] = inverse;
+    }
+
+    inverse = doBatchInverse256k(inverse);
+
+    for(int j = m; j >= 0; j--) {
+        uint256_t tx = tableX[j];
+        uint256_t ty = tableY[j];
+        uint256_t s;
+
+        if(j > 0) {
+            s = mulModP256k(inverse, chain[(j - 1) * dim + gid]);
+            inverse = mulModP256k(inverse, subModP256k(tx, cx));
+        } else {
+            s = inverse;
+        }
+
+        // C + T: slope = (Ty - Cy) / (Tx - Cx)
+        uint256_t slope = mulModP256k(subModP256k(ty, cy), s);
+        uint256_t rx = subModP256k(subModP256k(squareModP256k(slope), cx), tx);
+        uint256_t ry = subModP256k(mulModP256k(slope, subModP256k(cx, rx)), cy);
+
+        if(j == m) {
+            xPtr[gid] = rx;
+            yPtr[gid] = ry;
+            continue;
+        }
+
+        checkPublicKey(centreIdx + j + 1, compression, endomorphism, rx, ry, targetList, numTargets, targetFilter, results, numResults);
+
+        // C - T: slope = (-Ty - Cy) / (Tx - Cx)
+        slope = mulModP256k(negModP256k(addModP256k(ty, cy)), s);
+        rx = subModP256k(subModP256k(squareModP256k(slope), cx), tx);
+        ry = subModP256k(mulModP256k(slope, subModP256k(cx, rx)), cy);
+
+        checkPublicKey(centreIdx - j - 1, compression, endomorphism, rx, ry, targetList, numTargets, targetFilter, results, numResults);
+    }
 }
@@ -0,0 +1,711 @@
+#include <string.h>
+#include <algorithm>
+
+#include "CpuKeySearchDevice.h"
+#include "AddressUtil.h"
+#include "Logger.h"
+#include "util.h"
+
+using namespace secp256k1;
+
+namespace {
+
+    // Number of points hashed together by the multi-buffer hash functions
+    const uint64_t CHECK_BATCH_SIZE = 64;
+
+    // Target sets up to this size are candidates for the linear list
+    const size_t MAX_LIST_TARGETS = 64;
+
+    // About 1 in 10^5 false positives, each costing one target set lookup
+    const unsigned int BLOOM_FILTER_BITS_PER_KEY = 32;
+
+    // How a point is combined with the incrementor in the batch addition
+    enum StepType {
+        STEP_ADD = 0,
+        STEP_DOUBLE,
+        STEP_FROM_INFINITY,
+        STEP_TO_INFINITY
+    };
+
+    const uint256 INFINITY_WORD(_POINT_AT_INFINITY_WORDS);
+
+    bool isInfinity(const uint256 &x)
+    {
+        return x == INFINITY_WORD;
+    }
+
+    /**
+     Returns the denominator of the slope used to add the incrementor to (x, y). The special
+     cases (P == inc, P == -inc, P at infinity) use a denominator of 1 so that they do not
+     disturb the batch inversion.
+     */
+    uint256 getDenominator(const uint256 &x, const uint256 &y, const ecpoint &inc, StepType &type)
+    {
+        if(isInfinity(x)) {
+            type = STEP_FROM_INFINITY;
+            return uint256(1);
+        }
+
+        if(x == inc.x) {
+            if(y == inc.y) {
+                type = STEP_DOUBLE;
+                return addModP(y, y);
+            }
+
+            type = STEP_TO_INFINITY;
+            return uint256(1);
+        }
+
+        type = STEP_ADD;
+        return subModP(inc.x, x);
+    }
+
+    // The centre and table point need the general addition when they share an x coordinate
+    bool isCentreSpecialCase(const ecpoint &c, const ecpoint &t)
+    {
+        return isInfinity(c.x) || c.x == t.x;
+    }
+
+    uint256 getCentreDenominator(const ecpoint &c, const ecpoint &t)
+    {
+        if(isCentreSpecialCase(c, t)) {
+            return uint256(1);
+        }
+
+        return subModP(t.x, c.x);
+    }
+
+    // (x, y) + (tx, ty) given inverse = 1 / (tx - x)
+    ecpoint addWithInverse(const ecpoint &c, const uint256 &tx, const uint256 &ty, const uint256 &inverse)
+    {
+        // s = (ty - y) / (tx - x)
+        uint256 s = multiplyModP(subModP(ty, c.y), inverse);
+
+        // rx = s^2 - x - tx, ry = s(x - rx) - y
+        uint256 rx = subModP(subModP(sqrModP(s), c.x), tx);
+        uint256 ry = subModP(multiplyModP(s, subModP(c.x, rx)), c.y);
+
+        return ecpoint(rx, ry);
+    }
+}
+
+CpuKeySearchDevice::CpuKeySearchDevice(int threads, int pointsPerThread, bool endomorphism, bool centreOut)
+{
+    if(threads <= 0) {
+        threads = util::getCpuCount();
+    }
+
+    if(pointsPerThread <= 0) {
+        throw KeySearchException("At least 1 point per thread required");
+    }
+
+    // Centre-out slices hold the centre and m points on either side
+    if(centreOut) {
+        pointsPerThread = 2 * std::max(1, pointsPerThread / 2) + 1;
+    }
+
+    _threads = threads;
+    _pointsPerThread = pointsPerThread;
+    _compression = PointCompressionType::COMPRESSED;
+    _endomorphism = endomorphism;
+    _centreOut = centreOut;
+    _targetFilter = TargetFilterType::AUTO;
+    _bloomBitsPerKey = BLOOM_FILTER_BITS_PER_KEY;
+    _lookupPending = false;
+    _hashes = 0;
+    _candidates = 0;
+    _falsePositives = 0;
+    _iterations = 0;
+    _stride = 1;
+
+    _pool = new util::ThreadPool(_threads);
+
+    _deviceName = "CPU (" + util::format(_threads) + " threads)";
+}
+
+CpuKeySearchDevice::~CpuKeySearchDevice()
+{
+    delete _pool;
+}
+
+void CpuKeySearchDevice::init(const uint256 &start, int compression, const uint256 &stride)
+{
+    if(start.cmp(N) >= 0) {
+        throw KeySearchException("Starting key is out of range");
+    }
+
+    _startExponent = start;
+
+    _compression = compression;
+
+    _stride = stride;
+
+    _iterations = 0;
+
+    generateStartingPoints();
+
+    // Set the incrementor
+    _increment = multiplyPoint(uint256(pointsPerStep()) * _stride, G());
+}
+
+size_t CpuKeySearchDevice::getPointsSize()
+{
+    // The centre-out points are rebuilt from the centres at each step
+    return _centreOut ? 0 : (size_t)pointsPerStep() * 2 * sizeof(uint256);
+}
+
+void CpuKeySearchDevice::savePoints(void *buf)
+{
+    uint64_t totalPoints = pointsPerStep();
+
+    memcpy(buf, _x.data(), totalPoints * sizeof(uint256));
+    memcpy((uint8_t *)buf + totalPoints * sizeof(uint256), _y.data(), totalPoints * sizeof(uint256));
+}
+
+void CpuKeySearchDevice::initFromPoints(const uint256 &start, int compression, const uint256 &stride, uint64_t iterations, const void *buf)
+{
+    if(_centreOut) {
+        throw KeySearchException("Saved points are not supported in centre-out mode");
+    }
+
+    if(start.cmp(N) >= 0) {
+        throw KeySearchException("Starting key is out of range");
+    }
+
+    _startExponent = start;
+
+    _compression = compression;
+
+    _stride = stride;
+
+    _iterations = iterations;
+
+    uint64_t totalPoints = pointsPerStep();
+
+    _x.resize(totalPoints);
+    _y.resize(totalPoints);
+    _chain.resize(totalPoints);
+
+    memcpy(_x.data(), buf, totalPoints * sizeof(uint256));
+    memcpy(_y.data(), (const uint8_t *)buf + totalPoints * sizeof(uint256), totalPoints * sizeof(uint256));
+
+    _increment = multiplyPoint(uint256(pointsPerStep()) * _stride, G());
+}
+
+void CpuKeySearchDevice::jump(const uint256 &key)
+{
+    if(key.cmp(N) >= 0) {
+        throw KeySearchException("Key is out of range");
+    }
+
+    uint256 offset = subModN(key, getNextKey());
+
+    if(!offset.isZero()) {
+        ecpoint p = multiplyPoint(offset, G());
+
+        _pool->parallelFor(_threads, [this, &p](int slice) {
+            // Centre-out points are rebuilt from the centres at the next step
+            if(_centreOut) {
+                _centres[slice] = addPoints(_centres[slice], p);
+            } else {
+                addToSlice(slice, p);
+            }
+        });
+    }
+
+    _startExponent = key;
+
+    _iterations = 0;
+}
+
+void CpuKeySearchDevice::generateStartingPoints()
+{
+    uint64_t totalPoints = pointsPerStep();
+
+    Logger::log(LogLevel::Info, "Generating " + util::formatThousands(totalPoints) + " starting points ("
+        + util::format("%.1f", (double)(totalPoints * 96) / (double)(1024 * 1024)) + "MB)");
+
+    _x.resize(totalPoints);
+    _y.resize(totalPoints);
+
+    if(_centreOut) {
+        int m = _pointsPerThread / 2;
+
+        _chain.resize((uint64_t)_threads * (m + 1));
+
+        // Slice s covers k + (s * pointsPerThread + j) * stride, centred on j = m
+        std::vector<uint256> exponents(_threads + m);
+        std::vector<ecpoint> points;
+
+        for(int slice = 0; slice < _threads; slice++) {
+            exponents[slice] = _startExponent + uint256((uint64_t)slice * _pointsPerThread + m) * _stride;
+        }
+
+        for(int i = 0; i < m; i++) {
+            exponents[_threads + i] = uint256(i + 1) * _stride;
+        }
+
+        generateKeyPairsBulk(G(), exponents, points, _threads);
+
+        _centres.assign(points.begin(), points.begin() + _threads);
+        _table.assign(points.begin() + _threads, points.end());
+
+        Logger::log(LogLevel::Info, "Done");
+        return;
+    }
+
+    _chain.resize(totalPoints);
+
+    // Point i starts at k + i * stride
+    std::vector<uint256> exponents(totalPoints);
+    std::vector<ecpoint> points;
+
+    for(uint64_t i = 0; i < totalPoints; i++) {
+        exponents[i] = _startExponent + uint256(i) * _stride;
+    }
+
+    generateKeyPairsBulk(G(), exponents, points, _threads);
+
+    for(uint64_t i = 0; i < totalPoints; i++) {
+        _x[i] = points[i].x;
+        _y[i] = points[i].y;
+    }
+
+    Logger::log(LogLevel::Info, "Done");
+}
+
+void CpuKeySearchDevice::buildLookup(const TargetSet &targets, TargetLookup &lookup)
+{
+    lookup.targets = targets;
+
+    lookup.list = LinearTargetList();
+    lookup.bloomFilter = BlockedBloomFilter();
+    lookup.fuseFilter = BinaryFuseFilter();
+
+    LookupConstraints constraints;
+    constraints.strategies = (1 << LookupStrategy::LIST) | (1 << LookupStrategy::TABLE) | (1 << LookupStrategy::BLOOM)
+        | (1 << LookupStrategy::FUSE8) | (1 << LookupStrategy::FUSE16) | (1 << LookupStrategy::FUSE32);
+    constraints.maxListSize = MAX_LIST_TARGETS;
+    constraints.memoryBudget = util::getAvailableSystemMemory() / 2;
+    constraints.bloomBitsPerKey = _bloomBitsPerKey;
+    constraints.bloomHashes = BlockedBloomFilter::HASHES;
+    constraints.bloomBlocked = true;
+    constraints.benchmark = true;
+
+    LookupPlan plan = LookupPlanner::plan(lookup.targets, constraints, _targetFilter);
+    LookupPlanner::log(plan, lookup.targets.size());
+
+    lookup.strategy = plan.strategy;
+
+    if(lookup.strategy == LookupStrategy::LIST) {
+        lookup.list.build(lookup.targets);
+        return;
+    }
+
+    if(lookup.strategy == LookupStrategy::TABLE) {
+        return;
+    }
+
+    if(lookup.strategy != LookupStrategy::BLOOM) {
+        int bits = LookupPlanner::fingerprintBits(lookup.strategy);
+
+        std::vector<uint64_t> keys;
+        keys.reserve(lookup.targets.size());
+
+        lookup.targets.forEach([&keys](const unsigned int hash[5]) {
+            keys.push_back(BinaryFuseFilter::key(hash));
+        });
+
+        if(lookup.fuseFilter.build(keys, bits)) {
+            return;
+        }
+
+        Logger::log(LogLevel::Warning, "Unable to build the fuse filter, using a bloom filter");
+        lookup.strategy = LookupStrategy::BLOOM;
+    }
+
+    lookup.bloomFilter.init(lookup.targets.size(), _bloomBitsPerKey);
+
+    BlockedBloomFilter &filter = lookup.bloomFilter;
+    lookup.targets.forEach([&filter](const unsigned int hash[5]) {
+        filter.insert(hash);
+    });
+}
+
+void CpuKeySearchDevice::setTargets(const TargetSet &targets)
+{
+    buildLookup(targets, _lookup);
+}
+
+void CpuKeySearchDevice::prepareTargets(const TargetSet &targets)
+{
+    TargetLookup lookup;
+    buildLookup(targets, lookup);
+
+    std::lock_guard<std::mutex> lock(_lookupMutex);
+    _pendingLookup = std::move(lookup);
+    _lookupPending = true;
+}
+
+bool CpuKeySearchDevice::swapTargets()
+{
+    std::lock_guard<std::mutex> lock(_lookupMutex);
+
+    if(!_lookupPending) {
+        return false;
+    }
+
+    _lookup = std::move(_pendingLookup);
+    _pendingLookup = TargetLookup();
+    _lookupPending = false;
+
+    return true;
+}
+
+void CpuKeySearchDevice::setFalsePositiveRate(double rate)
+{
+    // Takes effect the next time the lookup is built
+    if(rate > 0.0) {
+        _bloomBitsPerKey = LookupPlanner::bloomBitsPerKey(rate, BlockedBloomFilter::HASHES, true);
+    } else {
+        _bloomBitsPerKey = BLOOM_FILTER_BITS_PER_KEY;
+    }
+}
+
+void CpuKeySearchDevice::setVerifyThreads(int)
+{
+    // Filter hits are checked against the table by the thread that hashed them
+}
+
+KeySearchVerifierStats CpuKeySearchDevice::getVerifierStats()
+{
+    KeySearchVerifierStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    stats.hashes = _hashes;
+    stats.candidates = _candidates;
+    stats.falsePositives = _falsePositives;
+
+    return stats;
+}
+
+void CpuKeySearchDevice::setTargetFilter(int filter)
+{
+    _targetFilter = filter;
+}
+
+uint256 CpuKeySearchDevice::getPrivateKey(uint64_t index)
+{
+    uint256 offset = (uint256(pointsPerStep()) * _iterations + uint256(index)) * _stride;
+
+    return addModN(_startExponent, offset);
+}
+
+bool CpuKeySearchDevice::isTargetInList(const unsigned int hash[5])
+{
+    return _lookup.targets.contains(hash);
+}
+
+void CpuKeySearchDevice::removeTargetFromList(const unsigned int hash[5])
+{
+    _lookup.targets.remove(hash);
+}
+
+void CpuKeySearchDevice::probeTargets(const unsigned int *digests, int count, uint64_t *mask)
+{
+    switch(_lookup.strategy) {
+        case LookupStrategy::LIST:
+            _lookup.list.probe(digests, count, mask);
+            break;
+        case LookupStrategy::BLOOM:
+            _lookup.bloomFilter.probe(digests, count, mask);
+            break;
+        case LookupStrategy::FUSE8:
+        case LookupStrategy::FUSE16:
+        case LookupStrategy::FUSE32:
+            _lookup.fuseFilter.probe(digests, count, mask);
+            break;
+        default:
+            memset(mask, 0xff, sizeof(uint64_t) * ((count + 63) / 64));
+            break;
+    }
+}
+
+void CpuKeySearchDevice::addResult(uint64_t index, int image, bool compressed, const unsigned int digest[5])
+{
+    KeySearchResult r;
+    r.privateKey = endomorphismKey(getPrivateKey(index), image);
+    r.publicKey = endomorphismPoint(ecpoint(_x[index], _y[index]), image);
+    r.compressed = compressed;
+    memcpy(r.hash, digest, sizeof(r.hash));
+
+    std::lock_guard<std::mutex> lock(_resultsMutex);
+    _results.push_back(r);
+}
+
+void CpuKeySearchDevice::checkSlice(uint64_t begin, uint64_t end)
+{
+    unsigned int xWords[CHECK_BATCH_SIZE * 8];
+    unsigned int yWords[CHECK_BATCH_SIZE * 8];
+    unsigned int digests[CHECK_BATCH_SIZE * 5];
+    uint64_t indices[CHECK_BATCH_SIZE];
+    uint64_t mask[(CHECK_BATCH_SIZE + 63) / 64];
+
+    int images = _endomorphism ? ENDOMORPHISM_IMAGES : 1;
+
+    uint64_t candidates = 0;
+    uint64_t falsePositives = 0;
+
+    for(uint64_t i = begin; i < end; i += CHECK_BATCH_SIZE) {
+        uint64_t batchEnd = std::min(i + CHECK_BATCH_SIZE, end);
+        int count = 0;
+
+        for(uint64_t j = i; j < batchEnd; j++) {
+            if(!isInfinity(_x[j])) {
+                indices[count++] = j;
+            }
+        }
+
+        for(int image = 0; image < images; image++) {
+
+            for(int k = 0; k < count; k++) {
+                ecpoint p = endomorphismPoint(ecpoint(_x[indices[k]], _y[indices[k]]), image);
+
+                p.x.exportWords(&xWords[k * 8], 8, uint256::BigEndian);
+                p.y.exportWords(&yWords[k * 8], 8, uint256::BigEndian);
+            }
+
+            if(_compression != PointCompressionType::UNCOMPRESSED) {
+                Hash::hashPublicKeyCompressedBatch(xWords, yWords, digests, count);
+                probeTargets(digests, count, mask);
+
+                for(int k = 0; k < count; k++) {
+                    if(!((mask[k / 64] >> (k % 64)) & 1)) {
+                        continue;
+                    }
+
+                    candidates++;
+
+                    if(isTargetInList(&digests[k * 5])) {
+                        addResult(indices[k], image, true, &digests[k * 5]);
+                    } else {
+                        falsePositives++;
+                    }
+                }
+            }
+
+            if(_compression != PointCompressionType::COMPRESSED) {
+                Hash::hashPublicKeyBatch(xWords, yWords, digests, count);
+                probeTargets(digests, count, mask);
+
+                for(int k = 0; k < count; k++) {
+                    if(!((mask[k / 64] >> (k % 64)) & 1)) {
+                        continue;
+                    }
+
+                    candidates++;
+
+                    if(isTargetInList(&digests[k * 5])) {
+                        addResult(indices[k], image, false, &digests[k * 5]);
+                    } else {
+                        falsePositives++;
+                    }
+                }
+            }
+        }
+    }
+
+    // Without a filter every hash is looked up in the table
+    if(_lookup.strategy != LookupStrategy::TABLE) {
+        _candidates += candidates;
+        _falsePositives += falsePositives;
+    }
+}
+
+void CpuKeySearchDevice::stepSlice(int slice)
+{
+    uint64_t begin = (uint64_t)slice * _pointsPerThread;
+    uint64_t end = begin + _pointsPerThread;
+
+    checkSlice(begin, end);
+
+    addToSlice(slice, _increment);
+}
+
+void CpuKeySearchDevice::addToSlice(int slice, const ecpoint &p)
+{
+    uint64_t begin = (uint64_t)slice * _pointsPerThread;
+    uint64_t end = begin + _pointsPerThread;
+
+    // Multiply together all (px - x)
+    uint256 inverse(1);
+
+    for(uint64_t i = begin; i < end; i++) {
+        StepType type;
+
+        inverse = multiplyModP(inverse, getDenominator(_x[i], _y[i], p, type));
+        _chain[i] = inverse;
+    }
+
+    inverse = invModP(inverse);
+
+    // Walk the chain backwards, recovering 1/(px - x) for each point
+    for(uint64_t i = end; i-- > begin; ) {
+        StepType type;
+        uint256 denominator = getDenominator(_x[i], _y[i], p, type);
+
+        uint256 s;
+        if(i > begin) {
+            s = multiplyModP(inverse, _chain[i - 1]);
+            inverse = multiplyModP(inverse, denominator);
+        } else {
+            s = inverse;
+        }
+
+        const uint256 &x = _x[i];
+        const uint256 &y = _y[i];
+
+        if(type == STEP_FROM_INFINITY) {
+            _x[i] = p.x;
+            _y[i] = p.y;
+        } else if(type == STEP_TO_INFINITY) {
+            _x[i] = INFINITY_WORD;
+            _y[i] = INFINITY_WORD;
+        } else if(type == STEP_DOUBLE) {
+            // s = 3x^2 / 2y
+            uint256 x2 = sqrModP(x);
+            s = multiplyModP(addModP(addModP(x2, x2), x2), s);
+
+            // rx = s^2 - 2x, ry = s(x - rx) - y
+            uint256 rx = subModP(subModP(sqrModP(s), x), x);
+            uint256 ry = subModP(multiplyModP(s, subModP(x, rx)), y);
+
+            _x[i] = rx;
+            _y[i] = ry;
+        } else {
+            // s = (py - y) / (px - x)
+            s = multiplyModP(subModP(p.y, y), s);
+
+            // rx = s^2 - px - x, ry = s(px - rx) - py
+            uint256 rx = subModP(subModP(sqrModP(s), p.x), x);
+            uint256 ry = subModP(multiplyModP(s, subModP(p.x, rx)), p.y);
+
+            _x[i] = rx;
+            _y[i] = ry;
+        }
+    }
+}
+
+void CpuKeySearchDevice::stepSliceCentreOut(int slice)
+{
+    int m = _pointsPerThread / 2;
+    uint64_t begin = (uint64_t)slice * _pointsPerThread;
+    uint64_t centre = begin + m;
+    uint256 *chain = &_chain[(uint64_t)slice * (m + 1)];
+    const ecpoint c = _centres[slice];
+
+    // One denominator per table point, shared by C + T and C - T. The last one moves the centre.
+    uint256 inverse(1);
+
+    for(int i = 0; i <= m; i++) {
+        const ecpoint &t = i < m ? _table[i] : _increment;
+
+        inverse = multiplyModP(inverse, getCentreDenominator(c, t));
+        chain[i] = inverse;
+    }
+
+    inverse = invModP(inverse);
+
+    for(int i = m; i >= 0; i--) {
+        const ecpoint &t = i < m ? _table[i] : _increment;
+        uint256 denominator = getCentreDenominator(c, t);
+
+        uint256 s;
+        if(i > 0) {
+            s = multiplyModP(inverse, chain[i - 1]);
+            inverse = multiplyModP(inverse, denominator);
+        } else {
+            s = inverse;
+        }
+
+        bool special = isCentreSpecialCase(c, t);
+
+        ecpoint sum = special ? addPoints(c, t) : addWithInverse(c, t.x, t.y, s);
+
+        if(i == m) {
+            _centres[slice] = sum;
+            continue;
+        }
+
+        ecpoint negT(t.x, negModP(t.y));
+        ecpoint diff = special ? addPoints(c, negT) : addWithInverse(c, negT.x, negT.y, s);
+
+        _x[centre + i + 1] = sum.x;
+        _y[centre + i + 1] = sum.y;
+        _x[centre - i - 1] = diff.x;
+        _y[centre - i - 1] = diff.y;
+    }
+
+    _x[centre] = c.x;
+    _y[centre] = c.y;
+
+    checkSlice(begin, begin + _pointsPerThread);
+}
+
+void CpuKeySearchDevice::doStep()
+{
+    _pool->parallelFor(_threads, [this](int slice) {
+        if(_centreOut) {
+            stepSliceCentreOut(slice);
+        } else {
+            stepSlice(slice);
+        }
+    });
+
+    // Found targets are removed once all threads are done reading the list
+    for(size_t i = 0; i < _results.size(); i++) {
+        removeTargetFromList(_results[i].hash);
+    }
+
+    if(_lookup.strategy != LookupStrategy::TABLE) {
+        _hashes += keysPerStep() * (_compression == PointCompressionType::BOTH ? 2 : 1);
+    }
+
+    _iterations++;
+}
+
+size_t CpuKeySearchDevice::getResults(std::vector<KeySearchResult> &resultsOut)
+{
+    for(size_t i = 0; i < _results.size(); i++) {
+        resultsOut.push_back(_results[i]);
+    }
+    _results.clear();
+
+    return resultsOut.size();
+}
+
+uint64_t CpuKeySearchDevice::pointsPerStep()
+{
+    return (uint64_t)_threads * _pointsPerThread;
+}
+
+uint64_t CpuKeySearchDevice::keysPerStep()
+{
+    return pointsPerStep() * (_endomorphism ? ENDOMORPHISM_IMAGES : 1);
+}
+
+std::string CpuKeySearchDevice::getDeviceName()
+{
+    return _deviceName;
+}
+
+void CpuKeySearchDevice::getMemoryInfo(uint64_t &freeMem, uint64_t &totalMem)
+{
+    freeMem = util::getAvailableSystemMemory();
+    totalMem = util::getTotalSystemMemory();
+}
+
+uint256 CpuKeySearchDevice::getNextKey()
+{
+    return _startExponent + uint256(pointsPerStep()) * _iterations * _stride;
+}
@@ -0,0 +1,181 @@
+#ifndef _CPU_KEY_SEARCH_DEVICE_H
+#define _CPU_KEY_SEARCH_DEVICE_H
+
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include "KeySearchDevice.h"
+#include "BlockedBloomFilter.h"
+#include "BinaryFuseFilter.h"
+#include "LinearTargetList.h"
+#include "LookupPlanner.h"
+#include "secp256k1.h"
+#include "ThreadPool.h"
+
+/**
+ Key search device that runs on the host CPU. The points are split into one
+ contiguous slice per worker thread and each slice is stepped with the same
+ batched affine addition used by the GPU kernels: one shared inversion per
+ slice per step.
+
+ With the endomorphism enabled each point P = kG is also checked as -P,
+ (beta * x, y) and (beta^2 * x, y) and their negations, which are the public
+ keys of -k, lambda * k and lambda^2 * k. This is only useful when any key is
+ as good as any other, as in random 256-bit mode.
+
+ In centre-out mode each slice keeps a single centre point C and the
+ points C + iG and C - iG (i = 1..m) are computed from the table of iG.
+ Both share the denominator (x_iG - x_C), so one inversion covers 2m + 1
+ keys and the chain needs only m + 1 entries per slice.
+
+ Hashes are tested with whichever of a linear list, the target set itself, a
+ blocked Bloom filter or a binary fuse filter LookupPlanner times fastest
+ for the target set. Each batch of hashes is probed together so the filter
+ entries are fetched in parallel, and only the hashes that pass are looked
+ up in the set.
+ */
+class CpuKeySearchDevice : public KeySearchDevice {
+
+private:
+
+    int _threads;
+
+    int _pointsPerThread;
+
+    int _compression;
+
+    bool _endomorphism;
+
+    bool _centreOut;
+
+    uint64_t _iterations;
+
+    std::string _deviceName;
+
+    secp256k1::uint256 _startExponent;
+
+    secp256k1::uint256 _stride;
+
+    // Point that every point is incremented by at each step
+    secp256k1::ecpoint _increment;
+
+    // Current points, indexed by thread * pointsPerThread + idx
+    std::vector<secp256k1::uint256> _x;
+
+    std::vector<secp256k1::uint256> _y;
+
+    // Multiplication chain for the batch inversion
+    std::vector<secp256k1::uint256> _chain;
+
+    // Centre-out mode: the centre point of each slice and the table of (i + 1) * stride * G
+    std::vector<secp256k1::ecpoint> _centres;
+
+    std::vector<secp256k1::ecpoint> _table;
+
+    // The targets and whichever list or filter LookupPlanner chose for them
+    struct TargetLookup {
+        TargetSet targets;
+
+        int strategy = LookupStrategy::TABLE;
+
+        LinearTargetList list;
+
+        BlockedBloomFilter bloomFilter;
+
+        BinaryFuseFilter fuseFilter;
+    };
+
+    int _targetFilter;
+
+    // Bloom filter size from the configured false positive rate
+    unsigned int _bloomBitsPerKey;
+
+    TargetLookup _lookup;
+
+    // Built by prepareTargets() on another thread, moved to _lookup by swapTargets()
+    TargetLookup _pendingLookup;
+
+    bool _lookupPending;
+
+    std::mutex _lookupMutex;
+
+    // Hashes tested against the filter, the ones that passed and those that were not targets
+    uint64_t _hashes;
+    std::atomic<uint64_t> _candidates;
+    std::atomic<uint64_t> _falsePositives;
+
+    std::vector<KeySearchResult> _results;
+
+    std::mutex _resultsMutex;
+
+    util::ThreadPool *_pool;
+
+    void generateStartingPoints();
+
+    void buildLookup(const TargetSet &targets, TargetLookup &lookup);
+
+    void stepSlice(int slice);
+
+    // Adds p to the points of the slice with one inversion
+    void addToSlice(int slice, const secp256k1::ecpoint &p);
+
+    void stepSliceCentreOut(int slice);
+
+    void checkSlice(uint64_t begin, uint64_t end);
+
+    void probeTargets(const unsigned int *digests, int count, uint64_t *mask);
+
+    void addResult(uint64_t index, int image, bool compressed, const unsigned int digest[5]);
+
+    bool isTargetInList(const unsigned int hash[5]);
+
+    void removeTargetFromList(const unsigned int hash[5]);
+
+    secp256k1::uint256 getPrivateKey(uint64_t index);
+
+    uint64_t pointsPerStep();
+
+public:
+
+    CpuKeySearchDevice(int threads = 0, int pointsPerThread = 1024, bool endomorphism = false, bool centreOut = false);
+
+    ~CpuKeySearchDevice();
+
+    virtual void init(const secp256k1::uint256 &start, int compression, const secp256k1::uint256 &stride);
+
+    virtual void doStep();
+
+    virtual size_t getPointsSize();
+
+    virtual void savePoints(void *buf);
+
+    virtual void initFromPoints(const secp256k1::uint256 &start, int compression, const secp256k1::uint256 &stride, uint64_t iterations, const void *buf);
+
+    virtual void jump(const secp256k1::uint256 &key);
+
+    virtual void setTargets(const TargetSet &targets);
+
+    virtual void prepareTargets(const TargetSet &targets);
+
+    virtual bool swapTargets();
+
+    virtual void setTargetFilter(int filter);
+
+    virtual void setFalsePositiveRate(double rate);
+
+    virtual void setVerifyThreads(int threads);
+
+    virtual KeySearchVerifierStats getVerifierStats();
+
+    virtual size_t getResults(std::vector<KeySearchResult> &results);
+
+    virtual uint64_t keysPerStep();
+
+    virtual std::string getDeviceName();
+
+    virtual void getMemoryInfo(uint64_t &freeMem, uint64_t &totalMem);
+
+    virtual secp256k1::uint256 getNextKey();
+};
+
+#endif
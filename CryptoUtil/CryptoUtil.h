@@ -1,4 +1,5 @@
 #ifndef _CRYPTO_UTIL_H
+#define _CRYPTO_UTIL_H
 
 namespace crypto {
 
@@ -16,10 +17,38 @@ namespace crypto {
 
 	void ripemd160(unsigned int *msg, unsigned int *digest);
 
+	// Multi-lane RIPEMD-160 over count 32-byte SHA-256 digests (8 big-endian words
+	// each, as produced by sha256). digest receives count * 5 words in the same layout
+	// as ripemd160, or in the undoRMD160FinalRound form used by the device lookups.
+	// Uses AVX-512 (16 lanes), AVX2 (8 lanes) or SSE4.1 (4 lanes) when available.
+	void ripemd160Batch(const unsigned int *sha256Digest, unsigned int *digest, int count, bool undoFinalRound = false);
+
+	// Number of digests ripemd160Batch hashes in parallel on this CPU
+	int ripemd160BatchWidth();
+
+	// Subtracts the RIPEMD-160 IV from a hash160 and converts it to host byte order,
+	// the form the GPU kernels compare against
+	void undoRMD160FinalRound(const unsigned int hIn[5], unsigned int hOut[5]);
+
 	void sha256Init(unsigned int *digest);
 	void sha256(unsigned int *msg, unsigned int *digest);
 
+	// Multi-buffer SHA-256 over count independent messages, each made of `blocks`
+	// already padded 16-word blocks. msg holds count * blocks * 16 words, one message
+	// after the other, and digest receives count * 8 words. Uses AVX-512 (16 lanes)
+	// or AVX2 (8 lanes) when the CPU supports it, scalar code otherwise.
+	void sha256Batch(const unsigned int *msg, int blocks, unsigned int *digest, int count);
+
+	// Number of messages sha256Batch hashes in parallel on this CPU
+	int sha256BatchWidth();
+
+	// RIPEMD160(SHA256(msg)) for count messages laid out as for sha256Batch
+	void hash160Batch(const unsigned int *msg, int blocks, unsigned int *digest, int count, bool undoFinalRound = false);
+
 	unsigned int checksum(const unsigned int *hash);
+
+	// Base58Check checksums of count hash160s (5 words each), computed with sha256Batch
+	void checksumBatch(const unsigned int *hash, unsigned int *checksum, int count);
 };
 
 #endif
\ No newline at end of file
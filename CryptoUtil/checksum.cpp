@@ -7,10 +7,10 @@ static unsigned int endian(unsigned int x)
 	return (x << 24) | ((x << 8) & 0x00ff0000) | ((x >> 8) & 0x0000ff00) | (x >> 24);
 }
 
-unsigned int crypto::checksum(const unsigned int *hash)
+// Padded SHA-256 block for the version byte followed by the hash160
+static void checksumMessage(const unsigned int *hash, unsigned int *msg)
 {
-	unsigned int msg[16] = { 0 };
-	unsigned int digest[8] = { 0 };
+	memset(msg, 0, 16 * sizeof(unsigned int));
 
 	// Insert network byte, shift everything right 1 byte
 	msg[0] = 0x00; // main network
@@ -23,6 +23,14 @@ unsigned int crypto::checksum(const unsigned int *hash)
 
 	// Padding and length
 	msg[15] = 168;
+}
+
+unsigned int crypto::checksum(const unsigned int *hash)
+{
+	unsigned int msg[16] = { 0 };
+	unsigned int digest[8] = { 0 };
+
+	checksumMessage(hash, msg);
 
 	// Hash address
 	sha256Init(digest);
@@ -44,4 +52,36 @@ unsigned int crypto::checksum(const unsigned int *hash)
 	return digest[0];
 }
 
+void crypto::checksumBatch(const unsigned int *hash, unsigned int *checksum, int count)
+{
+	const int batch = 64;
+
+	unsigned int msg[batch * 16];
+	unsigned int digest[batch * 8];
+
+	for(int i = 0; i < count; i += batch) {
+		int n = count - i < batch ? count - i : batch;
+
+		for(int j = 0; j < n; j++) {
+			checksumMessage(&hash[(i + j) * 5], &msg[j * 16]);
+		}
+
+		sha256Batch(msg, 1, digest, n);
 
+		// Second SHA-256 over the 32-byte digest
+		for(int j = 0; j < n; j++) {
+			unsigned int *m = &msg[j * 16];
+
+			memset(m, 0, 16 * sizeof(unsigned int));
+			memcpy(m, &digest[j * 8], 8 * sizeof(unsigned int));
+			m[8] = 0x80000000;
+			m[15] = 256;
+		}
+
+		sha256Batch(msg, 1, digest, n);
+
+		for(int j = 0; j < n; j++) {
+			checksum[i + j] = digest[j * 8];
+		}
+	}
+}
@@ -1,5 +1,12 @@
 #include"CryptoUtil.h"
 #include<stdio.h>
+#include<string.h>
+
+// The multi-lane transform uses GCC/Clang vector extensions compiled for
+// SSE4.1, AVX2 and AVX-512 via target attributes and is selected at runtime
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define RIPEMD160_MULTI_LANE
+#endif
 
 static const unsigned int _IV[5] = {
 	0x67452301,
@@ -325,4 +332,255 @@ void crypto::ripemd160(unsigned int *x, unsigned int *digest)
 	digest[2] = endian(_IV[3] + e1 + a2);
 	digest[3] = endian(_IV[4] + a1 + b2);
 	digest[4] = endian(_IV[0] + b1 + c2);
-}
\ No newline at end of file
+}
+
+void crypto::undoRMD160FinalRound(const unsigned int hIn[5], unsigned int hOut[5])
+{
+	for(int i = 0; i < 5; i++) {
+		hOut[i] = endian(hIn[i]) - _IV[(i + 1) % 5];
+	}
+}
+
+#ifdef RIPEMD160_MULTI_LANE
+
+typedef unsigned int u32x4 __attribute__((vector_size(16)));
+typedef unsigned int u32x8 __attribute__((vector_size(32)));
+typedef unsigned int u32x16 __attribute__((vector_size(64)));
+
+// Message word selection and rotate amounts for the left and right lines
+static const unsigned char _R1[80] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+	7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
+	3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12,
+	1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2,
+	4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13
+};
+
+static const unsigned char _R2[80] = {
+	5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12,
+	6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2,
+	15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13,
+	8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14,
+	12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11
+};
+
+static const unsigned char _S1[80] = {
+	11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8,
+	7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12,
+	11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5,
+	11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12,
+	9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6
+};
+
+static const unsigned char _S2[80] = {
+	8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6,
+	9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11,
+	9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5,
+	15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8,
+	8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11
+};
+
+// Macros rather than functions so that no vector type is passed by value
+// outside of the target specific functions
+#define ROTLV(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ENDIANV(x) (((x) << 24) | (((x) << 8) & 0x00ff0000) | (((x) >> 8) & 0x0000ff00) | ((x) >> 24))
+
+#define RMD_F(x, y, z) ((x) ^ (y) ^ (z))
+#define RMD_G(x, y, z) (((x) & (y)) | (~(x) & (z)))
+#define RMD_H(x, y, z) (((x) | ~(y)) ^ (z))
+#define RMD_I(x, y, z) (((x) & (z)) | ((y) & ~(z)))
+#define RMD_J(x, y, z) ((x) ^ ((y) | ~(z)))
+
+// 16 steps of one line: T = rotl(a + f(b, c, d) + x + k, s) + e, then rotate the registers
+#define RMD_ROUND(a, b, c, d, e, f, k, r, s, first)\
+	for(int j = first; j < first + 16; j++) {\
+		V t = ROTLV(a + f(b, c, d) + w[r[j]] + (k), s[j]) + e;\
+		a = e;\
+		e = d;\
+		d = ROTLV(c, 10);\
+		c = b;\
+		b = t;\
+	}
+
+/**
+ Computes RIPEMD-160 of up to LANES 32-byte SHA-256 digests, one per vector lane.
+ Lanes beyond count repeat the last digest and are discarded.
+ */
+template<typename V, int LANES> static inline __attribute__((always_inline)) void ripemd160Lanes(const unsigned int *sha256Digest, unsigned int *digest, int count, bool undoFinalRound)
+{
+	V w[16];
+
+	// Transpose the digests so that each lane holds one message
+	for(int i = 0; i < 8; i++) {
+		unsigned int column[LANES];
+
+		for(int lane = 0; lane < LANES; lane++) {
+			int m = lane < count ? lane : count - 1;
+			column[lane] = sha256Digest[m * 8 + i];
+		}
+		memcpy(&w[i], column, sizeof(V));
+
+		w[i] = ENDIANV(w[i]);
+	}
+
+	// Padding and message length (256 bits), little endian
+	for(int i = 8; i < 16; i++) {
+		w[i] = V{};
+	}
+	w[8] += 0x00000080;
+	w[14] += 256;
+
+	V a1 = V{} + _IV[0];
+	V b1 = V{} + _IV[1];
+	V c1 = V{} + _IV[2];
+	V d1 = V{} + _IV[3];
+	V e1 = V{} + _IV[4];
+
+	V a2 = a1;
+	V b2 = b1;
+	V c2 = c1;
+	V d2 = d1;
+	V e2 = e1;
+
+	RMD_ROUND(a1, b1, c1, d1, e1, RMD_F, 0, _R1, _S1, 0);
+	RMD_ROUND(a1, b1, c1, d1, e1, RMD_G, _K0, _R1, _S1, 16);
+	RMD_ROUND(a1, b1, c1, d1, e1, RMD_H, _K1, _R1, _S1, 32);
+	RMD_ROUND(a1, b1, c1, d1, e1, RMD_I, _K2, _R1, _S1, 48);
+	RMD_ROUND(a1, b1, c1, d1, e1, RMD_J, _K3, _R1, _S1, 64);
+
+	RMD_ROUND(a2, b2, c2, d2, e2, RMD_J, _K7, _R2, _S2, 0);
+	RMD_ROUND(a2, b2, c2, d2, e2, RMD_I, _K6, _R2, _S2, 16);
+	RMD_ROUND(a2, b2, c2, d2, e2, RMD_H, _K5, _R2, _S2, 32);
+	RMD_ROUND(a2, b2, c2, d2, e2, RMD_G, _K4, _R2, _S2, 48);
+	RMD_ROUND(a2, b2, c2, d2, e2, RMD_F, 0, _R2, _S2, 64);
+
+	V h[5];
+	h[0] = c1 + d2;
+	h[1] = d1 + e2;
+	h[2] = e1 + a2;
+	h[3] = a1 + b2;
+	h[4] = b1 + c2;
+
+	// The undone form is the state before the IV is added, in host byte order
+	if(!undoFinalRound) {
+		for(int i = 0; i < 5; i++) {
+			h[i] += _IV[(i + 1) % 5];
+			h[i] = ENDIANV(h[i]);
+		}
+	}
+
+	for(int lane = 0; lane < count; lane++) {
+		for(int i = 0; i < 5; i++) {
+			digest[lane * 5 + i] = h[i][lane];
+		}
+	}
+}
+
+__attribute__((target("sse4.1"))) static void ripemd160x4(const unsigned int *sha256Digest, unsigned int *digest, int count, bool undoFinalRound)
+{
+	for(int i = 0; i < count; i += 4) {
+		int n = count - i < 4 ? count - i : 4;
+		ripemd160Lanes<u32x4, 4>(sha256Digest + i * 8, digest + i * 5, n, undoFinalRound);
+	}
+}
+
+__attribute__((target("avx2"))) static void ripemd160x8(const unsigned int *sha256Digest, unsigned int *digest, int count, bool undoFinalRound)
+{
+	for(int i = 0; i < count; i += 8) {
+		int n = count - i < 8 ? count - i : 8;
+		ripemd160Lanes<u32x8, 8>(sha256Digest + i * 8, digest + i * 5, n, undoFinalRound);
+	}
+}
+
+__attribute__((target("avx512f"))) static void ripemd160x16(const unsigned int *sha256Digest, unsigned int *digest, int count, bool undoFinalRound)
+{
+	for(int i = 0; i < count; i += 16) {
+		int n = count - i < 16 ? count - i : 16;
+		ripemd160Lanes<u32x16, 16>(sha256Digest + i * 8, digest + i * 5, n, undoFinalRound);
+	}
+}
+
+#endif
+
+static void ripemd160x1(const unsigned int *sha256Digest, unsigned int *digest, int count, bool undoFinalRound)
+{
+	for(int i = 0; i < count; i++) {
+		unsigned int msg[16] = { 0 };
+
+		for(int j = 0; j < 8; j++) {
+			msg[j] = endian(sha256Digest[i * 8 + j]);
+		}
+
+		// Message length, little endian
+		msg[8] = 0x00000080;
+		msg[14] = 256;
+
+		crypto::ripemd160(msg, &digest[i * 5]);
+
+		if(undoFinalRound) {
+			crypto::undoRMD160FinalRound(&digest[i * 5], &digest[i * 5]);
+		}
+	}
+}
+
+typedef void (*Ripemd160BatchFn)(const unsigned int *, unsigned int *, int, bool);
+
+struct Ripemd160BatchImpl {
+	Ripemd160BatchFn fn;
+	int width;
+};
+
+static Ripemd160BatchImpl selectRipemd160Batch()
+{
+#ifdef RIPEMD160_MULTI_LANE
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("avx512f")) {
+		return { ripemd160x16, 16 };
+	}
+
+	if(__builtin_cpu_supports("avx2")) {
+		return { ripemd160x8, 8 };
+	}
+
+	if(__builtin_cpu_supports("sse4.1")) {
+		return { ripemd160x4, 4 };
+	}
+#endif
+
+	return { ripemd160x1, 1 };
+}
+
+static const Ripemd160BatchImpl &getRipemd160Batch()
+{
+	static const Ripemd160BatchImpl impl = selectRipemd160Batch();
+
+	return impl;
+}
+
+void crypto::ripemd160Batch(const unsigned int *sha256Digest, unsigned int *digest, int count, bool undoFinalRound)
+{
+	if(count <= 0) {
+		return;
+	}
+
+	getRipemd160Batch().fn(sha256Digest, digest, count, undoFinalRound);
+}
+
+int crypto::ripemd160BatchWidth()
+{
+	return getRipemd160Batch().width;
+}
+
+void crypto::hash160Batch(const unsigned int *msg, int blocks, unsigned int *digest, int count, bool undoFinalRound)
+{
+	const int chunk = 64;
+	unsigned int sha256Digest[chunk * 8];
+
+	for(int i = 0; i < count; i += chunk) {
+		int n = count - i < chunk ? count - i : chunk;
+
+		sha256Batch(msg + i * blocks * 16, blocks, sha256Digest, n);
+		ripemd160Batch(sha256Digest, digest + i * 5, n, undoFinalRound);
+	}
+}
@@ -1,5 +1,13 @@
 #include "CryptoUtil.h"
 
+#include <string.h>
+
+// The multi-buffer transform uses GCC/Clang vector extensions and is compiled
+// for AVX2 and AVX-512 via target attributes, then selected at runtime
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256_MULTI_BUFFER
+#endif
+
 static const unsigned int _K[64] = {
 	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
 	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
@@ -103,4 +111,171 @@ void crypto::sha256(unsigned int *msg, unsigned int *digest)
 	digest[5] += f;
 	digest[6] += g;
 	digest[7] += h;
-}
\ No newline at end of file
+}
+
+#ifdef SHA256_MULTI_BUFFER
+
+typedef unsigned int u32x8 __attribute__((vector_size(32)));
+typedef unsigned int u32x16 __attribute__((vector_size(64)));
+
+// A macro rather than a function so that no vector type is passed by value
+// outside of the target specific functions
+#define ROTRV(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+template<typename V> static inline __attribute__((always_inline)) void roundV(const V &a, const V &b, const V &c, V &d, const V &e, const V &f, const V &g, V &h, const V &m, unsigned int k)
+{
+	V s = ((e & f) ^ (~e & g)) + (ROTRV(e, 6) ^ ROTRV(e, 11) ^ ROTRV(e, 25)) + k + m;
+
+	d += s + h;
+
+	h += s + ((a & b) ^ (a & c) ^ (b & c)) + (ROTRV(a, 2) ^ ROTRV(a, 13) ^ ROTRV(a, 22));
+}
+
+/**
+ Hashes up to LANES messages side by side, one message per vector lane. Lanes
+ beyond count repeat the last message and their digests are discarded.
+ */
+template<typename V, int LANES> static inline __attribute__((always_inline)) void sha256Lanes(const unsigned int *msg, int blocks, unsigned int *digest, int count)
+{
+	V state[8];
+
+	for(int i = 0; i < 8; i++) {
+		state[i] = V{} + _IV[i];
+	}
+
+	for(int block = 0; block < blocks; block++) {
+		V w[64];
+
+		// Transpose the message words so that each lane holds one message
+		for(int i = 0; i < 16; i++) {
+			unsigned int column[LANES];
+
+			for(int lane = 0; lane < LANES; lane++) {
+				int m = lane < count ? lane : count - 1;
+				column[lane] = msg[(m * blocks + block) * 16 + i];
+			}
+			memcpy(&w[i], column, sizeof(V));
+		}
+
+		for(int i = 16; i < 64; i++) {
+			V x = w[i - 15];
+			V y = w[i - 2];
+
+			V s0 = ROTRV(x, 7) ^ ROTRV(x, 18) ^ (x >> 3);
+			V s1 = ROTRV(y, 17) ^ ROTRV(y, 19) ^ (y >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+
+		V a = state[0];
+		V b = state[1];
+		V c = state[2];
+		V d = state[3];
+		V e = state[4];
+		V f = state[5];
+		V g = state[6];
+		V h = state[7];
+
+		for(int i = 0; i < 64; i += 8) {
+			roundV(a, b, c, d, e, f, g, h, w[i], _K[i]);
+			roundV(h, a, b, c, d, e, f, g, w[i + 1], _K[i + 1]);
+			roundV(g, h, a, b, c, d, e, f, w[i + 2], _K[i + 2]);
+			roundV(f, g, h, a, b, c, d, e, w[i + 3], _K[i + 3]);
+			roundV(e, f, g, h, a, b, c, d, w[i + 4], _K[i + 4]);
+			roundV(d, e, f, g, h, a, b, c, w[i + 5], _K[i + 5]);
+			roundV(c, d, e, f, g, h, a, b, w[i + 6], _K[i + 6]);
+			roundV(b, c, d, e, f, g, h, a, w[i + 7], _K[i + 7]);
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+		state[5] += f;
+		state[6] += g;
+		state[7] += h;
+	}
+
+	for(int lane = 0; lane < count; lane++) {
+		for(int i = 0; i < 8; i++) {
+			digest[lane * 8 + i] = state[i][lane];
+		}
+	}
+}
+
+__attribute__((target("avx2"))) static void sha256x8(const unsigned int *msg, int blocks, unsigned int *digest, int count)
+{
+	for(int i = 0; i < count; i += 8) {
+		int n = count - i < 8 ? count - i : 8;
+		sha256Lanes<u32x8, 8>(msg + i * blocks * 16, blocks, digest + i * 8, n);
+	}
+}
+
+__attribute__((target("avx512f"))) static void sha256x16(const unsigned int *msg, int blocks, unsigned int *digest, int count)
+{
+	for(int i = 0; i < count; i += 16) {
+		int n = count - i < 16 ? count - i : 16;
+		sha256Lanes<u32x16, 16>(msg + i * blocks * 16, blocks, digest + i * 8, n);
+	}
+}
+
+#endif
+
+static void sha256x1(const unsigned int *msg, int blocks, unsigned int *digest, int count)
+{
+	for(int i = 0; i < count; i++) {
+		unsigned int block[16];
+
+		crypto::sha256Init(&digest[i * 8]);
+
+		for(int j = 0; j < blocks; j++) {
+			memcpy(block, &msg[(i * blocks + j) * 16], sizeof(block));
+			crypto::sha256(block, &digest[i * 8]);
+		}
+	}
+}
+
+typedef void (*Sha256BatchFn)(const unsigned int *, int, unsigned int *, int);
+
+struct Sha256BatchImpl {
+	Sha256BatchFn fn;
+	int width;
+};
+
+static Sha256BatchImpl selectSha256Batch()
+{
+#ifdef SHA256_MULTI_BUFFER
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("avx512f")) {
+		return { sha256x16, 16 };
+	}
+
+	if(__builtin_cpu_supports("avx2")) {
+		return { sha256x8, 8 };
+	}
+#endif
+
+	return { sha256x1, 1 };
+}
+
+static const Sha256BatchImpl &getSha256Batch()
+{
+	static const Sha256BatchImpl impl = selectSha256Batch();
+
+	return impl;
+}
+
+void crypto::sha256Batch(const unsigned int *msg, int blocks, unsigned int *digest, int count)
+{
+	if(count <= 0) {
+		return;
+	}
+
+	getSha256Batch().fn(msg, blocks, digest, count);
+}
+
+int crypto::sha256BatchWidth()
+{
+	return getSha256Batch().width;
+}
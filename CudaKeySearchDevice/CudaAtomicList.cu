@@ -8,18 +8,24 @@
 
 static __constant__ void *_LIST_BUF[1];
 static __constant__ unsigned int *_LIST_SIZE[1];
+static __constant__ unsigned int _LIST_CAPACITY[1];
 
 
 __device__ void atomicListAdd(void *info, unsigned int size)
 {
 	unsigned int count = atomicAdd(_LIST_SIZE[0], 1);
 
+	// The count keeps going so the host can tell the list overflowed
+	if(count >= _LIST_CAPACITY[0]) {
+		return;
+	}
+
 	unsigned char *ptr = (unsigned char *)(_LIST_BUF[0]) + count * size;
 
 	memcpy(ptr, info, size);
 }
 
-static cudaError_t setListPtr(void *ptr, unsigned int *numResults)
+static cudaError_t setListPtr(void *ptr, unsigned int *numResults, unsigned int capacity)
 {
 	cudaError_t err = cudaMemcpyToSymbol(_LIST_BUF, &ptr, sizeof(void *));
 
@@ -29,6 +35,12 @@ static cudaError_t setListPtr(void *ptr, unsigned int *numResults)
 
 	err = cudaMemcpyToSymbol(_LIST_SIZE, &numResults, sizeof(unsigned int *));
 
+	if(err) {
+		return err;
+	}
+
+	err = cudaMemcpyToSymbol(_LIST_CAPACITY, &capacity, sizeof(unsigned int));
+
 	return err;
 }
 
@@ -36,6 +48,7 @@ static cudaError_t setListPtr(void *ptr, unsigned int *numResults)
 cudaError_t CudaAtomicList::init(unsigned int itemSize, unsigned int maxItems)
 {
 	_itemSize = itemSize;
+	_maxSize = maxItems;
 
 	// The number of results found in the most recent kernel run
 	_countHostPtr = NULL;
@@ -67,7 +80,7 @@ cudaError_t CudaAtomicList::init(unsigned int itemSize, unsigned int maxItems)
 		goto end;
 	}
 
-	err = setListPtr(_devPtr, _countDevPtr);
+	err = setListPtr(_devPtr, _countDevPtr, maxItems);
 
 end:
 	if(err) {
@@ -88,6 +101,11 @@ unsigned int CudaAtomicList::size()
 	return *_countHostPtr;
 }
 
+unsigned int CudaAtomicList::capacity()
+{
+	return _maxSize;
+}
+
 void CudaAtomicList::clear()
 {
 	*_countHostPtr = 0;
@@ -99,6 +117,10 @@ unsigned int CudaAtomicList::read(void *ptr, unsigned int count)
 		count = *_countHostPtr;
 	}
 
+	if(count >= _maxSize) {
+		count = _maxSize;
+	}
+
 	memcpy(ptr, _hostPtr, count * _itemSize);
 
 	return count;
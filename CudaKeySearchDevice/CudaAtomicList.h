@@ -43,8 +43,11 @@ public:
 
 	unsigned int read(void *dest, unsigned int count);
 
+	// Items appended since the last clear(), may be more than fit
 	unsigned int size();
 
+	unsigned int capacity();
+
 	void clear();
 
     void cleanup();
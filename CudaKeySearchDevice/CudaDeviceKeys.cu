@@ -195,6 +195,11 @@ cudaError_t CudaDeviceKeys::init(int blocks, int threads, int pointsPerThread, c
 	_threads = threads;
 	_pointsPerThread = pointsPerThread;
 
+	_step = 0;
+
+	// Points from an earlier init
+	clearPublicKeys();
+
 	size_t count = privateKeys.size();
 
 	// Allocate space for public keys on device
@@ -253,6 +258,41 @@ cudaError_t CudaDeviceKeys::init(int blocks, int threads, int pointsPerThread, c
 	return cudaSuccess;
 }
 
+cudaError_t CudaDeviceKeys::getPublicKeys(unsigned int *x, unsigned int *y)
+{
+	size_t size = sizeof(unsigned int) * 8 * _blocks * _threads * _pointsPerThread;
+
+	cudaError_t err = cudaMemcpy(x, _devX, size, cudaMemcpyDeviceToHost);
+	if(err) {
+		return err;
+	}
+
+	return cudaMemcpy(y, _devY, size, cudaMemcpyDeviceToHost);
+}
+
+cudaError_t CudaDeviceKeys::setPublicKeys(int blocks, int threads, int pointsPerThread, const unsigned int *x, const unsigned int *y)
+{
+	_blocks = blocks;
+	_threads = threads;
+	_pointsPerThread = pointsPerThread;
+
+	clearPublicKeys();
+
+	size_t count = (size_t)blocks * threads * pointsPerThread;
+
+	cudaError_t err = initializePublicKeys(count);
+	if(err) {
+		return err;
+	}
+
+	err = cudaMemcpy(_devX, x, sizeof(unsigned int) * count * 8, cudaMemcpyHostToDevice);
+	if(err) {
+		return err;
+	}
+
+	return cudaMemcpy(_devY, y, sizeof(unsigned int) * count * 8, cudaMemcpyHostToDevice);
+}
+
 void CudaDeviceKeys::clearPublicKeys()
 {
 	cudaFree(_devX);
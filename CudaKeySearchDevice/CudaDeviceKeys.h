@@ -72,6 +72,12 @@ public:
 
 	cudaError_t doStep();
 
+	// Copies the public keys to host memory, 8 words per key in device order
+	cudaError_t getPublicKeys(unsigned int *x, unsigned int *y);
+
+	// Replaces the public keys with keys saved by getPublicKeys(), without generating them
+	cudaError_t setPublicKeys(int blocks, int threads, int pointsPerThread, const unsigned int *x, const unsigned int *y);
+
 	void clearPrivateKeys();
 
 	void clearPublicKeys();
@@ -13,7 +13,18 @@
 
 #include "util.h"
 
-#define MAX_TARGETS_CONSTANT_MEM 16
+#include "CryptoUtil.h"
+
+#include "BinaryFuseFilter.h"
+
+#include "BloomFilterCounters.h"
+
+#include "LookupPlanner.h"
+
+#define MAX_TARGETS_CONSTANT_MEM CudaHashLookup::MAX_LIST_TARGETS
+
+// Smallest bloom filter, 32 words
+#define MIN_BLOOM_FILTER_BITS 10
 
 __constant__ unsigned int _TARGET_HASH[MAX_TARGETS_CONSTANT_MEM][5];
 __constant__ unsigned int _NUM_TARGET_HASHES[1];
@@ -21,28 +32,14 @@ __constant__ unsigned int *_BLOOM_FILTER[1];
 __constant__ unsigned int _BLOOM_FILTER_MASK[1];
 __constant__ unsigned long long _BLOOM_FILTER_MASK64[1];
 
-__constant__ unsigned int _USE_BLOOM_FILTER[1];
-
-
-static unsigned int swp(unsigned int x)
-{
-	return (x << 24) | ((x << 8) & 0x00ff0000) | ((x >> 8) & 0x0000ff00) | (x >> 24);
-}
+__constant__ unsigned int *_FUSE_FILTER[1];
+__constant__ unsigned long long _FUSE_FILTER_SEED[1];
+__constant__ unsigned int _FUSE_FILTER_SEGMENT_LENGTH[1];
+__constant__ unsigned int _FUSE_FILTER_SEGMENT_COUNT_LENGTH[1];
 
-static void undoRMD160FinalRound(const unsigned int hIn[5], unsigned int hOut[5])
-{
-	unsigned int iv[5] = {
-		0x67452301,
-		0xefcdab89,
-		0x98badcfe,
-		0x10325476,
-		0xc3d2e1f0
-	};
+// 0: constant memory list, 1: 32-bit bloom filter, 2: 64-bit bloom filter, 3: fuse filter
+__constant__ unsigned int _USE_BLOOM_FILTER[1];
 
-	for(int i = 0; i < 5; i++) {
-		hOut[i] = swp(hIn[i]) - iv[(i + 1) % 5];
-	}
-}
 
 /**
 Copies the target hashes to constant memory
@@ -54,7 +51,7 @@ cudaError_t CudaHashLookup::setTargetConstantMemory(const std::vector<struct has
 	for(size_t i = 0; i < count; i++) {
 		unsigned int h[5];
 
-		undoRMD160FinalRound(targets[i].h, h);
+		crypto::undoRMD160FinalRound(targets[i].h, h);
 
 		cudaError_t err = cudaMemcpyToSymbol(_TARGET_HASH, h, sizeof(unsigned int) * 5, i * sizeof(unsigned int) * 5);
 
@@ -86,155 +83,340 @@ unsigned int CudaHashLookup::getOptimalBloomFilterBits(double p, size_t n)
 {
 	double m = 3.6 * ceil((n * log(p)) / log(1 / pow(2, log(2))));
 
-	return (unsigned int)ceil(log(m) / log(2));
+	unsigned int bits = (unsigned int)ceil(log(m) / log(2));
+
+	return bits < MIN_BLOOM_FILTER_BITS ? MIN_BLOOM_FILTER_BITS : bits;
 }
 
-void CudaHashLookup::initializeBloomFilter(const std::vector<struct hash160> &targets, unsigned int *filter, unsigned int mask)
+double CudaHashLookup::getBloomFilterBitsPerKey(size_t n, double p)
 {
-	// Use the low 16 bits of each word in the hash as the index into the bloom filter
-	for(unsigned int i = 0; i < targets.size(); i++) {
-
-		unsigned int h[5];
-
-		undoRMD160FinalRound(targets[i].h, h);
+	if(n == 0) {
+		return 0.0;
+	}
 
-		for(int j = 0; j < 5; j++) {
-			unsigned int idx = h[j] & mask;
+	return pow(2.0, (double)getOptimalBloomFilterBits(p, n)) / (double)n;
+}
 
-			filter[idx / 32] |= (0x01 << (idx % 32));
+/**
+Gets the 5 bloom filter bits for a hash. Filters of up to 2^32 bits use the low bits of
+each word in the hash, larger ones combine pairs of words. Matches checkBloomFilter and
+checkBloomFilter64
+*/
+void CudaHashLookup::getBloomFilterIndices(const unsigned int hash[5], unsigned long long mask, unsigned long long idx[5])
+{
+	if(mask <= 0xffffffffULL) {
+		for(int i = 0; i < 5; i++) {
+			idx[i] = hash[i] & mask;
 		}
-
+	} else {
+		idx[0] = ((unsigned long long)hash[0] << 32 | hash[1]) & mask;
+		idx[1] = ((unsigned long long)hash[2] << 32 | hash[3]) & mask;
+		idx[2] = ((unsigned long long)(hash[0]^hash[1]) << 32 | (hash[1]^hash[2])) & mask;
+		idx[3] = ((unsigned long long)(hash[2]^hash[3]) << 32 | (hash[3] ^ hash[4])) & mask;
+		idx[4] = ((unsigned long long)(hash[0]^hash[3]) << 32 | (hash[1]^hash[3])) & mask;
 	}
 }
 
-void CudaHashLookup::initializeBloomFilter64(const std::vector<struct hash160> &targets, unsigned int *filter, unsigned long long mask)
+/**
+Sizes the bloom filter for the targets and counts the targets behind each bit. Returns false
+if there is not enough host memory
+*/
+bool CudaHashLookup::buildBloomFilter(const std::vector<struct hash160> &targets, double p, CudaTargetLookup &lookup)
 {
+	unsigned int bloomFilterBits = getOptimalBloomFilterBits(p, targets.size());
+
+	unsigned long long bloomFilterSizeWords = (unsigned long long)1 << (bloomFilterBits - 5);
+	unsigned long long bloomFilterMask = (((unsigned long long)1 << bloomFilterBits) - 1);
+
+	Logger::log(LogLevel::Info, "Allocating bloom filter (" + util::format("%.1f", (double)(bloomFilterSizeWords * sizeof(unsigned int))/(double)(1024*1024)) + "MB)");
+
+	try {
+		lookup.bloomFilter.resize(bloomFilterSizeWords);
+
+		// Kept so found targets can be removed from the filter
+		lookup.bloomCounters.init((unsigned long long)1 << bloomFilterBits);
+	} catch(std::bad_alloc) {
+		Logger::log(LogLevel::Error, "Out of system memory");
+
+		lookup.bloomFilter.clear();
+		lookup.bloomCounters = BloomFilterCounters();
+
+		return false;
+	}
+
 	for(unsigned int k = 0; k < targets.size(); k++) {
 
 		unsigned int hash[5];
 
 		unsigned long long idx[5];
 
-		undoRMD160FinalRound(targets[k].h, hash);
+		crypto::undoRMD160FinalRound(targets[k].h, hash);
 
-		idx[0] = ((unsigned long long)hash[0] << 32 | hash[1]) & mask;
-		idx[1] = ((unsigned long long)hash[2] << 32 | hash[3]) & mask;
-		idx[2] = ((unsigned long long)(hash[0]^hash[1]) << 32 | (hash[1]^hash[2])) & mask;
-		idx[3] = ((unsigned long long)(hash[2]^hash[3]) << 32 | (hash[3] ^ hash[4])) & mask;
-		idx[4] = ((unsigned long long)(hash[0]^hash[3]) << 32 | (hash[1]^hash[3])) & mask;
+		getBloomFilterIndices(hash, bloomFilterMask, idx);
 
 		for(int i = 0; i < 5; i++) {
-
-			filter[idx[i] / 32] |= (0x01 << (idx[i] % 32));
+			lookup.bloomCounters.add(idx[i]);
 		}
 	}
+
+	for(unsigned long long i = 0; i < bloomFilterSizeWords; i++) {
+		lookup.bloomFilter[i] = lookup.bloomCounters.filterWord(i);
+	}
+
+	lookup.bloomFilterBits = bloomFilterBits;
+
+	return true;
 }
 
 /**
-Populates the bloom filter with the target hashes
+Builds a binary fuse filter with 32-bit fingerprints. Narrower fingerprints would let
+too many false positives through for the results list. Returns false if the construction
+failed, so the caller can fall back to the bloom filter
 */
-cudaError_t CudaHashLookup::setTargetBloomFilter(const std::vector<struct hash160> &targets)
+bool CudaHashLookup::buildFuseFilter(const std::vector<struct hash160> &targets, CudaTargetLookup &lookup)
 {
-	unsigned int bloomFilterBits = getOptimalBloomFilterBits(1.0e-9, targets.size());
+	std::vector<uint64_t> keys;
+	keys.reserve(targets.size());
 
-	unsigned long long bloomFilterSizeWords = (unsigned long long)1 << (bloomFilterBits - 5);
-	unsigned long long bloomFilterBytes = (unsigned long long)1 << (bloomFilterBits - 3);
-	unsigned long long bloomFilterMask = (((unsigned long long)1 << bloomFilterBits) - 1);
+	for(size_t i = 0; i < targets.size(); i++) {
+		unsigned int h[5];
 
-	Logger::log(LogLevel::Info, "Allocating bloom filter (" + util::format("%.1f", (double)bloomFilterBytes/(double)(1024*1024)) + "MB)");
+		crypto::undoRMD160FinalRound(targets[i].h, h);
 
-	unsigned int *filter = NULL;
-	
-	try {
-		filter = new unsigned int[bloomFilterSizeWords];
-	} catch(std::bad_alloc) {
-		Logger::log(LogLevel::Error, "Out of system memory");
+		keys.push_back(BinaryFuseFilter::key(h));
+	}
 
-		return cudaErrorMemoryAllocation;
+	if(!lookup.fuseFilter.build(keys, 32)) {
+		Logger::log(LogLevel::Warning, "Unable to build the fuse filter, using a bloom filter");
+		return false;
 	}
 
+	Logger::log(LogLevel::Info, "Allocating fuse filter (" + util::format("%.1f", (double)lookup.fuseFilter.size()/(double)(1024*1024)) + "MB)");
+
+	return true;
+}
+
+/**
+Copies the bloom filter to the device
+*/
+cudaError_t CudaHashLookup::setTargetBloomFilter(CudaTargetLookup &lookup)
+{
+	unsigned int bloomFilterBits = lookup.bloomFilterBits;
+	unsigned long long bloomFilterBytes = (unsigned long long)1 << (bloomFilterBits - 3);
+	unsigned long long bloomFilterMask = (((unsigned long long)1 << bloomFilterBits) - 1);
+
 	cudaError_t err = cudaMalloc(&_bloomFilterPtr, bloomFilterBytes);
 
 	if(err) {
 		Logger::log(LogLevel::Error, "Device error: " + std::string(cudaGetErrorString(err)));
-		delete[] filter;
+		_bloomFilterPtr = NULL;
 		return err;
 	}
 
-	memset(filter, 0, sizeof(unsigned int) * bloomFilterSizeWords);
-	if(bloomFilterBits > 32) {
-		initializeBloomFilter64(targets, filter, bloomFilterMask);
-	} else {
-		initializeBloomFilter(targets, filter, (unsigned int)bloomFilterMask);
+	// Copy to device
+	err = cudaMemcpy(_bloomFilterPtr, lookup.bloomFilter.data(), bloomFilterBytes, cudaMemcpyHostToDevice);
+
+	// Copy device memory pointer to constant memory
+	if(!err) {
+		err = cudaMemcpyToSymbol(_BLOOM_FILTER, &_bloomFilterPtr, sizeof(unsigned int *));
+	}
+
+	if(!err) {
+		if(bloomFilterBits <= 32) {
+			err = cudaMemcpyToSymbol(_BLOOM_FILTER_MASK, &bloomFilterMask, sizeof(unsigned int *));
+		} else {
+			err = cudaMemcpyToSymbol(_BLOOM_FILTER_MASK64, &bloomFilterMask, sizeof(unsigned long long *));
+		}
+	}
+
+	if(!err) {
+		unsigned int useBloomFilter = bloomFilterBits <= 32 ? 1 : 2;
+
+		err = cudaMemcpyToSymbol(_USE_BLOOM_FILTER, &useBloomFilter, sizeof(unsigned int));
 	}
 
-	// Copy to device
-	err = cudaMemcpy(_bloomFilterPtr, filter, sizeof(unsigned int) * bloomFilterSizeWords, cudaMemcpyHostToDevice);
 	if(err) {
 		cudaFree(_bloomFilterPtr);
 		_bloomFilterPtr = NULL;
-		delete[] filter;
 		return err;
 	}
 
-	// Copy device memory pointer to constant memory
-	err = cudaMemcpyToSymbol(_BLOOM_FILTER, &_bloomFilterPtr, sizeof(unsigned int *));
+	_bloomFilterMask = bloomFilterMask;
+	_bloomCounters = std::move(lookup.bloomCounters);
+
+	return cudaSuccess;
+}
+
+/**
+Copies the fuse filter to the device
+*/
+cudaError_t CudaHashLookup::setTargetFuseFilter(const CudaTargetLookup &lookup)
+{
+	const BinaryFuseFilter &filter = lookup.fuseFilter;
+
+	cudaError_t err = cudaMalloc(&_fuseFilterPtr, filter.size());
 	if(err) {
-		cudaFree(_bloomFilterPtr);
-		_bloomFilterPtr = NULL;
-		delete[] filter;
+		Logger::log(LogLevel::Error, "Device error: " + std::string(cudaGetErrorString(err)));
+		_fuseFilterPtr = NULL;
 		return err;
 	}
 
-	// Copy device memory pointer to constant memory
-	if(bloomFilterBits <= 32) {
-		err = cudaMemcpyToSymbol(_BLOOM_FILTER_MASK, &bloomFilterMask, sizeof(unsigned int *));
-		if(err) {
-			cudaFree(_bloomFilterPtr);
-			_bloomFilterPtr = NULL;
-			delete[] filter;
-			return err;
-		}
-	} else {
-		err = cudaMemcpyToSymbol(_BLOOM_FILTER_MASK64, &bloomFilterMask, sizeof(unsigned long long *));
-		if(err) {
-			cudaFree(_bloomFilterPtr);
-			_bloomFilterPtr = NULL;
-			delete[] filter;
-			return err;
-		}
+	uint64_t seed = filter.seed();
+	unsigned int segmentLength = filter.segmentLength();
+	unsigned int segmentCountLength = filter.segmentCountLength();
+	unsigned int useBloomFilter = 3;
+
+	err = cudaMemcpy(_fuseFilterPtr, filter.data(), filter.size(), cudaMemcpyHostToDevice);
+
+	if(!err) {
+		err = cudaMemcpyToSymbol(_FUSE_FILTER, &_fuseFilterPtr, sizeof(unsigned int *));
+	}
+
+	if(!err) {
+		err = cudaMemcpyToSymbol(_FUSE_FILTER_SEED, &seed, sizeof(unsigned long long));
+	}
+
+	if(!err) {
+		err = cudaMemcpyToSymbol(_FUSE_FILTER_SEGMENT_LENGTH, &segmentLength, sizeof(unsigned int));
 	}
 
-	unsigned int useBloomFilter = bloomFilterBits <= 32 ? 1 : 2;
+	if(!err) {
+		err = cudaMemcpyToSymbol(_FUSE_FILTER_SEGMENT_COUNT_LENGTH, &segmentCountLength, sizeof(unsigned int));
+	}
 
-	err = cudaMemcpyToSymbol(_USE_BLOOM_FILTER, &useBloomFilter, sizeof(unsigned int));
+	if(!err) {
+		err = cudaMemcpyToSymbol(_USE_BLOOM_FILTER, &useBloomFilter, sizeof(unsigned int));
+	}
 
-	delete[] filter;
+	if(err) {
+		cudaFree(_fuseFilterPtr);
+		_fuseFilterPtr = NULL;
+		return err;
+	}
 
-	return err;
+	return cudaSuccess;
 }
 
 /**
-*Copies the target hashes to either constant memory, or the bloom filter depending
-on how many targets there are
+Builds the constant memory list, or the bloom or fuse filter depending on the strategy. Only
+host memory is used, so this can run on another thread while the kernels run
 */
-cudaError_t CudaHashLookup::setTargets(const std::vector<struct hash160> &targets)
+cudaError_t CudaHashLookup::build(const std::vector<struct hash160> &targets, int strategy, double p, CudaTargetLookup &lookup)
+{
+	if(strategy == LookupStrategy::LIST && targets.size() <= MAX_TARGETS_CONSTANT_MEM) {
+		lookup.strategy = LookupStrategy::LIST;
+		lookup.constantTargets = targets;
+
+		return cudaSuccess;
+	}
+
+	if(strategy == LookupStrategy::FUSE32 && buildFuseFilter(targets, lookup)) {
+		lookup.strategy = LookupStrategy::FUSE32;
+
+		return cudaSuccess;
+	}
+
+	if(!buildBloomFilter(targets, p, lookup)) {
+		return cudaErrorMemoryAllocation;
+	}
+
+	lookup.strategy = LookupStrategy::BLOOM;
+
+	return cudaSuccess;
+}
+
+/**
+Replaces the lookup on the device with one from build()
+*/
+cudaError_t CudaHashLookup::upload(CudaTargetLookup &lookup)
 {
 	cleanup();
 
-	if(targets.size() <= MAX_TARGETS_CONSTANT_MEM) {
-		return setTargetConstantMemory(targets);
-	} else {
-		return setTargetBloomFilter(targets);
+	if(lookup.strategy == LookupStrategy::LIST) {
+		_constantTargets = lookup.constantTargets;
+
+		return setTargetConstantMemory(_constantTargets);
+	} else if(lookup.strategy == LookupStrategy::FUSE32) {
+		return setTargetFuseFilter(lookup);
+	}
+
+	return setTargetBloomFilter(lookup);
+}
+
+/**
+*Copies the target hashes to either constant memory, or the bloom or fuse filter depending
+on the strategy
+*/
+cudaError_t CudaHashLookup::setTargets(const std::vector<struct hash160> &targets, int strategy, double p)
+{
+	CudaTargetLookup lookup;
+
+	cudaError_t err = build(targets, strategy, p, lookup);
+
+	if(err) {
+		return err;
 	}
+
+	return upload(lookup);
+}
+
+/**
+Removes a found target without rebuilding the lookup. Only the bloom filter words with bits
+no other target sets are copied to the device. Keys cannot be removed from the fuse filter,
+so a removed target still passes it and is dropped by the check on the host
+*/
+cudaError_t CudaHashLookup::removeTarget(const unsigned int hash[5])
+{
+	for(size_t i = 0; i < _constantTargets.size(); i++) {
+		if(memcmp(_constantTargets[i].h, hash, sizeof(_constantTargets[i].h)) == 0) {
+			_constantTargets.erase(_constantTargets.begin() + i);
+
+			return setTargetConstantMemory(_constantTargets);
+		}
+	}
+
+	if(_bloomFilterPtr == NULL) {
+		return cudaSuccess;
+	}
+
+	unsigned int h[5];
+	unsigned long long idx[5];
+
+	crypto::undoRMD160FinalRound(hash, h);
+
+	getBloomFilterIndices(h, _bloomFilterMask, idx);
+
+	for(int i = 0; i < 5; i++) {
+		if(!_bloomCounters.remove(idx[i])) {
+			continue;
+		}
+
+		unsigned int word = _bloomCounters.filterWord(idx[i] / 32);
+
+		cudaError_t err = cudaMemcpy(_bloomFilterPtr + idx[i] / 32, &word, sizeof(unsigned int), cudaMemcpyHostToDevice);
+
+		if(err) {
+			return err;
+		}
+	}
+
+	return cudaSuccess;
 }
 
 void CudaHashLookup::cleanup()
 {
+	_constantTargets.clear();
+	_bloomCounters = BloomFilterCounters();
+
 	if(_bloomFilterPtr != NULL) {
 		cudaFree(_bloomFilterPtr);
 		_bloomFilterPtr = NULL;
 	}
+
+	if(_fuseFilterPtr != NULL) {
+		cudaFree(_fuseFilterPtr);
+		_fuseFilterPtr = NULL;
+	}
 }
 
 __device__ bool checkBloomFilter(const unsigned int hash[5])
@@ -283,6 +465,31 @@ __device__ bool checkBloomFilter64(const unsigned int hash[5])
 }
 
 
+/**
+Binary fuse filter lookup, see BinaryFuseFilter.h
+*/
+__device__ bool checkFuseFilter(const unsigned int hash[5])
+{
+	unsigned long long x = (((unsigned long long)hash[0] << 32) | hash[1]) + _FUSE_FILTER_SEED[0];
+
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+
+	unsigned int segmentLength = _FUSE_FILTER_SEGMENT_LENGTH[0];
+	unsigned int *fingerprints = _FUSE_FILTER[0];
+
+	unsigned int h0 = (unsigned int)__umul64hi(x, _FUSE_FILTER_SEGMENT_COUNT_LENGTH[0]);
+	unsigned int h1 = (h0 + segmentLength) ^ ((unsigned int)(x >> 18) & (segmentLength - 1));
+	unsigned int h2 = (h0 + 2 * segmentLength) ^ ((unsigned int)x & (segmentLength - 1));
+
+	unsigned int f = (unsigned int)(x ^ (x >> 32));
+
+	return (f ^ fingerprints[h0] ^ fingerprints[h1] ^ fingerprints[h2]) == 0;
+}
+
 __device__ bool checkHash(const unsigned int hash[5])
 {
 	bool foundMatch = false;
@@ -291,6 +498,8 @@ __device__ bool checkHash(const unsigned int hash[5])
 		return checkBloomFilter(hash);
 	} else if(*_USE_BLOOM_FILTER == 2) {
 		return checkBloomFilter64(hash);
+	} else if(*_USE_BLOOM_FILTER == 3) {
+		return checkFuseFilter(hash);
 	} else {
 		for(int j = 0; j < *_NUM_TARGET_HASHES; j++) {
 			bool equal = true;
@@ -2,29 +2,66 @@
 #define _HASH_LOOKUP_HOST_H
 
 #include <cuda_runtime.h>
+#include <vector>
+#include "KeySearchTypes.h"
+#include "BloomFilterCounters.h"
+#include "BinaryFuseFilter.h"
+
+/**
+ Host side of a target lookup. It is built without touching the device, so a new
+ target set can be prepared on another thread while the kernels are running
+ */
+struct CudaTargetLookup {
+	// LookupStrategy that was built: LIST, BLOOM or FUSE32
+	int strategy = 0;
+
+	std::vector<struct hash160> constantTargets;
+
+	unsigned int bloomFilterBits = 0;
+	std::vector<unsigned int> bloomFilter;
+	BloomFilterCounters bloomCounters;
+
+	BinaryFuseFilter fuseFilter;
+};
 
 class CudaHashLookup {
 
 private:
 	unsigned int *_bloomFilterPtr;
 
-	cudaError_t setTargetBloomFilter(const std::vector<struct hash160> &targets);
+	unsigned int *_fuseFilterPtr;
+
+	unsigned long long _bloomFilterMask;
+
+	// Number of targets behind each bloom filter bit, for removing found targets
+	BloomFilterCounters _bloomCounters;
+
+	// Targets in constant memory
+	std::vector<struct hash160> _constantTargets;
+
+	cudaError_t setTargetBloomFilter(CudaTargetLookup &lookup);
 	
 	cudaError_t setTargetConstantMemory(const std::vector<struct hash160> &targets);
+
+	cudaError_t setTargetFuseFilter(const CudaTargetLookup &lookup);
+
+	static bool buildBloomFilter(const std::vector<struct hash160> &targets, double p, CudaTargetLookup &lookup);
+
+	static bool buildFuseFilter(const std::vector<struct hash160> &targets, CudaTargetLookup &lookup);
 	
-	unsigned int getOptimalBloomFilterBits(double p, size_t n);
+	static unsigned int getOptimalBloomFilterBits(double p, size_t n);
 
 	void cleanup();
 
-	void initializeBloomFilter(const std::vector<struct hash160> &targets, unsigned int *filter, unsigned int mask);
-	
-	void initializeBloomFilter64(const std::vector<struct hash160> &targets, unsigned int *filter, unsigned long long mask);
+	static void getBloomFilterIndices(const unsigned int hash[5], unsigned long long mask, unsigned long long idx[5]);
 
 public:
 
 	CudaHashLookup()
 	{
 		_bloomFilterPtr = NULL;
+		_fuseFilterPtr = NULL;
+		_bloomFilterMask = 0;
 	}
 
 	~CudaHashLookup()
@@ -32,7 +69,27 @@ public:
 		cleanup();
 	}
 
-	cudaError_t setTargets(const std::vector<struct hash160> &targets);
+	// Most targets that fit in constant memory
+	static const size_t MAX_LIST_TARGETS = 16;
+
+	// False positive rate the bloom filter is sized for unless the caller asks for another
+	static constexpr double DEFAULT_FALSE_POSITIVE_RATE = 1.0e-9;
+
+	// Bits per target in the bloom filter for n targets and false positive rate p
+	static double getBloomFilterBitsPerKey(size_t n, double p);
+
+	// strategy is the LookupStrategy to use: LIST, BLOOM or FUSE32. p is the false positive
+	// rate of the bloom filter
+	cudaError_t setTargets(const std::vector<struct hash160> &targets, int strategy, double p);
+
+	// Builds the lookup in host memory only. Safe to call while kernels are running
+	static cudaError_t build(const std::vector<struct hash160> &targets, int strategy, double p, CudaTargetLookup &lookup);
+
+	// Replaces the lookup on the device. The counters are moved out of lookup
+	cudaError_t upload(CudaTargetLookup &lookup);
+
+	// Removes a found target, hash is its RIPEMD160 digest
+	cudaError_t removeTarget(const unsigned int hash[5]);
 };
 
 #endif
\ No newline at end of file
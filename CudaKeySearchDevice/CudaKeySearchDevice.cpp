@@ -3,6 +3,7 @@
 #include "util.h"
 #include "cudabridge.h"
 #include "AddressUtil.h"
+#include "LookupPlanner.h"
 
 void CudaKeySearchDevice::cudaCall(cudaError_t err)
 {
@@ -53,12 +54,82 @@ CudaKeySearchDevice::CudaKeySearchDevice(int device, int threads, int pointsPerT
 
     _iterations = 0;
 
+    _allocated = false;
+
+    _targetFilter = TargetFilterType::AUTO;
+
+    _falsePositiveRate = CudaHashLookup::DEFAULT_FALSE_POSITIVE_RATE;
+
     _device = device;
 
     _pointsPerThread = pointsPerThread;
 }
 
 void CudaKeySearchDevice::init(const secp256k1::uint256 &start, int compression, const secp256k1::uint256 &stride)
+{
+    prepareDevice(start, compression, stride);
+
+    generateStartingPoints();
+
+    setupSearch();
+}
+
+size_t CudaKeySearchDevice::getPointsSize()
+{
+    return (size_t)_blocks * _threads * _pointsPerThread * 8 * sizeof(unsigned int) * 2;
+}
+
+void CudaKeySearchDevice::savePoints(void *buf)
+{
+    unsigned int *x = (unsigned int *)buf;
+    unsigned int *y = x + (size_t)_blocks * _threads * _pointsPerThread * 8;
+
+    cudaCall(_deviceKeys.getPublicKeys(x, y));
+}
+
+void CudaKeySearchDevice::initFromPoints(const secp256k1::uint256 &start, int compression, const secp256k1::uint256 &stride, uint64_t iterations, const void *buf)
+{
+    prepareDevice(start, compression, stride);
+
+    _iterations = iterations;
+
+    const unsigned int *x = (const unsigned int *)buf;
+    const unsigned int *y = x + (size_t)_blocks * _threads * _pointsPerThread * 8;
+
+    cudaCall(_deviceKeys.setPublicKeys(_blocks, _threads, _pointsPerThread, x, y));
+
+    setupSearch();
+}
+
+void CudaKeySearchDevice::jump(const secp256k1::uint256 &key)
+{
+    if(key.cmp(secp256k1::N) >= 0) {
+        throw KeySearchException("Key is out of range");
+    }
+
+    secp256k1::uint256 offset = secp256k1::subModN(key, getNextKey());
+
+    if(!offset.isZero()) {
+        // The jump is added with the incrementor, setupSearch() puts the step back
+        secp256k1::ecpoint p = secp256k1::multiplyPoint(offset, secp256k1::G());
+
+        cudaCall(setIncrementorPoint(p.x, p.y));
+
+        try {
+            callAddPointKernel(_blocks, _threads, _pointsPerThread);
+        } catch(cuda::CudaException ex) {
+            throw KeySearchException(ex.msg);
+        }
+    }
+
+    _startExponent = key;
+
+    _iterations = 0;
+
+    setupSearch();
+}
+
+void CudaKeySearchDevice::prepareDevice(const secp256k1::uint256 &start, int compression, const secp256k1::uint256 &stride)
 {
     if(start.cmp(secp256k1::N) >= 0) {
         throw KeySearchException("Starting key is out of range");
@@ -70,24 +141,33 @@ void CudaKeySearchDevice::init(const secp256k1::uint256 &start, int compression,
 
     _stride = stride;
 
+    _iterations = 0;
+
     cudaCall(cudaSetDevice(_device));
 
-    // Block on kernel calls
-    cudaCall(cudaSetDeviceFlags(cudaDeviceScheduleBlockingSync));
+    if(!_allocated) {
+        // Block on kernel calls
+        cudaCall(cudaSetDeviceFlags(cudaDeviceScheduleBlockingSync));
+
+        // Use a larger portion of shared memory for L1 cache
+        cudaCall(cudaDeviceSetCacheConfig(cudaFuncCachePreferL1));
+    }
+}
 
-    // Use a larger portion of shared memory for L1 cache
-    cudaCall(cudaDeviceSetCacheConfig(cudaFuncCachePreferL1));
+void CudaKeySearchDevice::setupSearch()
+{
+    if(!_allocated) {
+        cudaCall(allocateChainBuf(_threads * _blocks * _pointsPerThread));
 
-    generateStartingPoints();
+        cudaCall(_resultList.init(sizeof(CudaDeviceResult), CandidateVerifier::resultCapacity(hashesPerStep(), _falsePositiveRate)));
 
-    cudaCall(allocateChainBuf(_threads * _blocks * _pointsPerThread));
+        _allocated = true;
+    }
 
     // Set the incrementor
     secp256k1::ecpoint g = secp256k1::G();
     secp256k1::ecpoint p = secp256k1::multiplyPoint(secp256k1::uint256((uint64_t)_threads * _blocks * _pointsPerThread) * _stride, g);
 
-    cudaCall(_resultList.init(sizeof(CudaDeviceResult), 16));
-
     cudaCall(setIncrementorPoint(p.x, p.y));
 }
 
@@ -130,16 +210,101 @@ void CudaKeySearchDevice::generateStartingPoints()
 }
 
 
-void CudaKeySearchDevice::setTargets(const std::set<KeySearchTarget> &targets)
+/**
+Chooses the lookup for the targets and builds it in host memory. Does not touch
+the lookup on the device, so it can run while the kernels do
+*/
+void CudaKeySearchDevice::buildTargets(const TargetSet &targetSet, CudaTargetLookup &lookup)
+{
+    // The device is per thread and this may not be the search thread
+    cudaCall(cudaSetDevice(_device));
+
+    size_t freeMem = 0;
+    size_t totalMem = 0;
+    cudaCall(cudaMemGetInfo(&freeMem, &totalMem));
+
+    LookupConstraints constraints;
+    constraints.strategies = (1 << LookupStrategy::LIST) | (1 << LookupStrategy::BLOOM) | (1 << LookupStrategy::FUSE32);
+    constraints.maxListSize = CudaHashLookup::MAX_LIST_TARGETS;
+    constraints.memoryBudget = freeMem;
+    constraints.bloomBitsPerKey = CudaHashLookup::getBloomFilterBitsPerKey(targetSet.size(), _falsePositiveRate);
+    constraints.bloomHashes = 5;
+    constraints.bloomBlocked = false;
+    constraints.benchmark = false;
+
+    LookupPlan plan = LookupPlanner::plan(targetSet, constraints, _targetFilter);
+    LookupPlanner::log(plan, targetSet.size());
+
+    std::vector<hash160> targets;
+    targetSet.getTargets(targets);
+
+    cudaCall(CudaHashLookup::build(targets, plan.strategy, _falsePositiveRate, lookup));
+}
+
+void CudaKeySearchDevice::setTargets(const TargetSet &targets)
+{
+    CudaTargetLookup lookup;
+
+    buildTargets(targets, lookup);
+
+    cudaCall(_targetLookup.upload(lookup));
+
+    _targets = targets;
+}
+
+void CudaKeySearchDevice::prepareTargets(const TargetSet &targets)
+{
+    std::unique_ptr<CudaTargetLookup> lookup(new CudaTargetLookup());
+
+    buildTargets(targets, *lookup);
+
+    std::lock_guard<std::mutex> lock(_pendingMutex);
+
+    _pendingLookup = std::move(lookup);
+    _pendingTargets = targets;
+}
+
+bool CudaKeySearchDevice::swapTargets()
+{
+    std::lock_guard<std::mutex> lock(_pendingMutex);
+
+    if(!_pendingLookup) {
+        return false;
+    }
+
+    cudaCall(_targetLookup.upload(*_pendingLookup));
+
+    _targets = _pendingTargets;
+
+    _pendingLookup.reset();
+    _pendingTargets.clear();
+
+    return true;
+}
+
+void CudaKeySearchDevice::setFalsePositiveRate(double rate)
+{
+    _falsePositiveRate = rate > 0.0 ? rate : CudaHashLookup::DEFAULT_FALSE_POSITIVE_RATE;
+}
+
+void CudaKeySearchDevice::setVerifyThreads(int threads)
+{
+    _verifier.setThreads(threads);
+}
+
+KeySearchVerifierStats CudaKeySearchDevice::getVerifierStats()
+{
+    return _verifier.getStats();
+}
+
+void CudaKeySearchDevice::setTargetFilter(int filter)
 {
-    _targets.clear();
-    
-    for(std::set<KeySearchTarget>::iterator i = targets.begin(); i != targets.end(); ++i) {
-        hash160 h(i->value);
-        _targets.push_back(h);
+    if(filter == TargetFilterType::FUSE8 || filter == TargetFilterType::FUSE16) {
+        Logger::log(LogLevel::Warning, "CUDA devices use 32-bit fuse filter fingerprints");
+        filter = TargetFilterType::FUSE32;
     }
 
-    cudaCall(_targetLookup.setTargets(_targets));
+    _targetFilter = filter;
 }
 
 void CudaKeySearchDevice::doStep()
@@ -166,6 +331,11 @@ uint64_t CudaKeySearchDevice::keysPerStep()
     return (uint64_t)_blocks * _threads * _pointsPerThread;
 }
 
+uint64_t CudaKeySearchDevice::hashesPerStep()
+{
+    return keysPerStep() * (_compression == PointCompressionType::BOTH ? 2 : 1);
+}
+
 std::string CudaKeySearchDevice::getDeviceName()
 {
     return _deviceName;
@@ -176,33 +346,6 @@ void CudaKeySearchDevice::getMemoryInfo(uint64_t &freeMem, uint64_t &totalMem)
     cudaCall(cudaMemGetInfo(&freeMem, &totalMem));
 }
 
-void CudaKeySearchDevice::removeTargetFromList(const unsigned int hash[5])
-{
-    size_t count = _targets.size();
-
-    while(count) {
-        if(memcmp(hash, _targets[count - 1].h, 20) == 0) {
-            _targets.erase(_targets.begin() + count - 1);
-            return;
-        }
-        count--;
-    }
-}
-
-bool CudaKeySearchDevice::isTargetInList(const unsigned int hash[5])
-{
-    size_t count = _targets.size();
-
-    while(count) {
-        if(memcmp(hash, _targets[count - 1].h, 20) == 0) {
-            return true;
-        }
-        count--;
-    }
-
-    return false;
-}
-
 uint32_t CudaKeySearchDevice::getPrivateKeyOffset(int thread, int block, int idx)
 {
     // Total number of threads
@@ -218,84 +361,47 @@ uint32_t CudaKeySearchDevice::getPrivateKeyOffset(int thread, int block, int idx
 
 void CudaKeySearchDevice::getResultsInternal()
 {
-    int count = _resultList.size();
-    int actualCount = 0;
+    _verifier.addHashes(hashesPerStep());
+
+    unsigned int count = _resultList.size();
     if(count == 0) {
         return;
     }
 
-    unsigned char *ptr = new unsigned char[count * sizeof(CudaDeviceResult)];
+    if(count > _resultList.capacity()) {
+        Logger::log(LogLevel::Warning, util::formatThousands(count - _resultList.capacity()) + " filter hits did not fit in the results list and were not checked. Lower the filter false positive rate");
+        count = _resultList.capacity();
+    }
 
-    _resultList.read(ptr, count);
+    std::vector<CudaDeviceResult> deviceResults(count);
 
-    for(int i = 0; i < count; i++) {
-        struct CudaDeviceResult *rPtr = &((struct CudaDeviceResult *)ptr)[i];
+    _resultList.read(deviceResults.data(), count);
 
-        // might be false-positive
-        if(!isTargetInList(rPtr->digest)) {
-            continue;
-        }
-        actualCount++;
+    std::vector<KeySearchCandidate> candidates(count);
 
-        KeySearchResult minerResult;
+    for(unsigned int i = 0; i < count; i++) {
+        const CudaDeviceResult &r = deviceResults[i];
+        KeySearchCandidate &c = candidates[i];
 
         // Calculate the private key based on the number of iterations and the current thread
-        secp256k1::uint256 offset = (secp256k1::uint256((uint64_t)_blocks * _threads * _pointsPerThread * _iterations) + secp256k1::uint256(getPrivateKeyOffset(rPtr->thread, rPtr->block, rPtr->idx))) * _stride;
-        secp256k1::uint256 privateKey = secp256k1::addModN(_startExponent, offset);
-
-        minerResult.privateKey = privateKey;
-        minerResult.compressed = rPtr->compressed;
+        secp256k1::uint256 offset = (secp256k1::uint256((uint64_t)_blocks * _threads * _pointsPerThread * _iterations) + secp256k1::uint256(getPrivateKeyOffset(r.thread, r.block, r.idx))) * _stride;
 
-        memcpy(minerResult.hash, rPtr->digest, 20);
-
-        minerResult.publicKey = secp256k1::ecpoint(secp256k1::uint256(rPtr->x, secp256k1::uint256::BigEndian), secp256k1::uint256(rPtr->y, secp256k1::uint256::BigEndian));
-
-        removeTargetFromList(rPtr->digest);
-
-        _results.push_back(minerResult);
+        c.privateKey = secp256k1::addModN(_startExponent, offset);
+        c.publicKey = secp256k1::ecpoint(secp256k1::uint256(r.x, secp256k1::uint256::BigEndian), secp256k1::uint256(r.y, secp256k1::uint256::BigEndian));
+        c.compressed = r.compressed;
+        memcpy(c.digest, r.digest, sizeof(c.digest));
     }
 
-    delete[] ptr;
-
     _resultList.clear();
 
-    // Reload the bloom filters
-    if(actualCount) {
-        cudaCall(_targetLookup.setTargets(_targets));
-    }
-}
-
-// Verify a private key produces the public key and hash
-bool CudaKeySearchDevice::verifyKey(const secp256k1::uint256 &privateKey, const secp256k1::ecpoint &publicKey, const unsigned int hash[5], bool compressed)
-{
-    secp256k1::ecpoint g = secp256k1::G();
-
-    secp256k1::ecpoint p = secp256k1::multiplyPoint(privateKey, g);
-
-    if(!(p == publicKey)) {
-        return false;
-    }
-
-    unsigned int xWords[8];
-    unsigned int yWords[8];
+    size_t found = _results.size();
 
-    p.x.exportWords(xWords, 8, secp256k1::uint256::BigEndian);
-    p.y.exportWords(yWords, 8, secp256k1::uint256::BigEndian);
-
-    unsigned int digest[5];
-    if(compressed) {
-        Hash::hashPublicKeyCompressed(xWords, yWords, digest);
-    } else {
-        Hash::hashPublicKey(xWords, yWords, digest);
-    }
+    // Most candidates are false positives
+    _verifier.verify(candidates, _targets, _results);
 
-    for(int i = 0; i < 5; i++) {
-        if(digest[i] != hash[i]) {
-            return false;
-        }
+    for(size_t i = found; i < _results.size(); i++) {
+        cudaCall(_targetLookup.removeTarget(_results[i].hash));
     }
-
-    return true;
 }
 
 size_t CudaKeySearchDevice::getResults(std::vector<KeySearchResult> &resultsOut)
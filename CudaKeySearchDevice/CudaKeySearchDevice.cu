@@ -258,4 +258,32 @@ __global__ void keyFinderKernel(int points, int compression)
 __global__ void keyFinderKernelWithDouble(int points, int compression)
 {
     doIterationWithDouble(points, compression);
+}
+
+/**
+* Adds the incrementor to every point without checking them
+*/
+__global__ void addPointKernel(int pointsPerThread)
+{
+    unsigned int *chain = _CHAIN[0];
+    unsigned int *xPtr = ec::getXPtr();
+    unsigned int *yPtr = ec::getYPtr();
+
+    unsigned int inverse[8] = {0,0,0,0,0,0,0,1};
+    for(int i = 0; i < pointsPerThread; i++) {
+        beginBatchAddWithDouble(_INC_X, _INC_Y, xPtr, chain, i, i, inverse);
+    }
+
+    doBatchInverse(inverse);
+
+    for(int i = pointsPerThread - 1; i >= 0; i--) {
+
+        unsigned int newX[8];
+        unsigned int newY[8];
+
+        completeBatchAddWithDouble(_INC_X, _INC_Y, xPtr, yPtr, i, i, chain, inverse, newX, newY);
+
+        writeInt(xPtr, i, newX);
+        writeInt(yPtr, i, newY);
+    }
 }
\ No newline at end of file
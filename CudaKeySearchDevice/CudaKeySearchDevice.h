@@ -2,12 +2,15 @@
 #define _CUDA_KEY_SEARCH_DEVICE
 
 #include "KeySearchDevice.h"
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <cuda_runtime.h>
 #include "secp256k1.h"
 #include "CudaDeviceKeys.h"
 #include "CudaHashLookup.h"
 #include "CudaAtomicList.h"
+#include "CandidateVerifier.h"
 #include "cudaUtil.h"
 
 // Structures that exist on both host and device side
@@ -43,10 +46,18 @@ private:
 
     uint64_t _iterations;
 
+    // The chain buffer and result list are sized by the launch geometry and kept across init() calls
+    bool _allocated;
+
     void cudaCall(cudaError_t err);
 
     void generateStartingPoints();
 
+    // The parts of init() before and after the starting points are made
+    void prepareDevice(const secp256k1::uint256 &start, int compression, const secp256k1::uint256 &stride);
+
+    void setupSearch();
+
     CudaDeviceKeys _deviceKeys;
 
     CudaAtomicList _resultList;
@@ -55,17 +66,29 @@ private:
 
     void getResultsInternal();
 
-    std::vector<hash160> _targets;
+    TargetSet _targets;
+
+    int _targetFilter;
+
+    // Lookup built by prepareTargets, uploaded by swapTargets
+    std::unique_ptr<CudaTargetLookup> _pendingLookup;
 
-    bool isTargetInList(const unsigned int hash[5]);
-    
-    void removeTargetFromList(const unsigned int hash[5]);
+    TargetSet _pendingTargets;
+
+    std::mutex _pendingMutex;
+
+    void buildTargets(const TargetSet &targetSet, CudaTargetLookup &lookup);
 
     uint32_t getPrivateKeyOffset(int thread, int block, int point);
 
     secp256k1::uint256 _stride;
 
-    bool verifyKey(const secp256k1::uint256 &privateKey, const secp256k1::ecpoint &publicKey, const unsigned int hash[5], bool compressed);
+    // Checks the filter hits against the targets on the host
+    CandidateVerifier _verifier;
+
+    double _falsePositiveRate;
+
+    uint64_t hashesPerStep();
 
 public:
 
@@ -75,7 +98,27 @@ public:
 
     virtual void doStep();
 
-    virtual void setTargets(const std::set<KeySearchTarget> &targets);
+    virtual size_t getPointsSize();
+
+    virtual void savePoints(void *buf);
+
+    virtual void initFromPoints(const secp256k1::uint256 &start, int compression, const secp256k1::uint256 &stride, uint64_t iterations, const void *buf);
+
+    virtual void jump(const secp256k1::uint256 &key);
+
+    virtual void setTargets(const TargetSet &targets);
+
+    virtual void prepareTargets(const TargetSet &targets);
+
+    virtual bool swapTargets();
+
+    virtual void setTargetFilter(int filter);
+
+    virtual void setFalsePositiveRate(double rate);
+
+    virtual void setVerifyThreads(int threads);
+
+    virtual KeySearchVerifierStats getVerifierStats();
 
     virtual size_t getResults(std::vector<KeySearchResult> &results);
 
@@ -3,6 +3,7 @@
 
 __global__ void keyFinderKernel(int points, int compression);
 __global__ void keyFinderKernelWithDouble(int points, int compression);
+__global__ void addPointKernel(int points);
 
 void callKeyFinderKernel(int blocks, int threads, int points, bool useDouble, int compression)
 {
@@ -14,6 +15,12 @@ void callKeyFinderKernel(int blocks, int threads, int points, bool useDouble, in
 	waitForKernel();
 }
 
+void callAddPointKernel(int blocks, int threads, int points)
+{
+	addPointKernel <<<blocks, threads>>> (points);
+	waitForKernel();
+}
+
 
 void waitForKernel()
 {
@@ -10,6 +10,9 @@
 
 void callKeyFinderKernel(int blocks, int threads, int points, bool useDouble, int compression);
 
+// Adds the incrementor point to every point
+void callAddPointKernel(int blocks, int threads, int points);
+
 void waitForKernel();
 
 cudaError_t setIncrementorPoint(const secp256k1::uint256 &x, const secp256k1::uint256 &y);
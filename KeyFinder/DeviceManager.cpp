@@ -1,4 +1,5 @@
 #include "DeviceManager.h"
+#include "util.h"
 
 #ifdef BUILD_CUDA
 #include "cudaUtil.h"
@@ -57,5 +58,18 @@ std::vector<DeviceManager::DeviceInfo> DeviceManager::getDevices()
     }
 #endif
 
+    // The host CPU is always available as a search device
+    DeviceManager::DeviceInfo cpu;
+    cpu.name = "CPU";
+    cpu.type = DeviceType::CPU;
+    cpu.id = deviceId;
+    cpu.physicalId = 0;
+    cpu.memory = util::getTotalSystemMemory();
+    cpu.computeUnits = util::getCpuCount();
+    cpu.cudaMajor = 0;
+    cpu.cudaMinor = 0;
+    cpu.cudaCores = 0;
+    devices.push_back(cpu);
+
     return devices;
 }
\ No newline at end of file
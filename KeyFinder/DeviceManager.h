@@ -22,7 +22,8 @@ class DeviceType {
 public:
     enum {
         CUDA = 0,
-        OpenCL
+        OpenCL,
+        CPU
     };
 };
 
@@ -0,0 +1,443 @@
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+#include "BinaryFuseFilter.h"
+#include "field.h"
+
+namespace {
+
+    const int ARITY = 3;
+
+    const uint32_t MAX_SEGMENT_LENGTH = 262144;
+
+    // Seeds tried before giving up, each attempt fails with a small probability
+    const int MAX_ITERATIONS = 100;
+
+    const int PROBE_BATCH = 64;
+
+    inline void prefetch(const void *p)
+    {
+#if defined(__GNUC__)
+        __builtin_prefetch(p, 0, 3);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        _mm_prefetch((const char *)p, _MM_HINT_T0);
+#else
+        (void)p;
+#endif
+    }
+
+    uint64_t splitmix64(uint64_t &state)
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+        return z ^ (z >> 31);
+    }
+
+    inline uint64_t mulhi(uint64_t a, uint64_t b)
+    {
+        uint64_t hi;
+        secp256k1::mul64(a, b, hi);
+
+        return hi;
+    }
+
+    inline uint32_t fingerprint(uint64_t hash)
+    {
+        return (uint32_t)(hash ^ (hash >> 32));
+    }
+
+    inline uint8_t mod3(uint8_t x)
+    {
+        return x > 2 ? x - 3 : x;
+    }
+}
+
+BinaryFuseFilter::BinaryFuseFilter()
+    : _bits(0), _seed(0), _segmentLength(0), _segmentLengthMask(0), _segmentCount(0), _segmentCountLength(0), _arrayLength(0)
+{
+}
+
+uint64_t BinaryFuseFilter::key(const unsigned int hash[5])
+{
+    return ((uint64_t)hash[0] << 32) | hash[1];
+}
+
+uint64_t BinaryFuseFilter::mix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+
+    return x;
+}
+
+void BinaryFuseFilter::allocate(size_t count)
+{
+    // Segment length and size factor for arity 3, from the reference implementation
+    int64_t segmentLength = count == 0 ? 4 : (int64_t)1 << (int)floor(log((double)count) / log(3.33) + 2.25);
+
+    if(segmentLength > MAX_SEGMENT_LENGTH) {
+        segmentLength = MAX_SEGMENT_LENGTH;
+    }
+
+    double sizeFactor = count <= 1 ? 0.0 : std::max(1.125, 0.875 + 0.25 * log(1000000.0) / log((double)count));
+    int64_t capacity = count <= 1 ? 0 : (int64_t)llround((double)count * sizeFactor);
+
+    int64_t segmentCount = (capacity + segmentLength - 1) / segmentLength - (ARITY - 1);
+    int64_t arrayLength = (segmentCount + ARITY - 1) * segmentLength;
+
+    segmentCount = (arrayLength + segmentLength - 1) / segmentLength;
+    segmentCount = segmentCount <= ARITY - 1 ? 1 : segmentCount - (ARITY - 1);
+    arrayLength = (segmentCount + ARITY - 1) * segmentLength;
+
+    _segmentLength = (uint32_t)segmentLength;
+    _segmentLengthMask = (uint32_t)segmentLength - 1;
+    _segmentCount = (uint32_t)segmentCount;
+    _segmentCountLength = (uint32_t)(segmentCount * segmentLength);
+    _arrayLength = (uint32_t)arrayLength;
+
+    _fingerprints.assign((size_t)_arrayLength * (_bits / 8), 0);
+}
+
+uint32_t BinaryFuseFilter::position(int index, uint64_t hash) const
+{
+    uint64_t h = mulhi(hash, _segmentCountLength) + (uint64_t)index * _segmentLength;
+    uint64_t hh = hash & (((uint64_t)1 << 36) - 1);
+
+    h ^= (hh >> (36 - 18 * index)) & _segmentLengthMask;
+
+    return (uint32_t)h;
+}
+
+uint32_t BinaryFuseFilter::fingerprintAt(uint32_t i) const
+{
+    const uint8_t *p = _fingerprints.data();
+
+    switch(_bits) {
+        case 8:
+            return p[i];
+        case 16:
+            return ((const uint16_t *)p)[i];
+        default:
+            return ((const uint32_t *)p)[i];
+    }
+}
+
+void BinaryFuseFilter::setFingerprint(uint32_t i, uint32_t f)
+{
+    uint8_t *p = _fingerprints.data();
+
+    switch(_bits) {
+        case 8:
+            p[i] = (uint8_t)f;
+            break;
+        case 16:
+            ((uint16_t *)p)[i] = (uint16_t)f;
+            break;
+        default:
+            ((uint32_t *)p)[i] = f;
+            break;
+    }
+}
+
+void BinaryFuseFilter::init(size_t count, int fingerprintBits)
+{
+    _bits = fingerprintBits;
+    _seed = 0;
+
+    allocate(count);
+}
+
+bool BinaryFuseFilter::build(std::vector<uint64_t> &keys, int fingerprintBits)
+{
+    if(fingerprintBits != 8 && fingerprintBits != 16 && fingerprintBits != 32) {
+        return false;
+    }
+
+    size_t size = keys.size();
+
+    init(size, fingerprintBits);
+
+    uint64_t rngState = 0x726B2B9D438B9D4DULL;
+    _seed = splitmix64(rngState);
+
+    if(size == 0) {
+        return true;
+    }
+
+    // Keys sorted by segment, hashes that were peeled, and the slot each was peeled from
+    std::vector<uint64_t> reverseOrder(size + 1, 0);
+    std::vector<uint8_t> reverseH(size);
+
+    // Per slot: number of keys << 2 | XOR of the slot indices, and the XOR of the key hashes
+    std::vector<uint8_t> t2count(_arrayLength, 0);
+    std::vector<uint64_t> t2hash(_arrayLength, 0);
+    std::vector<uint32_t> alone(_arrayLength);
+
+    int blockBits = 1;
+    while(((uint32_t)1 << blockBits) < _segmentCount) {
+        blockBits++;
+    }
+
+    uint32_t block = (uint32_t)1 << blockBits;
+    std::vector<size_t> startPos(block);
+
+    size_t stackSize = 0;
+
+    for(int loop = 0; ; loop++) {
+        if(loop >= MAX_ITERATIONS) {
+            _fingerprints.clear();
+            return false;
+        }
+
+        reverseOrder[size] = 1;
+
+        // Bucket the hashes by segment so the counting pass walks memory in order
+        for(uint32_t i = 0; i < block; i++) {
+            startPos[i] = (size_t)(((uint64_t)i * size) >> blockBits);
+        }
+
+        for(size_t i = 0; i < size; i++) {
+            uint64_t hash = mix(keys[i] + _seed);
+            uint64_t segment = hash >> (64 - blockBits);
+
+            while(reverseOrder[startPos[segment]] != 0) {
+                segment = (segment + 1) & (block - 1);
+            }
+
+            reverseOrder[startPos[segment]] = hash;
+            startPos[segment]++;
+        }
+
+        bool error = false;
+        size_t duplicates = 0;
+
+        for(size_t i = 0; i < size; i++) {
+            uint64_t hash = reverseOrder[i];
+            uint32_t h0 = position(0, hash);
+            uint32_t h1 = position(1, hash);
+            uint32_t h2 = position(2, hash);
+
+            t2count[h0] += 4;
+            t2hash[h0] ^= hash;
+            t2count[h1] += 4;
+            t2count[h1] ^= 1;
+            t2hash[h1] ^= hash;
+            t2count[h2] += 4;
+            t2count[h2] ^= 2;
+            t2hash[h2] ^= hash;
+
+            // A key seen twice cancels itself out of all three slots
+            if((t2hash[h0] & t2hash[h1] & t2hash[h2]) == 0) {
+                if((t2hash[h0] == 0 && t2count[h0] == 8)
+                    || (t2hash[h1] == 0 && t2count[h1] == 8)
+                    || (t2hash[h2] == 0 && t2count[h2] == 8)) {
+                    duplicates++;
+                    t2count[h0] -= 4;
+                    t2hash[h0] ^= hash;
+                    t2count[h1] -= 4;
+                    t2count[h1] ^= 1;
+                    t2hash[h1] ^= hash;
+                    t2count[h2] -= 4;
+                    t2count[h2] ^= 2;
+                    t2hash[h2] ^= hash;
+                }
+            }
+
+            // The count overflowed
+            if(t2count[h0] < 4 || t2count[h1] < 4 || t2count[h2] < 4) {
+                error = true;
+            }
+        }
+
+        if(!error) {
+            // Peel slots that hold a single key
+            size_t queueSize = 0;
+
+            for(uint32_t i = 0; i < _arrayLength; i++) {
+                alone[queueSize] = i;
+                queueSize += (t2count[i] >> 2) == 1 ? 1 : 0;
+            }
+
+            stackSize = 0;
+
+            while(queueSize > 0) {
+                queueSize--;
+                uint32_t index = alone[queueSize];
+
+                if((t2count[index] >> 2) != 1) {
+                    continue;
+                }
+
+                uint64_t hash = t2hash[index];
+                uint32_t h012[5];
+                h012[1] = position(1, hash);
+                h012[2] = position(2, hash);
+                h012[3] = position(0, hash);
+                h012[4] = h012[1];
+
+                uint8_t found = t2count[index] & 3;
+                reverseH[stackSize] = found;
+                reverseOrder[stackSize] = hash;
+                stackSize++;
+
+                uint32_t other1 = h012[found + 1];
+                alone[queueSize] = other1;
+                queueSize += (t2count[other1] >> 2) == 2 ? 1 : 0;
+                t2count[other1] -= 4;
+                t2count[other1] ^= mod3(found + 1);
+                t2hash[other1] ^= hash;
+
+                uint32_t other2 = h012[found + 2];
+                alone[queueSize] = other2;
+                queueSize += (t2count[other2] >> 2) == 2 ? 1 : 0;
+                t2count[other2] -= 4;
+                t2count[other2] ^= mod3(found + 2);
+                t2hash[other2] ^= hash;
+            }
+
+            if(stackSize + duplicates == size) {
+                break;
+            }
+
+            if(duplicates > 0) {
+                std::sort(keys.begin(), keys.end());
+                keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+                size = keys.size();
+            }
+        }
+
+        std::fill(reverseOrder.begin(), reverseOrder.end(), 0);
+        std::fill(t2count.begin(), t2count.end(), 0);
+        std::fill(t2hash.begin(), t2hash.end(), 0);
+
+        _seed = splitmix64(rngState);
+    }
+
+    // Assign the fingerprints in reverse peeling order
+    for(size_t i = stackSize; i-- > 0; ) {
+        uint64_t hash = reverseOrder[i];
+        uint8_t found = reverseH[i];
+
+        uint32_t h012[5];
+        h012[0] = position(0, hash);
+        h012[1] = position(1, hash);
+        h012[2] = position(2, hash);
+        h012[3] = h012[0];
+        h012[4] = h012[1];
+
+        setFingerprint(h012[found], fingerprint(hash) ^ fingerprintAt(h012[found + 1]) ^ fingerprintAt(h012[found + 2]));
+    }
+
+    return true;
+}
+
+bool BinaryFuseFilter::contains(uint64_t key) const
+{
+    uint64_t hash = mix(key + _seed);
+    uint32_t f = fingerprint(hash);
+
+    uint32_t h0 = (uint32_t)mulhi(hash, _segmentCountLength);
+    uint32_t h1 = (h0 + _segmentLength) ^ ((uint32_t)(hash >> 18) & _segmentLengthMask);
+    uint32_t h2 = (h0 + 2 * _segmentLength) ^ ((uint32_t)hash & _segmentLengthMask);
+
+    f ^= fingerprintAt(h0) ^ fingerprintAt(h1) ^ fingerprintAt(h2);
+
+    if(_bits < 32) {
+        f &= ((uint32_t)1 << _bits) - 1;
+    }
+
+    return f == 0;
+}
+
+bool BinaryFuseFilter::contains(const unsigned int hash[5]) const
+{
+    if(_fingerprints.empty()) {
+        return false;
+    }
+
+    return contains(key(hash));
+}
+
+void BinaryFuseFilter::probe(const unsigned int *hashes, int count, uint64_t *mask) const
+{
+    uint64_t keys[PROBE_BATCH];
+    int bytes = _bits / 8;
+
+    memset(mask, 0, sizeof(uint64_t) * ((count + 63) / 64));
+
+    if(_fingerprints.empty()) {
+        return;
+    }
+
+    for(int i = 0; i < count; i += PROBE_BATCH) {
+        int n = count - i < PROBE_BATCH ? count - i : PROBE_BATCH;
+
+        // Request all three entries for every key before reading any of them
+        for(int j = 0; j < n; j++) {
+            keys[j] = key(&hashes[(i + j) * 5]);
+
+            uint64_t hash = mix(keys[j] + _seed);
+            uint32_t h0 = (uint32_t)mulhi(hash, _segmentCountLength);
+
+            prefetch(&_fingerprints[(size_t)h0 * bytes]);
+            prefetch(&_fingerprints[(size_t)((h0 + _segmentLength) ^ ((uint32_t)(hash >> 18) & _segmentLengthMask)) * bytes]);
+            prefetch(&_fingerprints[(size_t)((h0 + 2 * _segmentLength) ^ ((uint32_t)hash & _segmentLengthMask)) * bytes]);
+        }
+
+        for(int j = 0; j < n; j++) {
+            if(contains(keys[j])) {
+                mask[(i + j) / 64] |= (uint64_t)1 << ((i + j) % 64);
+            }
+        }
+    }
+}
+
+bool BinaryFuseFilter::empty() const
+{
+    return _fingerprints.empty();
+}
+
+int BinaryFuseFilter::fingerprintBits() const
+{
+    return _bits;
+}
+
+uint64_t BinaryFuseFilter::seed() const
+{
+    return _seed;
+}
+
+uint32_t BinaryFuseFilter::segmentLength() const
+{
+    return _segmentLength;
+}
+
+uint32_t BinaryFuseFilter::segmentCountLength() const
+{
+    return _segmentCountLength;
+}
+
+uint32_t BinaryFuseFilter::arrayLength() const
+{
+    return _arrayLength;
+}
+
+const void *BinaryFuseFilter::data() const
+{
+    return _fingerprints.data();
+}
+
+size_t BinaryFuseFilter::size() const
+{
+    return _fingerprints.size();
+}
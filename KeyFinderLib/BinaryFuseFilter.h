@@ -0,0 +1,94 @@
+#ifndef _BINARY_FUSE_FILTER_H
+#define _BINARY_FUSE_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ Static 3-wise binary fuse filter (Graf and Lemire, 2022). A key is in the
+ set when the XOR of the fingerprints at its three positions equals its own
+ fingerprint, so a lookup is three memory reads. The table takes about 1.13
+ entries per key, against roughly 1.44 * log2(1/p) bits per key for an
+ optimally sized Bloom filter, and the false positive rate is 2^-bits.
+
+ For a hash h[5], with k = (h[0] << 32) | h[1] and m the murmur64 finalizer:
+   x   = m(k + seed)
+   f   = x ^ (x >> 32), truncated to the fingerprint width
+   p0  = mulhi64(x, segmentCountLength)
+   p1  = (p0 + segmentLength) ^ ((x >> 18) & (segmentLength - 1))
+   p2  = (p0 + 2 * segmentLength) ^ (x & (segmentLength - 1))
+ The fingerprints are stored as a packed array of 8, 16 or 32-bit words.
+ The CUDA and OpenCL kernels implement the same lookup.
+ */
+class BinaryFuseFilter {
+
+private:
+
+    std::vector<uint8_t> _fingerprints;
+
+    int _bits;
+
+    uint64_t _seed;
+
+    uint32_t _segmentLength;
+
+    uint32_t _segmentLengthMask;
+
+    uint32_t _segmentCount;
+
+    uint32_t _segmentCountLength;
+
+    uint32_t _arrayLength;
+
+    void allocate(size_t count);
+
+    uint32_t position(int index, uint64_t hash) const;
+
+    uint32_t fingerprintAt(uint32_t i) const;
+
+    void setFingerprint(uint32_t i, uint32_t f);
+
+    bool contains(uint64_t key) const;
+
+public:
+
+    BinaryFuseFilter();
+
+    // The 64-bit key for a hash
+    static uint64_t key(const unsigned int hash[5]);
+
+    static uint64_t mix(uint64_t x);
+
+    // Sizes an empty filter for count keys with 8, 16 or 32-bit fingerprints. Used to
+    // time lookups without building the filter
+    void init(size_t count, int fingerprintBits);
+
+    // Builds the filter from the keys with 8, 16 or 32-bit fingerprints. Duplicate keys
+    // are allowed, the keys may be reordered. Returns false if the construction failed
+    bool build(std::vector<uint64_t> &keys, int fingerprintBits);
+
+    bool contains(const unsigned int hash[5]) const;
+
+    // Tests count hashes of 5 words each, in the same way as BlockedBloomFilter::probe
+    void probe(const unsigned int *hashes, int count, uint64_t *mask) const;
+
+    bool empty() const;
+
+    int fingerprintBits() const;
+
+    uint64_t seed() const;
+
+    uint32_t segmentLength() const;
+
+    uint32_t segmentCountLength() const;
+
+    uint32_t arrayLength() const;
+
+    const void *data() const;
+
+    // Size in bytes
+    size_t size() const;
+};
+
+#endif
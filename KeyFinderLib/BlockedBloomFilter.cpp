@@ -0,0 +1,127 @@
+#include <string.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+#include "BlockedBloomFilter.h"
+
+namespace {
+
+    // Hashes probed together, the blocks for all of them are requested before any is read
+    const int PROBE_BATCH = 64;
+
+    inline void prefetch(const void *p)
+    {
+#if defined(__GNUC__)
+        __builtin_prefetch(p, 0, 3);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        _mm_prefetch((const char *)p, _MM_HINT_T0);
+#else
+        (void)p;
+#endif
+    }
+
+    // Bit position within the block for hash function i
+    inline unsigned int bitIndex(const unsigned int hash[5], int i)
+    {
+        return (hash[1 + i / 3] >> (9 * (i % 3))) & 0x1ff;
+    }
+
+    inline bool testBlock(const uint32_t *block, const unsigned int hash[5])
+    {
+        uint32_t missing = 0;
+
+        for(int i = 0; i < BlockedBloomFilter::HASHES; i++) {
+            unsigned int bit = bitIndex(hash, i);
+
+            missing |= ~block[bit / 32] & (1u << (bit % 32));
+        }
+
+        return missing == 0;
+    }
+}
+
+BlockedBloomFilter::BlockedBloomFilter() : _blocks(0)
+{
+}
+
+void BlockedBloomFilter::init(size_t count, unsigned int bitsPerKey)
+{
+    uint64_t bits = (uint64_t)count * bitsPerKey;
+    uint64_t blocks = (bits + BLOCK_WORDS * 32 - 1) / (BLOCK_WORDS * 32);
+
+    if(blocks == 0) {
+        blocks = 1;
+    } else if(blocks > 0xffffffffULL) {
+        blocks = 0xffffffffULL;
+    }
+
+    _blocks = (uint32_t)blocks;
+    _words.assign((size_t)_blocks * BLOCK_WORDS, 0);
+}
+
+const uint32_t *BlockedBloomFilter::block(const unsigned int hash[5]) const
+{
+    uint64_t b = ((uint64_t)hash[0] * _blocks) >> 32;
+
+    return &_words[(size_t)b * BLOCK_WORDS];
+}
+
+void BlockedBloomFilter::insert(const unsigned int hash[5])
+{
+    uint32_t *b = const_cast<uint32_t *>(block(hash));
+
+    for(int i = 0; i < HASHES; i++) {
+        unsigned int bit = bitIndex(hash, i);
+
+        b[bit / 32] |= 1u << (bit % 32);
+    }
+}
+
+bool BlockedBloomFilter::contains(const unsigned int hash[5]) const
+{
+    return testBlock(block(hash), hash);
+}
+
+void BlockedBloomFilter::probe(const unsigned int *hashes, int count, uint64_t *mask) const
+{
+    const uint32_t *blocks[PROBE_BATCH];
+
+    memset(mask, 0, sizeof(uint64_t) * ((count + 63) / 64));
+
+    for(int i = 0; i < count; i += PROBE_BATCH) {
+        int n = count - i < PROBE_BATCH ? count - i : PROBE_BATCH;
+
+        for(int j = 0; j < n; j++) {
+            blocks[j] = block(&hashes[(i + j) * 5]);
+            prefetch(blocks[j]);
+        }
+
+        for(int j = 0; j < n; j++) {
+            if(testBlock(blocks[j], &hashes[(i + j) * 5])) {
+                mask[(i + j) / 64] |= (uint64_t)1 << ((i + j) % 64);
+            }
+        }
+    }
+}
+
+bool BlockedBloomFilter::empty() const
+{
+    return _blocks == 0;
+}
+
+uint32_t BlockedBloomFilter::blocks() const
+{
+    return _blocks;
+}
+
+const uint32_t *BlockedBloomFilter::data() const
+{
+    return _words.data();
+}
+
+size_t BlockedBloomFilter::size() const
+{
+    return _words.size() * sizeof(uint32_t);
+}
@@ -0,0 +1,59 @@
+#ifndef _BLOCKED_BLOOM_FILTER_H
+#define _BLOCKED_BLOOM_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ Bloom filter where every bit for a key falls in the same 64-byte block, so
+ a lookup touches one cache line instead of one per hash function.
+
+ Layout, shared with isInBloomFilter() in keysearch.cl:
+   uint32_t words[blocks * 16]
+
+ For a hash h[5] the block is (h[0] * blocks) >> 32 and the 12 bit
+ positions within the block are the three 9-bit fields at bits 0, 9 and 18
+ of each of h[1] to h[4]. The hashes are RIPEMD160 digests, so their words
+ are already uniformly distributed and are used directly.
+ */
+class BlockedBloomFilter {
+
+private:
+
+    std::vector<uint32_t> _words;
+
+    uint32_t _blocks;
+
+    const uint32_t *block(const unsigned int hash[5]) const;
+
+public:
+
+    static const int BLOCK_WORDS = 16;
+
+    static const int HASHES = 12;
+
+    BlockedBloomFilter();
+
+    // Sizes the filter for count keys at bitsPerKey bits each and clears it
+    void init(size_t count, unsigned int bitsPerKey);
+
+    void insert(const unsigned int hash[5]);
+
+    bool contains(const unsigned int hash[5]) const;
+
+    // Tests count hashes of 5 words each. Bit i of mask[i / 64] is set when hash i
+    // may be in the set. The blocks for the batch are prefetched before testing
+    void probe(const unsigned int *hashes, int count, uint64_t *mask) const;
+
+    bool empty() const;
+
+    uint32_t blocks() const;
+
+    const uint32_t *data() const;
+
+    // Size in bytes
+    size_t size() const;
+};
+
+#endif
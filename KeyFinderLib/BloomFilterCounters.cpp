@@ -0,0 +1,64 @@
+#include "BloomFilterCounters.h"
+
+namespace {
+
+    const uint64_t COUNTER_MAX = 3;
+}
+
+void BloomFilterCounters::init(uint64_t bits)
+{
+    _words.assign((size_t)((bits + 31) / 32), 0);
+}
+
+void BloomFilterCounters::add(uint64_t bit)
+{
+    uint64_t &word = _words[bit / 32];
+    int shift = (int)(bit % 32) * 2;
+
+    if(((word >> shift) & COUNTER_MAX) != COUNTER_MAX) {
+        word += (uint64_t)1 << shift;
+    }
+}
+
+bool BloomFilterCounters::remove(uint64_t bit)
+{
+    uint64_t &word = _words[bit / 32];
+    int shift = (int)(bit % 32) * 2;
+    uint64_t count = (word >> shift) & COUNTER_MAX;
+
+    // Saturated counters no longer know how many keys set the bit
+    if(count == 0 || count == COUNTER_MAX) {
+        return false;
+    }
+
+    word -= (uint64_t)1 << shift;
+
+    return count == 1;
+}
+
+uint32_t BloomFilterCounters::filterWord(uint64_t i) const
+{
+    uint64_t word = _words[i];
+
+    // Low bit of each counter is set when the counter is not zero
+    word = (word | (word >> 1)) & 0x5555555555555555ULL;
+
+    // Pack the even bits into the low 32
+    word = (word | (word >> 1)) & 0x3333333333333333ULL;
+    word = (word | (word >> 2)) & 0x0f0f0f0f0f0f0f0fULL;
+    word = (word | (word >> 4)) & 0x00ff00ff00ff00ffULL;
+    word = (word | (word >> 8)) & 0x0000ffff0000ffffULL;
+    word = (word | (word >> 16)) & 0x00000000ffffffffULL;
+
+    return (uint32_t)word;
+}
+
+bool BloomFilterCounters::empty() const
+{
+    return _words.empty();
+}
+
+size_t BloomFilterCounters::size() const
+{
+    return _words.size() * sizeof(uint64_t);
+}
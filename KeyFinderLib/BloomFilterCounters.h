@@ -0,0 +1,44 @@
+#ifndef _BLOOM_FILTER_COUNTERS_H
+#define _BLOOM_FILTER_COUNTERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ Host-side counts of how many keys set each bit of a Bloom filter, so a key
+ can be removed by clearing only the bits no other key needs and copying the
+ 32-bit filter words that changed, instead of rebuilding the filter.
+
+ Counters are 2 bits wide, twice the size of the filter itself. A counter
+ that reaches 3 stays there and its bit is never cleared. The filters are
+ sparse enough that few bits are shared by three keys, and a bit left set
+ only costs a false positive, never a missed key.
+ */
+class BloomFilterCounters {
+
+private:
+
+    // 32 counters per word, counter i is the two bits at 2 * (i % 32) in _words[i / 32]
+    std::vector<uint64_t> _words;
+
+public:
+
+    // Sizes the counters for a filter of bits bits and clears them
+    void init(uint64_t bits);
+
+    void add(uint64_t bit);
+
+    // Returns true when no key sets the bit any more
+    bool remove(uint64_t bit);
+
+    // Filter word i, with bit j set when counter 32 * i + j is not zero
+    uint32_t filterWord(uint64_t i) const;
+
+    bool empty() const;
+
+    // Size in bytes
+    size_t size() const;
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#include "CandidateVerifier.h"
+#include "AddressUtil.h"
+#include "Logger.h"
+#include "util.h"
+
+namespace {
+
+    // Smallest result list, enough for the targets found in one step
+    const uint32_t MIN_RESULT_CAPACITY = 64;
+
+    const uint32_t MAX_RESULT_CAPACITY = 1 << 20;
+}
+
+CandidateVerifier::CandidateVerifier()
+{
+    _threads = 1;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void CandidateVerifier::setThreads(int threads)
+{
+    _threads = threads > 0 ? threads : util::getCpuCount();
+    _pool.reset();
+}
+
+void CandidateVerifier::addHashes(uint64_t count)
+{
+    _stats.hashes += count;
+}
+
+KeySearchVerifierStats CandidateVerifier::getStats() const
+{
+    return _stats;
+}
+
+uint32_t CandidateVerifier::resultCapacity(uint64_t hashesPerStep, double falsePositiveRate)
+{
+    double expected = (double)hashesPerStep * falsePositiveRate;
+
+    // Several times the mean, the count of false positives per step is Poisson distributed
+    double capacity = MIN_RESULT_CAPACITY + 4.0 * expected;
+
+    return capacity >= MAX_RESULT_CAPACITY ? MAX_RESULT_CAPACITY : (uint32_t)capacity;
+}
+
+void CandidateVerifier::verifyBatch(const KeySearchCandidate *candidates, size_t count, const TargetSet &targets, std::vector<KeySearchResult> &results, KeySearchVerifierStats &stats)
+{
+    std::vector<size_t> hits;
+    std::vector<secp256k1::uint256> keys;
+
+    for(size_t i = 0; i < count; i++) {
+        if(targets.contains(candidates[i].digest)) {
+            hits.push_back(i);
+            keys.push_back(candidates[i].privateKey);
+        }
+    }
+
+    stats.candidates += count;
+    stats.falsePositives += count - hits.size();
+
+    if(hits.empty()) {
+        return;
+    }
+
+    std::vector<secp256k1::ecpoint> points;
+    secp256k1::multiplyGBatch(keys, points, 1);
+
+    for(size_t i = 0; i < hits.size(); i++) {
+        const KeySearchCandidate &c = candidates[hits[i]];
+
+        unsigned int xWords[8];
+        unsigned int yWords[8];
+        unsigned int digest[5];
+
+        points[i].x.exportWords(xWords, 8, secp256k1::uint256::BigEndian);
+        points[i].y.exportWords(yWords, 8, secp256k1::uint256::BigEndian);
+
+        if(c.compressed) {
+            Hash::hashPublicKeyCompressed(xWords, yWords, digest);
+        } else {
+            Hash::hashPublicKey(xWords, yWords, digest);
+        }
+
+        if(!(points[i] == c.publicKey) || memcmp(digest, c.digest, sizeof(digest)) != 0) {
+            Logger::log(LogLevel::Error, "Device reported key " + c.privateKey.toString() + " for a target it does not match");
+            stats.rejected++;
+            continue;
+        }
+
+        KeySearchResult r;
+        r.privateKey = c.privateKey;
+        r.publicKey = c.publicKey;
+        r.compressed = c.compressed;
+        memcpy(r.hash, c.digest, sizeof(r.hash));
+
+        results.push_back(r);
+    }
+}
+
+void CandidateVerifier::verify(const std::vector<KeySearchCandidate> &candidates, TargetSet &targets, std::vector<KeySearchResult> &results)
+{
+    if(candidates.empty()) {
+        return;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    int batches = (int)((candidates.size() + BATCH_SIZE - 1) / BATCH_SIZE);
+
+    std::vector<std::vector<KeySearchResult>> batchResults(batches);
+    std::vector<KeySearchVerifierStats> batchStats(batches);
+    memset(batchStats.data(), 0, sizeof(KeySearchVerifierStats) * batches);
+
+    auto job = [&](int b) {
+        size_t begin = (size_t)b * BATCH_SIZE;
+        size_t count = std::min(BATCH_SIZE, candidates.size() - begin);
+
+        verifyBatch(&candidates[begin], count, targets, batchResults[b], batchStats[b]);
+    };
+
+    if(batches == 1 || _threads == 1) {
+        for(int b = 0; b < batches; b++) {
+            job(b);
+        }
+    } else {
+        // Created on first use, most steps report nothing
+        if(!_pool) {
+            _pool.reset(new util::ThreadPool(_threads));
+        }
+
+        _pool->parallelFor(batches, job);
+    }
+
+    for(int b = 0; b < batches; b++) {
+        _stats.candidates += batchStats[b].candidates;
+        _stats.falsePositives += batchStats[b].falsePositives;
+        _stats.rejected += batchStats[b].rejected;
+
+        for(size_t i = 0; i < batchResults[b].size(); i++) {
+            // Drops a target reported twice, or already found by another device
+            if(targets.remove(batchResults[b][i].hash)) {
+                results.push_back(batchResults[b][i]);
+            }
+        }
+    }
+
+    _stats.time += (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
@@ -0,0 +1,64 @@
+#ifndef _CANDIDATE_VERIFIER_H
+#define _CANDIDATE_VERIFIER_H
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include "KeySearchDevice.h"
+#include "TargetSet.h"
+#include "ThreadPool.h"
+
+// A hash that passed a device filter. It may be a false positive
+typedef struct {
+    secp256k1::uint256 privateKey;
+    secp256k1::ecpoint publicKey;
+    unsigned int digest[5];
+    bool compressed;
+}KeySearchCandidate;
+
+/**
+ Host stage for the hits reported by a device filter. Candidates are split
+ into batches across a thread pool. Each batch is checked against the exact
+ target table, and the private keys of the remaining hits are multiplied in
+ one batch with a single inversion to confirm they produce the reported hash.
+
+ With a cheap host stage the device filters can be sized for a higher false
+ positive rate, trading device memory for host CPU.
+ */
+class CandidateVerifier {
+
+private:
+
+    std::unique_ptr<util::ThreadPool> _pool;
+
+    int _threads;
+
+    KeySearchVerifierStats _stats;
+
+    void verifyBatch(const KeySearchCandidate *candidates, size_t count, const TargetSet &targets, std::vector<KeySearchResult> &results, KeySearchVerifierStats &stats);
+
+public:
+
+    // Batches are verified on one thread up to this size
+    static const size_t BATCH_SIZE = 64;
+
+    CandidateVerifier();
+
+    // Threads in the pool, 0 for all cores
+    void setThreads(int threads);
+
+    // Hashes the device tested to report the candidates, for the measured false positive rate
+    void addHashes(uint64_t count);
+
+    // Appends the candidates that are targets and whose private key produces the digest, and
+    // removes them from targets. A target reported twice is only returned once
+    void verify(const std::vector<KeySearchCandidate> &candidates, TargetSet &targets, std::vector<KeySearchResult> &results);
+
+    KeySearchVerifierStats getStats() const;
+
+    // Size of a device result list that holds the false positives expected from hashesPerStep
+    // hashes with room to spare
+    static uint32_t resultCapacity(uint64_t hashesPerStep, double falsePositiveRate);
+};
+
+#endif
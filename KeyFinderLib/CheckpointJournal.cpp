@@ -0,0 +1,431 @@
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+
+#include "CheckpointJournal.h"
+#include "MappedFile.h"
+#include "Logger.h"
+#include "util.h"
+
+using namespace secp256k1;
+
+namespace {
+
+    // Header of a points file, followed by the points
+    struct PointsHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t compression;
+        uint64_t keysPerStep;
+        uint64_t iterations;
+        uint64_t size;
+        uint32_t start[8];
+        uint32_t stride[8];
+        char device[64];
+    };
+
+    const char POINTS_MAGIC[8] = {'B', 'R', 'P', 'O', 'I', 'N', 'T', 'S'};
+
+    const uint32_t POINTS_VERSION = 1;
+
+    void fillHeader(PointsHeader &h, KeySearchDevice *device, int compression, const CheckpointJournal::Worker &w)
+    {
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, POINTS_MAGIC, sizeof(h.magic));
+        h.version = POINTS_VERSION;
+        h.compression = (uint32_t)compression;
+        h.keysPerStep = device->keysPerStep();
+        h.iterations = w.iterations;
+        h.size = device->getPointsSize();
+        w.start.exportWords(h.start, 8);
+        w.stride.exportWords(h.stride, 8);
+        strncpy(h.device, w.device.c_str(), sizeof(h.device) - 1);
+    }
+
+    bool parseKey(const std::string &s, uint256 &k)
+    {
+        if(s.length() != 64 || !util::isHex(s)) {
+            return false;
+        }
+
+        k = uint256(s);
+        return true;
+    }
+}
+
+CheckpointJournal::CheckpointJournal()
+{
+    _lines = 0;
+}
+
+std::string CheckpointJournal::checksum(const std::string &text)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+
+    for(size_t i = 0; i < text.length(); i++) {
+        hash = (hash ^ (uint8_t)text[i]) * 16777619u;
+    }
+
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%08x", hash);
+
+    return std::string(buf);
+}
+
+std::string CheckpointJournal::formatLine(const std::string &text)
+{
+    return text + " " + checksum(text) + "\n";
+}
+
+bool CheckpointJournal::parseLine(const std::string &line, std::vector<std::string> &fields)
+{
+    size_t pos = line.rfind(' ');
+
+    if(pos == std::string::npos) {
+        return false;
+    }
+
+    std::string text = line.substr(0, pos);
+
+    if(line.substr(pos + 1) != checksum(text)) {
+        return false;
+    }
+
+    fields.clear();
+
+    std::istringstream in(text);
+    std::string field;
+    while(in >> field) {
+        fields.push_back(field);
+    }
+
+    // The device name is the rest of a worker line and may contain spaces
+    if(fields.size() > 7 && fields[0] == "worker") {
+        size_t p = 0;
+        for(int i = 0; i < 6; i++) {
+            p = text.find(' ', p) + 1;
+        }
+        fields.resize(6);
+        fields.push_back(text.substr(p));
+    }
+
+    return fields.size() > 0;
+}
+
+std::string CheckpointJournal::formatWorker(int worker, const Worker &w)
+{
+    return "worker " + util::format(worker) + " " + w.start.toString() + " " + w.stride.toString() + " "
+        + util::format(w.iterations) + " " + w.next.toString() + " " + w.device;
+}
+
+std::string CheckpointJournal::formatRange(const Range &r)
+{
+    return "done " + r.begin.toString() + " " + r.end.toString();
+}
+
+void CheckpointJournal::open(const std::string &fileName, const std::string &search)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _fileName = fileName;
+    _search = search;
+    _workers.clear();
+    _completed.clear();
+    _pending.clear();
+
+    read();
+
+    if(!rewrite()) {
+        throw KeySearchException("Cannot write checkpoint file " + _fileName);
+    }
+}
+
+void CheckpointJournal::read()
+{
+    std::ifstream in(_fileName.c_str(), std::ios::binary);
+
+    if(!in.is_open()) {
+        return;
+    }
+
+    std::string line;
+    std::vector<std::string> f;
+    bool header = true;
+    size_t skipped = 0;
+
+    while(std::getline(in, line)) {
+        if(line.empty()) {
+            continue;
+        }
+
+        if(!parseLine(line, f)) {
+            skipped++;
+            continue;
+        }
+
+        if(header) {
+            std::string search = line.substr(0, line.rfind(' '));
+
+            if(f[0] != "search" || search.substr(7) != _search) {
+                throw KeySearchException("Checkpoint file " + _fileName + " is for another search ("
+                    + (f[0] == "search" ? search.substr(7) : std::string("no header")) + "), remove it to start again");
+            }
+
+            header = false;
+            continue;
+        }
+
+        if(f[0] == "worker" && f.size() == 7) {
+            Worker w;
+            int worker = atoi(f[1].c_str());
+
+            if(parseKey(f[2], w.start) && parseKey(f[3], w.stride) && parseKey(f[5], w.next)) {
+                w.iterations = util::parseUInt64(f[4]);
+                w.device = f[6];
+                _workers[worker] = w;
+                continue;
+            }
+        } else if(f[0] == "done" && f.size() == 3) {
+            Range r;
+
+            if(parseKey(f[1], r.begin) && parseKey(f[2], r.end)) {
+                merge(_completed, r);
+                continue;
+            }
+        }
+
+        skipped++;
+    }
+
+    if(skipped > 0) {
+        Logger::log(LogLevel::Warning, "Skipped " + util::format((uint64_t)skipped) + " damaged lines in " + _fileName);
+    }
+
+    if(_workers.size() > 0 || _completed.size() > 0) {
+        Logger::log(LogLevel::Info, "Resuming from checkpoint " + _fileName);
+    }
+}
+
+void CheckpointJournal::merge(std::vector<Range> &ranges, const Range &r)
+{
+    if(r.end.cmp(r.begin) <= 0) {
+        return;
+    }
+
+    std::vector<Range> merged;
+    Range cur = r;
+    bool placed = false;
+
+    for(size_t i = 0; i < ranges.size(); i++) {
+        const Range &c = ranges[i];
+
+        if(c.end.cmp(cur.begin) < 0) {
+            merged.push_back(c);
+        } else if(cur.end.cmp(c.begin) < 0) {
+            if(!placed) {
+                merged.push_back(cur);
+                placed = true;
+            }
+            merged.push_back(c);
+        } else {
+            // Overlapping or touching
+            if(c.begin.cmp(cur.begin) < 0) {
+                cur.begin = c.begin;
+            }
+            if(c.end.cmp(cur.end) > 0) {
+                cur.end = c.end;
+            }
+        }
+    }
+
+    if(!placed) {
+        merged.push_back(cur);
+    }
+
+    ranges.swap(merged);
+}
+
+bool CheckpointJournal::rewrite()
+{
+    std::string text = formatLine("search " + _search);
+
+    for(size_t i = 0; i < _completed.size(); i++) {
+        text += formatLine(formatRange(_completed[i]));
+    }
+
+    for(std::map<int, Worker>::const_iterator i = _workers.begin(); i != _workers.end(); ++i) {
+        text += formatLine(formatWorker(i->first, i->second));
+    }
+
+    std::string tmp = _fileName + ".tmp";
+
+    FILE *fp = fopen(tmp.c_str(), "wb");
+    if(fp == NULL) {
+        return false;
+    }
+
+    bool ok = fwrite(text.c_str(), 1, text.length(), fp) == text.length() && util::syncFile(fp);
+
+    fclose(fp);
+
+    if(!ok || !util::replaceFile(tmp, _fileName)) {
+        return false;
+    }
+
+    _lines = 1 + _completed.size() + _workers.size();
+
+    return true;
+}
+
+bool CheckpointJournal::getWorker(int worker, Worker &w)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::map<int, Worker>::const_iterator i = _workers.find(worker);
+
+    if(i == _workers.end()) {
+        return false;
+    }
+
+    w = i->second;
+    return true;
+}
+
+std::vector<CheckpointJournal::Range> CheckpointJournal::getCompleted()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::vector<Range> ranges = _completed;
+
+    for(std::map<int, Worker>::const_iterator i = _workers.begin(); i != _workers.end(); ++i) {
+        Range r;
+        r.begin = i->second.start;
+        r.end = i->second.next;
+        merge(ranges, r);
+    }
+
+    return ranges;
+}
+
+void CheckpointJournal::update(int worker, const Worker &w)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _workers[worker] = w;
+    _pending += formatLine(formatWorker(worker, w));
+}
+
+void CheckpointJournal::addCompleted(const uint256 &begin, const uint256 &end)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    Range r;
+    r.begin = begin;
+    r.end = end;
+
+    merge(_completed, r);
+    _pending += formatLine(formatRange(r));
+}
+
+bool CheckpointJournal::flush()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if(_pending.empty()) {
+        return true;
+    }
+
+    // Everything in _pending is already in memory, so a rewrite includes it
+    if(_lines >= MAX_LINES) {
+        if(!rewrite()) {
+            return false;
+        }
+
+        _pending.clear();
+        return true;
+    }
+
+    FILE *fp = fopen(_fileName.c_str(), "ab");
+    if(fp == NULL) {
+        return false;
+    }
+
+    bool ok = fwrite(_pending.c_str(), 1, _pending.length(), fp) == _pending.length() && util::syncFile(fp);
+
+    fclose(fp);
+
+    if(!ok) {
+        // A partly written line would spoil the line after it, rewrite the file next time
+        _lines = MAX_LINES;
+        return false;
+    }
+
+    for(size_t i = 0; i < _pending.length(); i++) {
+        _lines += _pending[i] == '\n' ? 1 : 0;
+    }
+    _pending.clear();
+
+    return true;
+}
+
+std::string CheckpointJournal::getPointsFile(int worker) const
+{
+    return _fileName + ".worker" + util::format(worker) + ".points";
+}
+
+bool CheckpointJournal::savePoints(const std::string &fileName, KeySearchDevice *device, int compression, const Worker &w)
+{
+    PointsHeader h;
+    fillHeader(h, device, compression, w);
+
+    std::string tmp = fileName + ".tmp";
+
+    util::MappedFile file;
+
+    if(!file.create(tmp, sizeof(h) + h.size)) {
+        return false;
+    }
+
+    memcpy(file.writable(), &h, sizeof(h));
+
+    try {
+        device->savePoints(file.writable() + sizeof(h));
+    } catch(KeySearchException &ex) {
+        Logger::log(LogLevel::Warning, "Saving points: " + ex.msg);
+        return false;
+    }
+
+    bool ok = file.flush();
+
+    file.close();
+
+    // Points from an earlier checkpoint stay until the new ones are complete
+    return ok && util::replaceFile(tmp, fileName);
+}
+
+bool CheckpointJournal::loadPoints(const std::string &fileName, KeySearchDevice *device, int compression, const Worker &w)
+{
+    if(device->getPointsSize() == 0) {
+        return false;
+    }
+
+    util::MappedFile file;
+
+    if(!file.open(fileName) || file.size() < sizeof(PointsHeader)) {
+        return false;
+    }
+
+    PointsHeader expected;
+    fillHeader(expected, device, compression, w);
+
+    if(file.size() != sizeof(PointsHeader) + expected.size || memcmp(file.data(), &expected, sizeof(PointsHeader)) != 0) {
+        Logger::log(LogLevel::Info, fileName + " was saved at another position or with other settings, not using it");
+        return false;
+    }
+
+    device->initFromPoints(w.start, compression, w.stride, w.iterations, file.data() + sizeof(PointsHeader));
+
+    return true;
+}
@@ -0,0 +1,128 @@
+#ifndef _CHECKPOINT_JOURNAL_H
+#define _CHECKPOINT_JOURNAL_H
+
+#include <stdint.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "secp256k1.h"
+#include "KeySearchDevice.h"
+
+/**
+ Progress of a search, kept so a restarted search carries on where it stopped.
+
+ The journal is a text file. The first line describes the search, and each
+ line after it records the position of one worker or a range of keys that has
+ been searched. Lines are appended and synced to disk, and a later line for a
+ worker replaces the earlier one. Each line ends with a checksum, so a line
+ torn by a crash is skipped. Once the file has MAX_LINES lines it is rewritten
+ with one line per worker and the merged ranges, to a temporary file that is
+ renamed over it.
+
+ The points of each device can also be saved to a memory-mapped file next to
+ the journal. A device started from them does not generate its starting
+ points again.
+ */
+class CheckpointJournal {
+
+public:
+
+    // Position of the device of one worker
+    struct Worker {
+        std::string device;
+
+        // Key the device was started at
+        secp256k1::uint256 start;
+
+        secp256k1::uint256 stride;
+
+        // Steps since then
+        uint64_t iterations;
+
+        // First key not searched yet
+        secp256k1::uint256 next;
+    };
+
+    // Keys from begin up to but not including end
+    struct Range {
+        secp256k1::uint256 begin;
+        secp256k1::uint256 end;
+    };
+
+private:
+
+    std::string _fileName;
+
+    std::string _search;
+
+    std::map<int, Worker> _workers;
+
+    // Sorted, none overlap or touch
+    std::vector<Range> _completed;
+
+    // Lines not written yet
+    std::string _pending;
+
+    // Lines in the file
+    size_t _lines;
+
+    std::mutex _mutex;
+
+    static std::string checksum(const std::string &text);
+
+    static std::string formatLine(const std::string &text);
+
+    static bool parseLine(const std::string &line, std::vector<std::string> &fields);
+
+    static std::string formatWorker(int worker, const Worker &w);
+
+    static std::string formatRange(const Range &r);
+
+    void read();
+
+    // Adds r to ranges, which are sorted and do not overlap or touch
+    static void merge(std::vector<Range> &ranges, const Range &r);
+
+    bool rewrite();
+
+public:
+
+    static const size_t MAX_LINES = 10000;
+
+    CheckpointJournal();
+
+    // Reads the progress saved in fileName, if there is any, and rewrites the file. search
+    // describes the search. Throws KeySearchException if the file belongs to another
+    // search or cannot be written
+    void open(const std::string &fileName, const std::string &search);
+
+    // Gets the saved position of the worker. Returns false if there is none
+    bool getWorker(int worker, Worker &w);
+
+    // Ranges searched so far, including the keys behind each worker's position
+    std::vector<Range> getCompleted();
+
+    // Records the position of the worker. It is written at the next flush()
+    void update(int worker, const Worker &w);
+
+    // Records that the keys from begin up to end have been searched
+    void addCompleted(const secp256k1::uint256 &begin, const secp256k1::uint256 &end);
+
+    // Writes the changes since the last flush and waits until they are on disk. Returns
+    // false if they could not be written
+    bool flush();
+
+    // File the points of the worker are saved to
+    std::string getPointsFile(int worker) const;
+
+    // Saves the points of the device, which is at the position in w. Returns false if the
+    // file could not be written
+    static bool savePoints(const std::string &fileName, KeySearchDevice *device, int compression, const Worker &w);
+
+    // Starts the device from points saved at the position in w by a device with the same
+    // settings. Returns false if there are no such points
+    static bool loadPoints(const std::string &fileName, KeySearchDevice *device, int compression, const Worker &w);
+};
+
+#endif
@@ -0,0 +1,378 @@
+#include <stdio.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "CoverageIndex.h"
+#include "KeySearchDevice.h"
+#include "KeyspaceScheduler.h"
+#include "util.h"
+
+using namespace secp256k1;
+
+namespace {
+
+    const char *HEADER = "# bitrecover coverage index: start end stride (hex)";
+
+    bool startsBefore(const CoverageIndex::Range &a, const CoverageIndex::Range &b)
+    {
+        return a.start.cmp(b.start) < 0;
+    }
+
+    // Number of keys of start, start + stride ... below key
+    uint256 keysBefore(const uint256 &key, const uint256 &start, const uint256 &stride)
+    {
+        if(key.cmp(start) <= 0) {
+            return uint256(0);
+        }
+
+        return KeyspaceScheduler::divide(key - start + stride - uint256(1), stride);
+    }
+}
+
+CoverageIndex::CoverageIndex()
+{
+    _changed = false;
+}
+
+uint256 CoverageIndex::residue(const uint256 &key, const uint256 &stride)
+{
+    if(stride == uint256(1)) {
+        return uint256(0);
+    }
+
+    return key - KeyspaceScheduler::divide(key, stride) * stride;
+}
+
+void CoverageIndex::addRange(const Range &r)
+{
+    if(r.end.cmp(r.start) <= 0 || r.stride.isZero()) {
+        return;
+    }
+
+    // End on the lattice, so ranges that follow on touch
+    Range range = r;
+    range.end = r.start + keysBefore(r.end, r.start, r.stride) * r.stride;
+
+    uint256 res = residue(range.start, range.stride);
+
+    Group *g = NULL;
+    for(size_t i = 0; i < _groups.size(); i++) {
+        if(_groups[i].stride == range.stride && _groups[i].residue == res) {
+            g = &_groups[i];
+            break;
+        }
+    }
+
+    if(g == NULL) {
+        Group group;
+        group.stride = range.stride;
+        group.residue = res;
+        _groups.push_back(group);
+        g = &_groups.back();
+    }
+
+    std::vector<Range> merged;
+    bool placed = false;
+
+    for(size_t i = 0; i < g->ranges.size(); i++) {
+        const Range &c = g->ranges[i];
+
+        if(c.end.cmp(range.start) < 0) {
+            merged.push_back(c);
+        } else if(range.end.cmp(c.start) < 0) {
+            if(!placed) {
+                merged.push_back(range);
+                placed = true;
+            }
+            merged.push_back(c);
+        } else {
+            // Overlapping or touching
+            if(c.start.cmp(range.start) < 0) {
+                range.start = c.start;
+            }
+            if(c.end.cmp(range.end) > 0) {
+                range.end = c.end;
+            }
+        }
+    }
+
+    if(!placed) {
+        merged.push_back(range);
+    }
+
+    g->ranges.swap(merged);
+
+    _changed = true;
+}
+
+void CoverageIndex::read(const std::string &fileName)
+{
+    std::ifstream in(fileName.c_str());
+
+    if(!in.is_open()) {
+        return;
+    }
+
+    std::string line;
+    size_t lineNumber = 0;
+
+    while(std::getline(in, line)) {
+        lineNumber++;
+
+        util::removeNewline(line);
+        line = util::trim(line);
+
+        if(line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        std::string start;
+        std::string end;
+        std::string stride;
+        std::string extra;
+
+        fields >> start >> end >> stride;
+
+        bool valid = !stride.empty() && !(fields >> extra);
+
+        std::string values[3] = {start, end, stride};
+        for(int i = 0; i < 3 && valid; i++) {
+            valid = values[i].length() <= 64 && util::isHex(values[i]);
+        }
+
+        if(!valid) {
+            throw KeySearchException("Line " + util::format((uint64_t)lineNumber) + " of '" + fileName + "' is not a coverage range");
+        }
+
+        Range r;
+        r.start = uint256(start);
+        r.end = uint256(end);
+        r.stride = uint256(stride);
+
+        addRange(r);
+    }
+}
+
+void CoverageIndex::open(const std::string &fileName)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _groups.clear();
+    _fileName = fileName;
+
+    read(fileName);
+
+    _changed = false;
+}
+
+void CoverageIndex::add(const uint256 &start, const uint256 &end, const uint256 &stride)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    Range r;
+    r.start = start;
+    r.end = end;
+    r.stride = stride;
+
+    addRange(r);
+}
+
+void CoverageIndex::merge(const CoverageIndex &other)
+{
+    std::vector<Range> ranges = other.getRanges();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for(size_t i = 0; i < ranges.size(); i++) {
+        addRange(ranges[i]);
+    }
+}
+
+bool CoverageIndex::save()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if(_fileName.empty()) {
+        return false;
+    }
+
+    if(!_changed) {
+        return true;
+    }
+
+    // Keep the ranges other processes have added since the file was read
+    try {
+        read(_fileName);
+    } catch(KeySearchException &) {
+        return false;
+    }
+
+    std::string tmp = _fileName + ".tmp";
+
+    FILE *fp = fopen(tmp.c_str(), "wb");
+    if(fp == NULL) {
+        return false;
+    }
+
+    std::string text = std::string(HEADER) + "\n";
+
+    bool ok = fwrite(text.c_str(), 1, text.length(), fp) == text.length();
+
+    for(size_t i = 0; i < _groups.size() && ok; i++) {
+        for(size_t j = 0; j < _groups[i].ranges.size() && ok; j++) {
+            const Range &r = _groups[i].ranges[j];
+            text = r.start.toString() + " " + r.end.toString() + " " + r.stride.toString() + "\n";
+            ok = fwrite(text.c_str(), 1, text.length(), fp) == text.length();
+        }
+    }
+
+    ok = ok && util::syncFile(fp);
+
+    fclose(fp);
+
+    if(!ok || !util::replaceFile(tmp, _fileName)) {
+        return false;
+    }
+
+    _changed = false;
+
+    return true;
+}
+
+bool CoverageIndex::saveAs(const std::string &fileName)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _fileName = fileName;
+        _changed = true;
+    }
+
+    return save();
+}
+
+bool CoverageIndex::covers(const Group &g, const uint256 &key, const uint256 &stride) const
+{
+    return g.stride == uint256(1) || (g.stride == stride && g.residue == residue(key, stride));
+}
+
+bool CoverageIndex::contains(const uint256 &key) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for(size_t i = 0; i < _groups.size(); i++) {
+        const Group &g = _groups[i];
+
+        if(!(residue(key, g.stride) == g.residue)) {
+            continue;
+        }
+
+        Range k;
+        k.start = key;
+
+        // Last range starting at or before key
+        std::vector<Range>::const_iterator r = std::upper_bound(g.ranges.begin(), g.ranges.end(), k, startsBefore);
+
+        if(r != g.ranges.begin() && key.cmp((r - 1)->end) < 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint256 CoverageIndex::nextUncovered(const uint256 &key, const uint256 &stride) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    uint256 k = key;
+    bool moved = true;
+
+    // Skipping a range can land in a range of another group
+    while(moved) {
+        moved = false;
+
+        for(size_t i = 0; i < _groups.size(); i++) {
+            const Group &g = _groups[i];
+
+            if(!covers(g, k, stride)) {
+                continue;
+            }
+
+            Range r;
+            r.start = k;
+
+            std::vector<Range>::const_iterator c = std::upper_bound(g.ranges.begin(), g.ranges.end(), r, startsBefore);
+
+            if(c != g.ranges.begin() && k.cmp((c - 1)->end) < 0) {
+                k = k + keysBefore((c - 1)->end, k, stride) * stride;
+                moved = true;
+            }
+        }
+    }
+
+    return k;
+}
+
+std::vector<CoverageIndex::Range> CoverageIndex::getRanges(const uint256 &start, const uint256 &stride) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::vector<Range> ranges;
+
+    for(size_t i = 0; i < _groups.size(); i++) {
+        if(covers(_groups[i], start, stride)) {
+            ranges.insert(ranges.end(), _groups[i].ranges.begin(), _groups[i].ranges.end());
+        }
+    }
+
+    std::sort(ranges.begin(), ranges.end(), startsBefore);
+
+    return ranges;
+}
+
+std::vector<CoverageIndex::Range> CoverageIndex::getRanges() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::vector<Range> ranges;
+
+    for(size_t i = 0; i < _groups.size(); i++) {
+        ranges.insert(ranges.end(), _groups[i].ranges.begin(), _groups[i].ranges.end());
+    }
+
+    return ranges;
+}
+
+uint256 CoverageIndex::countCovered(const uint256 &start, const uint256 &end, const uint256 &stride) const
+{
+    std::vector<Range> ranges = getRanges(start, stride);
+
+    uint256 count(0);
+
+    // Ranges of different groups can overlap, count each key once
+    uint256 done = keysBefore(start, start, stride);
+    uint256 last = keysBefore(end, start, stride);
+
+    for(size_t i = 0; i < ranges.size(); i++) {
+        uint256 b = keysBefore(ranges[i].start, start, stride);
+        uint256 e = keysBefore(ranges[i].end, start, stride);
+
+        if(e.cmp(last) > 0) {
+            e = last;
+        }
+
+        if(b.cmp(done) < 0) {
+            b = done;
+        }
+
+        if(e.cmp(b) > 0) {
+            count = count + (e - b);
+            done = e;
+        }
+    }
+
+    return count;
+}
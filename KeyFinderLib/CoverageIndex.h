@@ -0,0 +1,96 @@
+#ifndef _COVERAGE_INDEX_H
+#define _COVERAGE_INDEX_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include "secp256k1.h"
+
+/**
+ Record of the parts of the keyspace that have been searched, kept across runs
+ and shared between machines.
+
+ A range is the keys start, start + stride ... below end. Ranges with the same
+ stride and the same start modulo the stride are merged when they overlap or
+ touch, so the index stays small however often progress is added. Lookups use
+ the ranges with stride 1 and those on the lattice being searched.
+
+ The file is text, one range per line, and is always written to a temporary
+ file that is renamed over it. save() reads the file again first, so ranges
+ merged into it by another process in the meantime are kept.
+ */
+class CoverageIndex {
+
+public:
+
+    struct Range {
+        secp256k1::uint256 start;
+        secp256k1::uint256 end;
+        secp256k1::uint256 stride;
+    };
+
+private:
+
+    // Ranges on one lattice, sorted by start, none overlap or touch
+    struct Group {
+        secp256k1::uint256 stride;
+        secp256k1::uint256 residue;
+        std::vector<Range> ranges;
+    };
+
+    std::vector<Group> _groups;
+
+    std::string _fileName;
+
+    // Ranges added since the last save()
+    bool _changed;
+
+    mutable std::mutex _mutex;
+
+    void addRange(const Range &r);
+
+    void read(const std::string &fileName);
+
+    // Groups whose ranges cover every key of the lattice of stride through key
+    bool covers(const Group &g, const secp256k1::uint256 &key, const secp256k1::uint256 &stride) const;
+
+    static secp256k1::uint256 residue(const secp256k1::uint256 &key, const secp256k1::uint256 &stride);
+
+public:
+
+    CoverageIndex();
+
+    // Loads the ranges in fileName, which later save() calls write to. A missing file is an
+    // empty index. Throws KeySearchException if the file is not a coverage index
+    void open(const std::string &fileName);
+
+    // Adds the keys start, start + stride ... below end
+    void add(const secp256k1::uint256 &start, const secp256k1::uint256 &end, const secp256k1::uint256 &stride);
+
+    // Adds all the ranges of another index
+    void merge(const CoverageIndex &other);
+
+    // Writes the ranges to the file given to open(). Returns false if it could not be written
+    bool save();
+
+    // Writes the ranges to fileName. Returns false if it could not be written
+    bool saveAs(const std::string &fileName);
+
+    // True if key has been searched
+    bool contains(const secp256k1::uint256 &key) const;
+
+    // First of key, key + stride ... that has not been searched
+    secp256k1::uint256 nextUncovered(const secp256k1::uint256 &key, const secp256k1::uint256 &stride) const;
+
+    // Ranges that cover every key of start + i * stride inside them, sorted by start. They
+    // may overlap
+    std::vector<Range> getRanges(const secp256k1::uint256 &start, const secp256k1::uint256 &stride) const;
+
+    // All ranges
+    std::vector<Range> getRanges() const;
+
+    // Number of keys start, start + stride ... below end that have been searched
+    secp256k1::uint256 countCovered(const secp256k1::uint256 &start, const secp256k1::uint256 &end, const secp256k1::uint256 &stride) const;
+};
+
+#endif
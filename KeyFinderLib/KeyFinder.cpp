@@ -2,6 +2,8 @@
 #include <iostream>
 
 #include "KeyFinder.h"
+#include "TargetDatabase.h"
+#include "TargetFileParser.h"
 #include "util.h"
 #include "AddressUtil.h"
 
@@ -37,69 +39,145 @@ KeyFinder::KeyFinder(const secp256k1::uint256 &startKey, const secp256k1::uint25
     _iterCount = 0;
 
     _stride = stride;
+
+	_targetsPending = false;
+
+	_scheduler = NULL;
+	_schedulerWorker = 0;
+	_hasUnit = false;
+
+	_journal = NULL;
+	_checkpointWorker = 0;
+	_checkpointInterval = 0;
+	_checkpointPoints = false;
+
+	_deviceSteps = 0;
+	_deviceStarted = false;
+
+	_jumpInterval = 0;
+
+	_coverage = NULL;
+	_coverageInterval = 0;
 }
 
 KeyFinder::~KeyFinder()
 {
 }
 
-void KeyFinder::setTargets(std::vector<std::string> &targets)
+void KeyFinder::parseTargets(const std::vector<std::string> &addresses, TargetSet &targets)
 {
-	if(targets.size() == 0) {
+	if(addresses.size() == 0) {
 		throw KeySearchException("Requires at least 1 target");
 	}
 
-	_targets.clear();
+	std::vector<KeySearchTarget> hashes;
 
 	// Convert each address from base58 encoded form to a 160-bit integer
-	for(unsigned int i = 0; i < targets.size(); i++) {
+	for(unsigned int i = 0; i < addresses.size(); i++) {
 
-		if(!Address::verifyAddress(targets[i])) {
-			throw KeySearchException("Invalid address '" + targets[i] + "'");
+		if(!Address::verifyAddress(addresses[i])) {
+			throw KeySearchException("Invalid address '" + addresses[i] + "'");
 		}
 
 		KeySearchTarget t;
 
-		Base58::toHash160(targets[i], t.value);
+		Base58::toHash160(addresses[i], t.value);
 
-		_targets.insert(t);
+		hashes.push_back(t);
 	}
 
+	targets.build(hashes);
+}
+
+void KeyFinder::setTargets(std::vector<std::string> &targets)
+{
+	parseTargets(targets, _targets);
+
     _device->setTargets(_targets);
 }
 
-void KeyFinder::setTargets(std::string targetsFile)
+void KeyFinder::setTargets(const TargetSet &targets)
+{
+	_targets = targets;
+
+    _device->setTargets(_targets);
+}
+
+void KeyFinder::reloadTargets(const TargetSet &targets)
 {
-	std::ifstream inFile(targetsFile.c_str());
+	// Build the new lookup on this thread while the search keeps running
+	_device->prepareTargets(targets);
+
+	std::lock_guard<std::mutex> lock(_pendingMutex);
 
-	if(!inFile.is_open()) {
-		Logger::log(LogLevel::Error, "Unable to open '" + targetsFile + "'");
-		throw KeySearchException();
+	_pendingTargets = targets;
+	_targetsPending = true;
+}
+
+void KeyFinder::swapPendingTargets()
+{
+	std::lock_guard<std::mutex> lock(_pendingMutex);
+
+	if(!_targetsPending) {
+		return;
+	}
+
+	_targetsPending = false;
+
+	if(!_device->swapTargets()) {
+		return;
 	}
 
-	_targets.clear();
+	// Targets found since the new set was loaded
+	_pendingTargets.removeFound(_targets);
 
-	std::string line;
-	Logger::log(LogLevel::Info, "Loading addresses from '" + targetsFile + "'");
-	while(std::getline(inFile, line)) {
-		util::removeNewline(line);
-        line = util::trim(line);
+	_targets = _pendingTargets;
+	_pendingTargets.clear();
 
-		if(line.length() > 0) {
-			if(!Address::verifyAddress(line)) {
-				Logger::log(LogLevel::Error, "Invalid address '" + line + "'");
-				throw KeySearchException();
-			}
+	Logger::log(LogLevel::Info, "Reloaded targets, " + util::formatThousands(_targets.size()) + " remaining");
+}
 
-			KeySearchTarget t;
+void KeyFinder::loadTargets(const std::string &targetsFile, TargetSet &targets)
+{
+	// Precompiled databases are mapped and searched in place
+	if(TargetDatabase::isDatabase(targetsFile)) {
+		Logger::log(LogLevel::Info, "Mapping target database '" + targetsFile + "'");
 
-			Base58::toHash160(line, t.value);
+		targets.build(TargetDatabase::open(targetsFile));
 
-			_targets.insert(t);
+		Logger::log(LogLevel::Info, util::formatThousands(targets.size()) + " targets mapped");
+	} else {
+		Logger::log(LogLevel::Info, "Loading addresses from '" + targetsFile + "'");
+
+		std::vector<KeySearchTarget> hashes;
+		std::vector<TargetFileParser::Error> errors;
+
+		uint64_t lines = TargetFileParser::parse(targetsFile, hashes, errors);
+
+		// Report bad lines but keep the valid ones
+		for(size_t i = 0; i < errors.size() && i < MAX_REPORTED_ERRORS; i++) {
+			Logger::log(LogLevel::Error, "Line " + util::formatThousands(errors[i].line) + ": invalid address '" + errors[i].text + "'");
+		}
+
+		if(errors.size() > MAX_REPORTED_ERRORS) {
+			Logger::log(LogLevel::Error, util::formatThousands(errors.size() - MAX_REPORTED_ERRORS) + " more invalid lines not shown");
 		}
+
+		targets.build(hashes);
+
+		Logger::log(LogLevel::Info, util::formatThousands(targets.size()) + " addresses loaded from "
+			+ util::formatThousands(lines) + " lines ("
+			+ util::format("%.1f", (double)targets.memoryUsage() / (double)(1024 * 1024)) + "MB)");
+	}
+
+	if(targets.size() == 0) {
+		throw KeySearchException("No targets in '" + targetsFile + "'");
 	}
-	Logger::log(LogLevel::Info, util::formatThousands(_targets.size()) + " addresses loaded ("
-		+ util::format("%.1f", (double)(sizeof(KeySearchTarget) * _targets.size()) / (double)(1024 * 1024)) + "MB)");
+}
+
+void KeyFinder::setTargets(std::string targetsFile)
+{
+	loadTargets(targetsFile, _targets);
 
     _device->setTargets(_targets);
 }
@@ -122,13 +200,6 @@ void KeyFinder::setStatusInterval(uint64_t interval)
 
 void KeyFinder::setTargetsOnDevice()
 {
-	// Set the target in constant memory
-	std::vector<struct hash160> targets;
-
-	for(std::set<KeySearchTarget>::iterator i = _targets.begin(); i != _targets.end(); ++i) {
-		targets.push_back(hash160((*i).value));
-	}
-
     _device->setTargets(_targets);
 }
 
@@ -136,7 +207,198 @@ void KeyFinder::init()
 {
 	Logger::log(LogLevel::Info, "Initializing " + _device->getDeviceName());
 
-    _device->init(_startKey, _compression, _stride);
+	CheckpointJournal::Worker saved;
+	bool hasSaved = _journal != NULL && _journal->getWorker(_checkpointWorker, saved);
+
+	// Keys behind the saved position stay searched whether or not this device carries on from it
+	if(hasSaved) {
+		_journal->addCompleted(saved.start, saved.next);
+	}
+
+	bool resume = hasSaved && saved.device == _device->getDeviceName() && saved.stride == _stride;
+
+	if(_scheduler != NULL) {
+		KeyspaceUnit unit;
+
+		if(resume && _scheduler->resume(_schedulerWorker, saved.next, unit)) {
+			resumeDevice(saved);
+			_startKey = saved.next;
+			_unitEnd = _scheduler->getKey(unit.end);
+			_hasUnit = true;
+		} else {
+			_hasUnit = nextUnit(true);
+		}
+		return;
+	}
+
+	if(resume) {
+		resumeDevice(saved);
+		_startKey = saved.next;
+		return;
+	}
+
+	// Start where the keys have not been searched yet
+	if(_coverage != NULL) {
+		secp256k1::uint256 start = _coverage->nextUncovered(_startKey, _stride);
+
+		if(!(start == _startKey)) {
+			Logger::log(LogLevel::Info, "Keys from " + _startKey.toString() + " have been searched, starting at " + start.toString());
+			_startKey = start;
+		}
+	}
+
+	startDevice(_startKey);
+}
+
+void KeyFinder::setCheckpoint(CheckpointJournal *journal, int worker, uint64_t intervalMs, bool savePoints)
+{
+	_journal = journal;
+	_checkpointWorker = worker;
+	_checkpointInterval = intervalMs;
+	_checkpointPoints = savePoints;
+}
+
+void KeyFinder::setJumpInterval(uint64_t intervalMs)
+{
+	_jumpInterval = intervalMs;
+}
+
+void KeyFinder::setCoverage(CoverageIndex *coverage, uint64_t intervalMs)
+{
+	_coverage = coverage;
+	_coverageInterval = intervalMs;
+}
+
+secp256k1::uint256 KeyFinder::randomKey()
+{
+	secp256k1::uint256 key;
+
+	do {
+		_rng.get((unsigned char *)key.v, sizeof(key.v));
+	} while(key.isZero() || key.cmp(secp256k1::N) >= 0);
+
+	return _coverage != NULL ? _coverage->nextUncovered(key, _stride) : key;
+}
+
+void KeyFinder::recordCoverage()
+{
+	if(_coverage == NULL || !_deviceStarted) {
+		return;
+	}
+
+	secp256k1::uint256 end = _device->getNextKey();
+
+	// The last step can run past the keyspace, those keys belong to another node
+	if(_scheduler != NULL && end.cmp(_scheduler->getEnd()) > 0) {
+		end = _scheduler->getEnd();
+	}
+
+	_coverage->add(_deviceStart, end, _stride);
+}
+
+void KeyFinder::leavePosition()
+{
+	if(!_deviceStarted) {
+		return;
+	}
+
+	if(_journal != NULL) {
+		_journal->addCompleted(_deviceStart, _device->getNextKey());
+	}
+
+	recordCoverage();
+}
+
+void KeyFinder::jump(const secp256k1::uint256 &key)
+{
+	leavePosition();
+
+	_device->jump(key);
+
+	_startKey = key;
+	_deviceStart = key;
+	_deviceSteps = 0;
+
+	Logger::log(LogLevel::Debug, _device->getDeviceName() + " jumped to " + key.toString());
+}
+
+void KeyFinder::startDevice(const secp256k1::uint256 &start)
+{
+	// The device is leaving the keys it was stepping through
+	leavePosition();
+
+	_device->init(start, _compression, _stride);
+
+	_deviceStart = start;
+	_deviceSteps = 0;
+	_deviceStarted = true;
+}
+
+void KeyFinder::resumeDevice(const CheckpointJournal::Worker &saved)
+{
+	if(_checkpointPoints && CheckpointJournal::loadPoints(_journal->getPointsFile(_checkpointWorker), _device, _compression, saved)) {
+		_deviceStart = saved.start;
+		_deviceSteps = saved.iterations;
+		_deviceStarted = true;
+
+		Logger::log(LogLevel::Info, "Restored the points of " + _device->getDeviceName() + " at " + saved.next.toString());
+		return;
+	}
+
+	Logger::log(LogLevel::Info, "Resuming " + _device->getDeviceName() + " at " + saved.next.toString());
+
+	startDevice(saved.next);
+}
+
+void KeyFinder::checkpoint()
+{
+	CheckpointJournal::Worker w;
+	w.device = _device->getDeviceName();
+	w.start = _deviceStart;
+	w.stride = _stride;
+	w.iterations = _deviceSteps;
+	w.next = _device->getNextKey();
+
+	// Points first: if the journal is not updated the saved points no longer match it and
+	// are not used
+	if(_checkpointPoints && _device->getPointsSize() > 0
+		&& !CheckpointJournal::savePoints(_journal->getPointsFile(_checkpointWorker), _device, _compression, w)) {
+		Logger::log(LogLevel::Warning, "Could not save the points of " + w.device);
+	}
+
+	_journal->update(_checkpointWorker, w);
+
+	if(!_journal->flush()) {
+		Logger::log(LogLevel::Warning, "Could not write the checkpoint file");
+	}
+}
+
+void KeyFinder::setScheduler(KeyspaceScheduler *scheduler, int worker)
+{
+	_scheduler = scheduler;
+	_schedulerWorker = worker;
+}
+
+bool KeyFinder::nextUnit(bool initDevice)
+{
+	KeyspaceUnit unit;
+
+	if(!_scheduler->next(_schedulerWorker, unit)) {
+		return false;
+	}
+
+	secp256k1::uint256 start = _scheduler->getKey(unit.begin);
+
+	// Units cut from the same range follow on, so the device only starts again after
+	// taking work from another device
+	if(initDevice || !(start == _device->getNextKey())) {
+		startDevice(start);
+	}
+
+	_startKey = start;
+	_unitEnd = _scheduler->getKey(unit.end);
+
+	return true;
 }
 
 
@@ -147,15 +409,12 @@ void KeyFinder::stop()
 
 void KeyFinder::removeTargetFromList(const unsigned int hash[5])
 {
-	KeySearchTarget t(hash);
-
-	_targets.erase(t);
+	_targets.remove(hash);
 }
 
 bool KeyFinder::isTargetInList(const unsigned int hash[5])
 {
-	KeySearchTarget t(hash);
-	return _targets.find(t) != _targets.end();
+	return _targets.contains(hash);
 }
 
 
@@ -165,9 +424,20 @@ void KeyFinder::run()
 
 	_running = true;
 
+	if(_scheduler != NULL && !_hasUnit) {
+		Logger::log(LogLevel::Info, "No keyspace left to search");
+		_running = false;
+	}
+
 	util::Timer timer;
+	util::Timer checkpointTimer;
+	util::Timer jumpTimer;
+	util::Timer coverageTimer;
 
 	timer.start();
+	checkpointTimer.start();
+	jumpTimer.start();
+	coverageTimer.start();
 
 	uint64_t prevIterCount = 0;
 
@@ -177,6 +447,7 @@ void KeyFinder::run()
 
         _device->doStep();
         _iterCount++;
+		_deviceSteps++;
 
 		// Update status
 		uint64_t t = timer.getTime();
@@ -193,6 +464,10 @@ void KeyFinder::run()
 
 			info.speed = (double)((double)count / seconds) / 1000000.0;
 
+			if(_scheduler != NULL) {
+				_scheduler->reportSpeed(_schedulerWorker, (double)count / seconds);
+			}
+
 			info.total = _total;
 
 			info.totalTime = _totalTime;
@@ -207,6 +482,7 @@ void KeyFinder::run()
 			info.deviceMemory = totalMem;
 			info.deviceName = _device->getDeviceName();
 			info.targets = _targets.size();
+			info.verifier = _device->getVerifierStats();
             info.nextKey = getNextKey();
 
 			_statusCallback(info);
@@ -222,6 +498,11 @@ void KeyFinder::run()
 
 			for(unsigned int i = 0; i < results.size(); i++) {
 
+				// Keys past the end of the keyspace are searched by another node
+				if(_scheduler != NULL && !_scheduler->contains(results[i].privateKey)) {
+					continue;
+				}
+
 				KeySearchResult info;
                 info.privateKey = results[i].privateKey;
                 info.publicKey = results[i].publicKey;
@@ -237,27 +518,84 @@ void KeyFinder::run()
 			}
 		}
 
+		if(_journal != NULL && checkpointTimer.getTime() >= _checkpointInterval) {
+			checkpoint();
+			checkpointTimer.start();
+		}
+
+		// The device is idle between steps, so the lookup can be replaced without
+		// losing the search position
+		if(_targetsPending) {
+			swapPendingTargets();
+		}
+
         // Stop if there are no keys left
         if(_targets.size() == 0) {
             Logger::log(LogLevel::Info, "No targets remaining");
             _running = false;
         }
 
-		
+		// Move to the next unit once the device is past the end of this one
+		if(_scheduler != NULL && _running && _device->getNextKey().cmp(_unitEnd) >= 0 && !nextUnit(false)) {
+			Logger::log(LogLevel::Info, "Keyspace searched");
+			_running = false;
+		}
+
+		if(_scheduler == NULL && _running && _jumpInterval > 0 && jumpTimer.getTime() >= _jumpInterval) {
+			jump(randomKey());
+			jumpTimer.start();
+		}
+
+		if(_coverage != NULL && _running && coverageTimer.getTime() >= _coverageInterval) {
+			recordCoverage();
+
+			if(!_coverage->save()) {
+				Logger::log(LogLevel::Warning, "Could not write the coverage index");
+			}
+
+			// Walk past keys searched by another device or run
+			if(_scheduler == NULL) {
+				secp256k1::uint256 next = _device->getNextKey();
+				secp256k1::uint256 skip = _coverage->nextUncovered(next, _stride);
+
+				if(!(skip == next)) {
+					Logger::log(LogLevel::Debug, _device->getDeviceName() + " skipping searched keys " + next.toString() + " to " + skip.toString());
+					jump(skip);
+				}
+			}
+
+			coverageTimer.start();
+		}
+
 		// Check if we reached end of keyspace
-		if(_targets.size() > 0) {  // Only check if we still have targets
+		if(_scheduler == NULL && _targets.size() > 0) {  // Only check if we still have targets
    			if(_device->getNextKey().cmp(_endKey) >= 0 || _device->getNextKey().cmp(_startKey) < 0) {
        		// We still have targets but reached end - wrap around and continue
        		 Logger::log(LogLevel::Info, "Reached end of keyspace, wrapping to continue search...");
         
        		 // Reset to start of keyspace (1) and reinitialize
        		 secp256k1::uint256 wrapKey(1);
-       		_device->init(wrapKey, _compression, _stride);
+       		 if(_coverage != NULL) {
+       			 wrapKey = _coverage->nextUncovered(wrapKey, _stride);
+       		 }
+       		startDevice(wrapKey);
        		 _startKey = wrapKey;
     		}
 		}
 		// Only stop at end if all targets are found (handled above)
 	}
+
+	if(_journal != NULL && _deviceStarted) {
+		checkpoint();
+	}
+
+	if(_coverage != NULL) {
+		recordCoverage();
+
+		if(!_coverage->save()) {
+			Logger::log(LogLevel::Warning, "Could not write the coverage index");
+		}
+	}
 }
 
 secp256k1::uint256 KeyFinder::getNextKey()
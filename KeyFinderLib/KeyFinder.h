@@ -2,11 +2,18 @@
 #define _KEY_FINDER_H
 
 #include <stdint.h>
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include <set>
 #include "secp256k1.h"
 #include "KeySearchTypes.h"
 #include "KeySearchDevice.h"
+#include "TargetSet.h"
+#include "KeyspaceScheduler.h"
+#include "CheckpointJournal.h"
+#include "CoverageIndex.h"
+#include "CryptoUtil.h"
 
 
 class KeyFinder {
@@ -17,7 +24,12 @@ private:
 
 	unsigned int _compression;
 
-	std::set<KeySearchTarget> _targets;
+	TargetSet _targets;
+
+	// Set by reloadTargets, swapped in by the search thread between steps
+	TargetSet _pendingTargets;
+	std::atomic<bool> _targetsPending;
+	std::mutex _pendingMutex;
 
 	uint64_t _statusInterval;
 
@@ -29,9 +41,39 @@ private:
     secp256k1::uint256 _startKey;
     secp256k1::uint256 _endKey;
 
+	// Hands out the part of the keyspace to search next, NULL to search from _startKey
+	KeyspaceScheduler *_scheduler;
+	int _schedulerWorker;
+
+	// First key after the current unit, and whether there is a unit at all
+	secp256k1::uint256 _unitEnd;
+	bool _hasUnit;
+
+	// Progress is saved here every _checkpointInterval ms, NULL for no checkpoints
+	CheckpointJournal *_journal;
+	int _checkpointWorker;
+	uint64_t _checkpointInterval;
+	bool _checkpointPoints;
+
+	// Random mode moves to a new random key every _jumpInterval ms, 0 to walk on from the start
+	uint64_t _jumpInterval;
+	crypto::Rng _rng;
+
+	// Keys searched are added here and saved every _coverageInterval ms, NULL for none
+	CoverageIndex *_coverage;
+	uint64_t _coverageInterval;
+
+	// Key the device was last started at and the steps since then
+	secp256k1::uint256 _deviceStart;
+	uint64_t _deviceSteps;
+	bool _deviceStarted;
+
 	// Each index of each thread gets a flag to indicate if it found a valid hash
 	bool _running;
 
+	// Invalid lines logged individually when loading a targets file
+	static const size_t MAX_REPORTED_ERRORS = 100;
+
 	void(*_resultCallback)(KeySearchResult);
 	void(*_statusCallback)(KeySearchStatus);
 
@@ -42,6 +84,15 @@ private:
 	void removeTargetFromList(const unsigned int value[5]);
 	bool isTargetInList(const unsigned int value[5]);
 	void setTargetsOnDevice();
+	void swapPendingTargets();
+	bool nextUnit(bool initDevice);
+	void startDevice(const secp256k1::uint256 &start);
+	void resumeDevice(const CheckpointJournal::Worker &saved);
+	void checkpoint();
+	void jump(const secp256k1::uint256 &key);
+	secp256k1::uint256 randomKey();
+	void leavePosition();
+	void recordCoverage();
 
 public:
 
@@ -57,9 +108,42 @@ public:
 	void setStatusCallback(void(*callback)(KeySearchStatus));
 	void setStatusInterval(uint64_t interval);
 
+	// Searches the units the scheduler hands to worker instead of starting at startKey.
+	// run() returns once the scheduler has no units left, and keys outside the keyspace
+	// are not reported. Call before init()
+	void setScheduler(KeyspaceScheduler *scheduler, int worker);
+
+	// Saves the position of the device to the journal as worker every intervalMs, and
+	// init() carries on from the position saved before. With savePoints the device
+	// points are saved too. Call before init()
+	void setCheckpoint(CheckpointJournal *journal, int worker, uint64_t intervalMs, bool savePoints);
+
+	// Without a scheduler, moves the device to a random key every intervalMs. The points are
+	// shifted on the device rather than generated again. 0 turns it off
+	void setJumpInterval(uint64_t intervalMs);
+
+	// Adds the keys searched to coverage and saves it every intervalMs. Without a scheduler
+	// the start key, jumps and the walk from them skip keys already in it. Call before init()
+	void setCoverage(CoverageIndex *coverage, uint64_t intervalMs);
+
 	void setTargets(std::string targetFile);
 	void setTargets(std::vector<std::string> &targets);
 
+	// Shares an already built target set, e.g. with the other workers
+	void setTargets(const TargetSet &targets);
+
+	// Replaces the targets while run() is searching. The device lookup is built on the
+	// calling thread and swapped in after the current step, targets already found stay
+	// removed
+	void reloadTargets(const TargetSet &targets);
+
+	// Converts addresses to a target set, throws KeySearchException on an invalid address
+	static void parseTargets(const std::vector<std::string> &addresses, TargetSet &targets);
+
+	// Loads a target database or a text file of addresses. Invalid lines are logged and
+	// skipped. Throws KeySearchException if the file cannot be read or holds no targets
+	static void loadTargets(const std::string &targetsFile, TargetSet &targets);
+
     secp256k1::uint256 getNextKey();
 };
 
@@ -5,6 +5,7 @@
 #include <set>
 #include "secp256k1.h"
 #include "KeySearchTypes.h"
+#include "TargetSet.h"
 
 
 class KeySearchException {
@@ -44,8 +45,44 @@ public:
     // Perform one iteration
     virtual void doStep() = 0;
 
+    // Bytes needed by savePoints(), 0 if the device cannot save its points
+    virtual size_t getPointsSize() = 0;
+
+    // Copies the current points to buf. Called between steps
+    virtual void savePoints(void *buf) = 0;
+
+    // Same as init() followed by iterations steps, but takes the points from buf, saved by
+    // savePoints() on a device with the same settings, instead of generating them
+    virtual void initFromPoints(const secp256k1::uint256 &start, int compression, const secp256k1::uint256 &stride, uint64_t iterations, const void *buf) = 0;
+
+    // Moves the search to key by adding (key - getNextKey()) * G to every point, which costs
+    // about one step instead of generating the points again. Called between steps
+    virtual void jump(const secp256k1::uint256 &key) = 0;
+
     // Tell the device which addresses to search for
-    virtual void setTargets(const std::set<KeySearchTarget> &targets) = 0;
+    virtual void setTargets(const TargetSet &targets) = 0;
+
+    // Builds the lookup for a new set of targets while the search keeps running. May be
+    // called from another thread during doStep()
+    virtual void prepareTargets(const TargetSet &targets) = 0;
+
+    // Replaces the targets with the ones passed to prepareTargets(). Called between steps,
+    // the search position is kept. Returns false if nothing was prepared
+    virtual bool swapTargets() = 0;
+
+    // Select the TargetFilterType used for large target sets, takes effect at the next setTargets()
+    virtual void setTargetFilter(int filter) = 0;
+
+    // False positive rate to size the device filters for, 0 for the device default. A higher
+    // rate uses less device memory and sends more candidates to the host. Takes effect at the
+    // next init() and setTargets()
+    virtual void setFalsePositiveRate(double rate) = 0;
+
+    // Threads that verify the candidates reported by the device
+    virtual void setVerifyThreads(int threads) = 0;
+
+    // Candidates checked on the host since the device was created
+    virtual KeySearchVerifierStats getVerifierStats() = 0;
 
     // Get the private keys that have been found so far
     virtual size_t getResults(std::vector<KeySearchResult> &results) = 0;
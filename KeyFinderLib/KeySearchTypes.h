@@ -13,6 +13,18 @@ namespace PointCompressionType {
     };
 }
 
+// Filter the devices test hashes against before the exact lookup. AUTO lets
+// LookupPlanner choose from the target count, memory and a benchmark
+namespace TargetFilterType {
+    enum Value {
+        BLOOM = 0,
+        FUSE8 = 1,
+        FUSE16 = 2,
+        FUSE32 = 3,
+        AUTO = 4
+    };
+}
+
 typedef struct hash160 {
 
     unsigned int h[5];
@@ -24,6 +36,24 @@ typedef struct hash160 {
 }hash160;
 
 
+// Host checks of the hashes that passed a device filter
+typedef struct {
+    // Hashes tested against the device filter
+    uint64_t hashes;
+
+    // Hashes that passed the filter
+    uint64_t candidates;
+
+    // Candidates that were not targets
+    uint64_t falsePositives;
+
+    // Targets whose private key did not produce the reported public key
+    uint64_t rejected;
+
+    // Microseconds spent verifying
+    uint64_t time;
+}KeySearchVerifierStats;
+
 typedef struct {
     int device;
     double speed;
@@ -34,6 +64,7 @@ typedef struct {
     uint64_t deviceMemory;
     uint64_t targets;
     secp256k1::uint256 nextKey;
+    KeySearchVerifierStats verifier;
 }KeySearchStatus;
 
 
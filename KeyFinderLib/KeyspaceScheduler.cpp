@@ -0,0 +1,413 @@
+#include "KeyspaceScheduler.h"
+#include "KeySearchDevice.h"
+#include "Logger.h"
+#include "util.h"
+
+using namespace secp256k1;
+
+namespace {
+
+    uint64_t gcd(uint64_t a, uint64_t b)
+    {
+        while(b != 0) {
+            uint64_t t = a % b;
+            a = b;
+            b = t;
+        }
+
+        return a;
+    }
+}
+
+KeyspaceScheduler::KeyspaceScheduler(const uint256 &start, const uint256 &end, const uint256 &stride, const std::vector<uint64_t> &keysPerStep)
+{
+    if(end.cmp(start) <= 0) {
+        throw KeySearchException("The keyspace is empty");
+    }
+
+    if(stride.isZero()) {
+        throw KeySearchException("Stride must be greater than 0");
+    }
+
+    if(keysPerStep.empty()) {
+        throw KeySearchException("No workers to schedule");
+    }
+
+    _start = start;
+    _stride = stride;
+    _end = end;
+    _count = divide(end - start + stride - uint256(1), stride);
+
+    uint64_t total = 0;
+    for(size_t i = 0; i < keysPerStep.size(); i++) {
+        total += keysPerStep[i];
+    }
+
+    _granularity = uint256(1);
+    for(size_t i = 0; i < keysPerStep.size(); i++) {
+        uint64_t k = keysPerStep[i] > 0 ? keysPerStep[i] : 1;
+        uint256 q = divide(_granularity, uint256(k));
+        uint64_t g = gcd(k, (_granularity - q * k).toUint64());
+
+        _granularity = divide(_granularity, uint256(g)) * k;
+    }
+
+    // Shares in proportion to the keys per step. The remainder goes to the last worker
+    uint256 keysPerShare = divide(_count, uint256(total));
+    uint256 begin(0);
+    uint64_t cumulative = 0;
+
+    _workers.resize(keysPerStep.size());
+
+    for(size_t i = 0; i < keysPerStep.size(); i++) {
+        Worker &w = _workers[i];
+
+        w.keysPerStep = keysPerStep[i] > 0 ? keysPerStep[i] : 1;
+        w.keysPerSecond = 0.0;
+
+        cumulative += keysPerStep[i];
+
+        KeyspaceUnit share;
+        share.begin = begin;
+        share.end = i == keysPerStep.size() - 1 ? _count : alignDown(keysPerShare * cumulative);
+
+        if(share.end.cmp(share.begin) > 0) {
+            w.ranges.push_back(share);
+        }
+
+        begin = share.end;
+    }
+}
+
+uint64_t KeyspaceScheduler::unitSize(int worker, const uint256 &left) const
+{
+    const Worker &w = _workers[worker];
+
+    uint64_t minSize = w.keysPerStep * MIN_UNIT_STEPS;
+
+    double keys = w.keysPerSecond * UNIT_SECONDS;
+
+    // Before every speed is known the share of the work is taken from the keys per step
+    bool measured = true;
+    for(size_t i = 0; i < _workers.size(); i++) {
+        measured = measured && _workers[i].keysPerSecond > 0.0;
+    }
+
+    double totalSpeed = 0.0;
+    for(size_t i = 0; i < _workers.size(); i++) {
+        totalSpeed += measured ? _workers[i].keysPerSecond : (double)_workers[i].keysPerStep;
+    }
+
+    double speed = measured ? w.keysPerSecond : (double)w.keysPerStep;
+
+    // No more than half of this worker's share of what is left, so the units get smaller
+    // towards the end and the workers finish together
+    uint32_t parts = (uint32_t)(speed / totalSpeed * 512.0);
+    uint256 cap = left.div(1024) * (parts > 0 ? parts : 1);
+
+    if(cap.cmp(uint256((uint64_t)1 << 52)) < 0 && (keys <= 0.0 || (double)cap.toUint64() < keys)) {
+        keys = (double)cap.toUint64();
+    }
+
+    if(keys <= (double)minSize) {
+        return minSize;
+    }
+
+    // Whole steps, so the worker finishes a unit exactly where the next one starts
+    return (uint64_t)(keys / (double)w.keysPerStep) * w.keysPerStep;
+}
+
+uint256 KeyspaceScheduler::remaining(const Worker &w)
+{
+    uint256 count(0);
+
+    for(size_t i = 0; i < w.ranges.size(); i++) {
+        count = count + (w.ranges[i].end - w.ranges[i].begin);
+    }
+
+    return count;
+}
+
+bool KeyspaceScheduler::steal(int thief)
+{
+    int victim = -1;
+    uint256 most(0);
+
+    for(int i = 0; i < (int)_workers.size(); i++) {
+        uint256 count = remaining(_workers[i]);
+
+        if(i != thief && count.cmp(most) > 0) {
+            victim = i;
+            most = count;
+        }
+    }
+
+    if(victim < 0) {
+        return false;
+    }
+
+    Worker &t = _workers[thief];
+    Worker &v = _workers[victim];
+
+    KeyspaceUnit &back = v.ranges.back();
+    uint256 size = back.end - back.begin;
+
+    KeyspaceUnit stolen = back;
+
+    if(size.cmp(uint256(unitSize(thief, most)) * (uint32_t)2) >= 0) {
+        // Split the range so both workers should finish their part at the same time
+        double share = 0.5;
+        if(t.keysPerSecond > 0.0 && v.keysPerSecond > 0.0) {
+            share = t.keysPerSecond / (t.keysPerSecond + v.keysPerSecond);
+        }
+
+        uint32_t parts = (uint32_t)(share * 1024.0);
+        parts = parts < 1 ? 1 : (parts > 1023 ? 1023 : parts);
+
+        uint256 count = size.div(1024) * parts;
+        if(count.isZero()) {
+            count = size.div(2);
+        }
+
+        stolen.begin = alignUp(back.end - count);
+    }
+
+    // A range too short to split on the granularity is taken whole
+    if(stolen.begin.cmp(back.begin) > 0 && stolen.begin.cmp(back.end) < 0) {
+        back.end = stolen.begin;
+    } else {
+        stolen = back;
+        v.ranges.pop_back();
+    }
+
+    t.ranges.push_back(stolen);
+
+    Logger::log(LogLevel::Debug, "Worker " + util::format(thief) + " took " + (stolen.end - stolen.begin).toString()
+        + " (hex) keys from worker " + util::format(victim));
+
+    return true;
+}
+
+bool KeyspaceScheduler::next(int worker, KeyspaceUnit &unit)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return take(worker, unit);
+}
+
+bool KeyspaceScheduler::take(int worker, KeyspaceUnit &unit)
+{
+    Worker &w = _workers[worker];
+
+    if(w.ranges.empty() && !steal(worker)) {
+        return false;
+    }
+
+    uint256 left(0);
+    for(size_t i = 0; i < _workers.size(); i++) {
+        left = left + remaining(_workers[i]);
+    }
+
+    KeyspaceUnit &front = w.ranges.front();
+    uint256 end = alignUp(front.begin + uint256(unitSize(worker, left)));
+
+    unit.begin = front.begin;
+
+    if(end.cmp(front.end) >= 0) {
+        unit.end = front.end;
+        w.ranges.pop_front();
+    } else {
+        unit.end = end;
+        front.begin = unit.end;
+    }
+
+    return true;
+}
+
+bool KeyspaceScheduler::resume(int worker, const uint256 &key, KeyspaceUnit &unit)
+{
+    if(!contains(key)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    uint256 i = divide(key - _start, _stride);
+
+    for(size_t j = 0; j < _workers.size(); j++) {
+        std::deque<KeyspaceUnit> &ranges = _workers[j].ranges;
+
+        for(size_t k = 0; k < ranges.size(); k++) {
+            if(ranges[k].begin.cmp(i) > 0 || ranges[k].end.cmp(i) <= 0) {
+                continue;
+            }
+
+            // Move the rest of the range to the front of this worker's queue
+            KeyspaceUnit rest;
+            rest.begin = i;
+            rest.end = ranges[k].end;
+
+            if(ranges[k].begin == i) {
+                ranges.erase(ranges.begin() + k);
+            } else {
+                ranges[k].end = i;
+            }
+
+            _workers[worker].ranges.push_front(rest);
+
+            return take(worker, unit);
+        }
+    }
+
+    return false;
+}
+
+void KeyspaceScheduler::exclude(const uint256 &begin, const uint256 &end)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Only whole multiples of the granularity, the keys left over at either side are
+    // searched again
+    uint256 b = alignUp(indexOf(begin));
+    uint256 e = alignDown(indexOf(end));
+
+    if(e.cmp(b) <= 0) {
+        return;
+    }
+
+    for(size_t j = 0; j < _workers.size(); j++) {
+        std::deque<KeyspaceUnit> ranges;
+
+        for(size_t k = 0; k < _workers[j].ranges.size(); k++) {
+            const KeyspaceUnit &r = _workers[j].ranges[k];
+
+            if(r.end.cmp(b) <= 0 || r.begin.cmp(e) >= 0) {
+                ranges.push_back(r);
+                continue;
+            }
+
+            if(r.begin.cmp(b) < 0) {
+                KeyspaceUnit before = {r.begin, b};
+                ranges.push_back(before);
+            }
+
+            if(r.end.cmp(e) > 0) {
+                KeyspaceUnit after = {e, r.end};
+                ranges.push_back(after);
+            }
+        }
+
+        _workers[j].ranges.swap(ranges);
+    }
+}
+
+uint256 KeyspaceScheduler::indexOf(const uint256 &key) const
+{
+    if(key.cmp(_start) <= 0) {
+        return uint256(0);
+    }
+
+    uint256 i = divide(key - _start + _stride - uint256(1), _stride);
+
+    return i.cmp(_count) > 0 ? _count : i;
+}
+
+uint256 KeyspaceScheduler::alignUp(const uint256 &i) const
+{
+    uint256 a = divide(i + _granularity - uint256(1), _granularity) * _granularity;
+
+    return a.cmp(_count) > 0 ? _count : a;
+}
+
+uint256 KeyspaceScheduler::alignDown(const uint256 &i) const
+{
+    if(i.cmp(_count) >= 0) {
+        return _count;
+    }
+
+    return divide(i, _granularity) * _granularity;
+}
+
+void KeyspaceScheduler::reportSpeed(int worker, double keysPerSecond)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _workers[worker].keysPerSecond = keysPerSecond;
+}
+
+uint256 KeyspaceScheduler::getKey(const uint256 &i) const
+{
+    return _start + i * _stride;
+}
+
+uint256 KeyspaceScheduler::remaining()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    uint256 count(0);
+    for(size_t i = 0; i < _workers.size(); i++) {
+        count = count + remaining(_workers[i]);
+    }
+
+    return count;
+}
+
+uint256 KeyspaceScheduler::getEnd() const
+{
+    return _end;
+}
+
+bool KeyspaceScheduler::contains(const uint256 &key) const
+{
+    if(key.cmp(_start) < 0 || key.cmp(_end) >= 0) {
+        return false;
+    }
+
+    uint256 offset = key - _start;
+
+    return divide(offset, _stride) * _stride == offset;
+}
+
+void KeyspaceScheduler::partition(const uint256 &start, const uint256 &end, const uint256 &stride,
+    int index, int count, uint256 &partStart, uint256 &partEnd)
+{
+    uint256 keys = divide(end - start + stride - uint256(1), stride);
+
+    // The first keys % count parts get one extra key
+    uint256 size = keys.div((uint32_t)count);
+    uint32_t extra = keys.mod((uint32_t)count).toUint64();
+
+    uint32_t i = (uint32_t)index;
+
+    uint256 begin = size * i + uint256(i < extra ? i : extra);
+    uint256 length = size + uint256(i < extra ? 1 : 0);
+
+    partStart = start + begin * stride;
+    partEnd = partStart + length * stride;
+
+    // The last key of the keyspace may be less than a whole stride before end
+    if(partEnd.cmp(end) > 0) {
+        partEnd = end;
+    }
+}
+
+uint256 KeyspaceScheduler::divide(const uint256 &a, const uint256 &b)
+{
+    uint256 quotient;
+    uint256 r;
+
+    // Long division, one bit at a time
+    for(int i = 255; i >= 0; i--) {
+        bool carry = (r.v[7] & 0x80000000) != 0;
+
+        r = r + r;
+        r.v[0] |= (a.v[i / 32] >> (i % 32)) & 1;
+
+        if(carry || r.cmp(b) >= 0) {
+            r = r - b;
+            quotient.v[i / 32] |= 1u << (i % 32);
+        }
+    }
+
+    return quotient;
+}
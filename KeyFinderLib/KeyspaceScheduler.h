@@ -0,0 +1,131 @@
+#ifndef _KEYSPACE_SCHEDULER_H
+#define _KEYSPACE_SCHEDULER_H
+
+#include <stdint.h>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "secp256k1.h"
+
+// Keys start + i * stride for begin <= i < end
+struct KeyspaceUnit {
+    secp256k1::uint256 begin;
+    secp256k1::uint256 end;
+};
+
+/**
+ Splits a keyspace between the workers of a search. Each worker starts with a
+ contiguous share in proportion to its keys per step and takes units from the
+ front of it, so it keeps stepping without a new init(). A unit is at most
+ UNIT_SECONDS of work at the speed the worker last reported, and at most half of
+ the worker's share of the work left, so units shrink towards the end.
+
+ A worker that runs out of ranges steals from the back of the worker with the
+ most work left, taking a part in proportion to their speeds. The search ends
+ when the last unit is done rather than when the slowest worker finishes its
+ first share.
+
+ A device steps whole steps, so every share, unit and stolen range ends on a
+ multiple of the least common multiple of the workers' keys per step, except
+ at the end of the keyspace. Whichever worker a range ends up with finishes it
+ exactly at its end rather than running on into keys another worker searches.
+ */
+class KeyspaceScheduler {
+
+private:
+
+    struct Worker {
+        // Ranges not yet handed out, the front one is being stepped through
+        std::deque<KeyspaceUnit> ranges;
+
+        uint64_t keysPerStep;
+
+        // 0 until the first status report
+        double keysPerSecond;
+    };
+
+    secp256k1::uint256 _start;
+
+    secp256k1::uint256 _stride;
+
+    secp256k1::uint256 _end;
+
+    // Number of keys in the keyspace
+    secp256k1::uint256 _count;
+
+    // Least common multiple of the workers' keys per step
+    secp256k1::uint256 _granularity;
+
+    std::vector<Worker> _workers;
+
+    std::mutex _mutex;
+
+    // Keys in the next unit of the worker when left keys have not been handed out
+    uint64_t unitSize(int worker, const secp256k1::uint256 &left) const;
+
+    static secp256k1::uint256 remaining(const Worker &w);
+
+    bool steal(int thief);
+
+    // next() with the lock held
+    bool take(int worker, KeyspaceUnit &unit);
+
+    // Index of the first key at or after key
+    secp256k1::uint256 indexOf(const secp256k1::uint256 &key) const;
+
+    // Nearest multiple of the granularity at or above i, or at or below i, no further
+    // than the end of the keyspace
+    secp256k1::uint256 alignUp(const secp256k1::uint256 &i) const;
+    secp256k1::uint256 alignDown(const secp256k1::uint256 &i) const;
+
+public:
+
+    // Target length of a unit once the speed of the worker is known
+    static const int UNIT_SECONDS = 10;
+
+    // Shortest unit, in steps of the worker
+    static const int MIN_UNIT_STEPS = 16;
+
+    // Searches start, start + stride ... up to but not including end. keysPerStep has an
+    // entry for each worker
+    KeyspaceScheduler(const secp256k1::uint256 &start, const secp256k1::uint256 &end, const secp256k1::uint256 &stride, const std::vector<uint64_t> &keysPerStep);
+
+    // Gets the next unit for the worker. Returns false when the whole keyspace has been
+    // handed out
+    bool next(int worker, KeyspaceUnit &unit);
+
+    // Gets a unit for the worker that starts at key, so a device restored from a checkpoint
+    // carries on where it was. Returns false if key has been handed out or excluded
+    bool resume(int worker, const secp256k1::uint256 &key, KeyspaceUnit &unit);
+
+    // Drops the keys from begin up to but not including end, e.g. those searched before a
+    // restart. Call before the workers start
+    void exclude(const secp256k1::uint256 &begin, const secp256k1::uint256 &end);
+
+    // Speed measured by the worker, used to size its next units
+    void reportSpeed(int worker, double keysPerSecond);
+
+    // Private key at index i
+    secp256k1::uint256 getKey(const secp256k1::uint256 &i) const;
+
+    // Keys that have not been handed out yet
+    secp256k1::uint256 remaining();
+
+    // First key after the keyspace
+    secp256k1::uint256 getEnd() const;
+
+    // True if key is one of the keys in the keyspace. A device steps whole steps, so the
+    // last unit of a range can run past its end
+    bool contains(const secp256k1::uint256 &key) const;
+
+    // Splits start, start + stride ... below end into count contiguous parts that differ
+    // by at most one key and gets the bounds of part index. The same arguments always
+    // give the same parts, so machines can share a keyspace without talking to each other
+    static void partition(const secp256k1::uint256 &start, const secp256k1::uint256 &end, const secp256k1::uint256 &stride,
+        int index, int count, secp256k1::uint256 &partStart, secp256k1::uint256 &partEnd);
+
+    // a / b rounded down
+    static secp256k1::uint256 divide(const secp256k1::uint256 &a, const secp256k1::uint256 &b);
+};
+
+#endif
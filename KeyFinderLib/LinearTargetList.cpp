@@ -0,0 +1,115 @@
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LINEAR_TARGET_LIST_SSE2
+#endif
+
+#include "LinearTargetList.h"
+#include "TargetSet.h"
+
+LinearTargetList::LinearTargetList() : _count(0), _stride(0)
+{
+}
+
+void LinearTargetList::build(const TargetSet &targets)
+{
+    std::vector<hash160> list;
+    targets.getTargets(list);
+
+    _count = list.size();
+    _stride = (_count + 3) & ~(size_t)3;
+    _words.assign(_stride * 5, 0);
+
+    for(size_t i = 0; i < _stride; i++) {
+        const hash160 &t = list[i < _count ? i : _count - 1];
+
+        for(int j = 0; j < 5; j++) {
+            _words[j * _stride + i] = t.h[j];
+        }
+    }
+}
+
+bool LinearTargetList::matches(const unsigned int hash[5], const uint32_t *rows[5], size_t i)
+{
+    return rows[1][i] == hash[1] && rows[2][i] == hash[2] && rows[3][i] == hash[3] && rows[4][i] == hash[4];
+}
+
+bool LinearTargetList::contains(const unsigned int hash[5], const uint32_t *rows[5]) const
+{
+    // Only the first word is compared against every target. The rest are compared
+    // for the rare targets whose first word matches
+#ifdef LINEAR_TARGET_LIST_SSE2
+    __m128i h0 = _mm_set1_epi32((int)hash[0]);
+
+    for(size_t i = 0; i < _stride; i += 4) {
+        int eq = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)&rows[0][i]), h0)));
+
+        while(eq) {
+            int k = 0;
+            while(!(eq & (1 << k))) {
+                k++;
+            }
+            eq &= eq - 1;
+
+            if(matches(hash, rows, i + k)) {
+                return true;
+            }
+        }
+    }
+#else
+    for(size_t i = 0; i < _stride; i++) {
+        if(rows[0][i] == hash[0] && matches(hash, rows, i)) {
+            return true;
+        }
+    }
+#endif
+
+    return false;
+}
+
+bool LinearTargetList::contains(const unsigned int hash[5]) const
+{
+    if(_count == 0) {
+        return false;
+    }
+
+    const uint32_t *rows[5];
+
+    for(int j = 0; j < 5; j++) {
+        rows[j] = &_words[j * _stride];
+    }
+
+    return contains(hash, rows);
+}
+
+void LinearTargetList::probe(const unsigned int *hashes, int count, uint64_t *mask) const
+{
+    memset(mask, 0, sizeof(uint64_t) * ((count + 63) / 64));
+
+    if(_count == 0) {
+        return;
+    }
+
+    const uint32_t *rows[5];
+
+    for(int j = 0; j < 5; j++) {
+        rows[j] = &_words[j * _stride];
+    }
+
+    for(int i = 0; i < count; i++) {
+        if(contains(&hashes[i * 5], rows)) {
+            mask[i / 64] |= (uint64_t)1 << (i % 64);
+        }
+    }
+}
+
+size_t LinearTargetList::count() const
+{
+    return _count;
+}
+
+size_t LinearTargetList::size() const
+{
+    return _words.size() * sizeof(uint32_t);
+}
@@ -0,0 +1,49 @@
+#ifndef _LINEAR_TARGET_LIST_H
+#define _LINEAR_TARGET_LIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class TargetSet;
+
+/**
+ Exact lookup for a handful of targets. The targets are stored one word per
+ row so the first word of each hash is compared against four targets at a
+ time with SSE2, which is faster than any table or filter while the list
+ fits in a few cache lines.
+ */
+class LinearTargetList {
+
+private:
+
+    // Word j of target i is at _words[j * _stride + i]. Rows are padded with copies of
+    // the last target to a multiple of 4
+    std::vector<uint32_t> _words;
+
+    size_t _count;
+
+    size_t _stride;
+
+    static bool matches(const unsigned int hash[5], const uint32_t *rows[5], size_t i);
+
+    bool contains(const unsigned int hash[5], const uint32_t *rows[5]) const;
+
+public:
+
+    LinearTargetList();
+
+    void build(const TargetSet &targets);
+
+    bool contains(const unsigned int hash[5]) const;
+
+    // Tests count hashes of 5 words each, in the same way as BlockedBloomFilter::probe
+    void probe(const unsigned int *hashes, int count, uint64_t *mask) const;
+
+    size_t count() const;
+
+    // Size in bytes
+    size_t size() const;
+};
+
+#endif
@@ -0,0 +1,366 @@
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "LookupPlanner.h"
+#include "KeySearchTypes.h"
+#include "BlockedBloomFilter.h"
+#include "BinaryFuseFilter.h"
+#include "LinearTargetList.h"
+#include "Logger.h"
+#include "util.h"
+
+namespace {
+
+    // Random hashes looked up in each timing run
+    const int BENCHMARK_HASHES = 1 << 14;
+
+    // Each candidate is timed this many times and the fastest run is kept
+    const int BENCHMARK_RUNS = 3;
+
+    // Filters larger than this are timed at this size. Past the last level cache
+    // the lookup cost no longer depends on the size
+    const uint64_t BENCHMARK_MAX_BYTES = (uint64_t)64 << 20;
+
+    const int BATCH_SIZE = 64;
+
+    bool allowed(const LookupConstraints &constraints, int strategy)
+    {
+        return (constraints.strategies & (1u << strategy)) != 0;
+    }
+
+    void randomHashes(std::vector<unsigned int> &hashes)
+    {
+        uint64_t x = 0x9E3779B97F4A7C15ULL;
+
+        for(size_t i = 0; i < hashes.size(); i++) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            hashes[i] = (unsigned int)(x >> 32);
+        }
+    }
+
+    // Nanoseconds per hash for probe(hashes, count, mask) over the random hashes
+    template<typename F> double timeProbe(const std::vector<unsigned int> &hashes, F probe)
+    {
+        double best = 0.0;
+        uint64_t mask[(BATCH_SIZE + 63) / 64];
+        volatile uint64_t sink = 0;
+
+        for(int run = 0; run < BENCHMARK_RUNS; run++) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            for(int i = 0; i < BENCHMARK_HASHES; i += BATCH_SIZE) {
+                probe(&hashes[i * 5], BATCH_SIZE, mask);
+                sink = sink + mask[0];
+            }
+
+            double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / BENCHMARK_HASHES;
+
+            if(run == 0 || ns < best) {
+                best = ns;
+            }
+        }
+
+        return best;
+    }
+
+    // Number of keys that makes a filter of the given size
+    size_t benchmarkCount(size_t count, uint64_t bytes)
+    {
+        if(bytes <= BENCHMARK_MAX_BYTES) {
+            return count;
+        }
+
+        return (size_t)((double)count * BENCHMARK_MAX_BYTES / bytes);
+    }
+
+    double timeStrategy(int strategy, const TargetSet &targets, const LookupConstraints &constraints, const std::vector<unsigned int> &hashes)
+    {
+        size_t count = targets.size();
+        uint64_t bytes = LookupPlanner::memoryUsage(strategy, count, constraints);
+
+        if(strategy == LookupStrategy::LIST) {
+            LinearTargetList list;
+            list.build(targets);
+
+            return timeProbe(hashes, [&list](const unsigned int *h, int n, uint64_t *mask) {
+                list.probe(h, n, mask);
+            });
+        } else if(strategy == LookupStrategy::TABLE) {
+            return timeProbe(hashes, [&targets](const unsigned int *h, int n, uint64_t *mask) {
+                mask[0] = 0;
+                for(int i = 0; i < n; i++) {
+                    mask[0] |= (uint64_t)targets.contains(&h[i * 5]) << i;
+                }
+            });
+        } else if(strategy == LookupStrategy::BLOOM) {
+            BlockedBloomFilter filter;
+            filter.init(benchmarkCount(count, bytes), (unsigned int)constraints.bloomBitsPerKey);
+
+            return timeProbe(hashes, [&filter](const unsigned int *h, int n, uint64_t *mask) {
+                filter.probe(h, n, mask);
+            });
+        } else {
+            // Lookups in an empty table cost the same as in a built one
+            BinaryFuseFilter filter;
+            filter.init(benchmarkCount(count, bytes), LookupPlanner::fingerprintBits(strategy));
+
+            return timeProbe(hashes, [&filter](const unsigned int *h, int n, uint64_t *mask) {
+                filter.probe(h, n, mask);
+            });
+        }
+    }
+
+    double falsePositiveRate(int strategy, const LookupConstraints &constraints)
+    {
+        if(strategy == LookupStrategy::BLOOM) {
+            return LookupPlanner::bloomFalsePositiveRate(constraints.bloomBitsPerKey, constraints.bloomHashes, constraints.bloomBlocked);
+        } else if(strategy == LookupStrategy::LIST || strategy == LookupStrategy::TABLE) {
+            return 0.0;
+        }
+
+        return pow(2.0, -LookupPlanner::fingerprintBits(strategy));
+    }
+
+    std::string formatSize(uint64_t bytes)
+    {
+        if(bytes < 1024 * 1024) {
+            return util::format("%.1f", (double)bytes / 1024.0) + "KB";
+        }
+
+        return util::format("%.1f", (double)bytes / (double)(1024 * 1024)) + "MB";
+    }
+}
+
+int LookupPlanner::fingerprintBits(int strategy)
+{
+    switch(strategy) {
+        case LookupStrategy::FUSE8:
+            return 8;
+        case LookupStrategy::FUSE16:
+            return 16;
+        case LookupStrategy::FUSE32:
+            return 32;
+        default:
+            return 0;
+    }
+}
+
+std::string LookupPlanner::name(int strategy)
+{
+    switch(strategy) {
+        case LookupStrategy::LIST:
+            return "linear list";
+        case LookupStrategy::TABLE:
+            return "sorted table";
+        case LookupStrategy::BLOOM:
+            return "bloom filter";
+        case LookupStrategy::FUSE8:
+            return "8-bit fuse filter";
+        case LookupStrategy::FUSE16:
+            return "16-bit fuse filter";
+        case LookupStrategy::FUSE32:
+            return "32-bit fuse filter";
+        default:
+            return "unknown";
+    }
+}
+
+double LookupPlanner::bloomFalsePositiveRate(double bitsPerKey, int hashes, bool blocked)
+{
+    if(bitsPerKey <= 0.0) {
+        return 1.0;
+    }
+
+    if(!blocked) {
+        return pow(1.0 - exp(-(double)hashes / bitsPerKey), hashes);
+    }
+
+    // The number of keys in a block is Poisson distributed, and crowded blocks
+    // account for most of the false positives
+    double blockBits = BlockedBloomFilter::BLOCK_WORDS * 32;
+    double lambda = blockBits / bitsPerKey;
+    double p = exp(-lambda);
+    double rate = 0.0;
+    int limit = (int)(lambda + 10.0 * sqrt(lambda)) + 20;
+
+    for(int j = 0; j <= limit; j++) {
+        rate += p * pow(1.0 - pow(1.0 - 1.0 / blockBits, (double)hashes * j), hashes);
+        p *= lambda / (j + 1);
+    }
+
+    return rate;
+}
+
+unsigned int LookupPlanner::bloomBitsPerKey(double rate, int hashes, bool blocked)
+{
+    const unsigned int maxBits = 128;
+
+    for(unsigned int bits = 1; bits < maxBits; bits++) {
+        if(bloomFalsePositiveRate(bits, hashes, blocked) <= rate) {
+            return bits;
+        }
+    }
+
+    return maxBits;
+}
+
+uint64_t LookupPlanner::memoryUsage(int strategy, size_t count, const LookupConstraints &constraints)
+{
+    switch(strategy) {
+        case LookupStrategy::LIST:
+            return (uint64_t)((count + 3) & ~(size_t)3) * 20;
+
+        case LookupStrategy::TABLE:
+            // The TargetSet is already in memory
+            return 0;
+
+        case LookupStrategy::BLOOM: {
+            uint64_t blockBytes = BlockedBloomFilter::BLOCK_WORDS * 4;
+            uint64_t bytes = (uint64_t)ceil((double)count * constraints.bloomBitsPerKey / 8.0);
+
+            return (bytes + blockBytes - 1) / blockBytes * blockBytes;
+        }
+
+        default: {
+            // About 1.125 entries per key for large sets, more for small ones
+            double factor = count <= 1 ? 3.0 : std::max(1.125, 0.875 + 0.25 * ::log(1000000.0) / ::log((double)count));
+
+            return (uint64_t)ceil((double)count * factor) * (fingerprintBits(strategy) / 8);
+        }
+    }
+}
+
+LookupPlan LookupPlanner::plan(const TargetSet &targets, const LookupConstraints &constraints, int filter)
+{
+    size_t count = targets.size();
+
+    // An explicit filter replaces the others
+    unsigned int strategies = constraints.strategies;
+
+    if(filter != TargetFilterType::AUTO) {
+        int only = LookupStrategy::BLOOM;
+
+        if(filter == TargetFilterType::FUSE8) {
+            only = LookupStrategy::FUSE8;
+        } else if(filter == TargetFilterType::FUSE16) {
+            only = LookupStrategy::FUSE16;
+        } else if(filter == TargetFilterType::FUSE32) {
+            only = LookupStrategy::FUSE32;
+        }
+
+        strategies &= (1u << LookupStrategy::LIST) | (1u << LookupStrategy::TABLE) | (1u << only);
+    }
+
+    LookupConstraints c = constraints;
+    c.strategies = strategies;
+
+    std::vector<int> candidates;
+
+    for(int s = LookupStrategy::LIST; s <= LookupStrategy::FUSE32; s++) {
+        if(!allowed(c, s)) {
+            continue;
+        }
+
+        if(s == LookupStrategy::LIST && count > c.maxListSize) {
+            continue;
+        }
+
+        if(memoryUsage(s, count, c) > c.memoryBudget) {
+            continue;
+        }
+
+        candidates.push_back(s);
+    }
+
+    LookupPlan plan;
+    plan.nsPerLookup = 0.0;
+
+    if(candidates.empty()) {
+        // Nothing fits, take the smallest filter and let the allocation decide
+        plan.strategy = -1;
+
+        for(int s = LookupStrategy::BLOOM; s <= LookupStrategy::FUSE32; s++) {
+            if(allowed(c, s) && (plan.strategy < 0 || memoryUsage(s, count, c) < memoryUsage(plan.strategy, count, c))) {
+                plan.strategy = s;
+            }
+        }
+
+        if(plan.strategy < 0) {
+            plan.strategy = allowed(c, LookupStrategy::TABLE) ? LookupStrategy::TABLE : LookupStrategy::LIST;
+        }
+
+        Logger::log(LogLevel::Warning, "No target lookup fits in " + formatSize(c.memoryBudget));
+    } else if(c.benchmark && filter == TargetFilterType::AUTO) {
+        std::vector<unsigned int> hashes(BENCHMARK_HASHES * 5);
+        randomHashes(hashes);
+
+        // Every hash that passes a filter is looked up in the table
+        double tableCost = timeStrategy(LookupStrategy::TABLE, targets, c, hashes);
+
+        plan.strategy = -1;
+
+        for(size_t i = 0; i < candidates.size(); i++) {
+            int s = candidates[i];
+            double cost = s == LookupStrategy::TABLE ? tableCost : timeStrategy(s, targets, c, hashes);
+
+            cost += falsePositiveRate(s, c) * tableCost;
+
+            Logger::log(LogLevel::Debug, name(s) + ": " + util::format("%.1f", cost) + " ns per hash");
+
+            if(plan.strategy < 0 || cost < plan.nsPerLookup) {
+                plan.strategy = s;
+                plan.nsPerLookup = cost;
+            }
+        }
+    } else {
+        // In order of preference: exact list, the filter with the fewest memory accesses,
+        // then the fuse filters from the lowest false positive rate down
+        const int order[] = {
+            LookupStrategy::LIST,
+            LookupStrategy::BLOOM,
+            LookupStrategy::FUSE32,
+            LookupStrategy::FUSE16,
+            LookupStrategy::FUSE8,
+            LookupStrategy::TABLE
+        };
+
+        plan.strategy = candidates[0];
+
+        for(size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+            if(std::find(candidates.begin(), candidates.end(), order[i]) != candidates.end()) {
+                plan.strategy = order[i];
+                break;
+            }
+        }
+    }
+
+    plan.memory = memoryUsage(plan.strategy, count, c);
+    plan.falsePositiveRate = falsePositiveRate(plan.strategy, c);
+
+    return plan;
+}
+
+void LookupPlanner::log(const LookupPlan &plan, size_t targets)
+{
+    std::string msg = "Target lookup for " + util::formatThousands(targets) + " targets: " + name(plan.strategy);
+
+    if(plan.memory > 0) {
+        msg += " (" + formatSize(plan.memory) + ")";
+    }
+
+    if(plan.falsePositiveRate > 0.0) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.1e", plan.falsePositiveRate);
+        msg += ", false positive rate " + std::string(buf);
+    }
+
+    if(plan.nsPerLookup > 0.0) {
+        msg += ", " + util::format("%.1f", plan.nsPerLookup) + " ns per hash";
+    }
+
+    Logger::log(LogLevel::Info, msg);
+}
@@ -0,0 +1,92 @@
+#ifndef _LOOKUP_PLANNER_H
+#define _LOOKUP_PLANNER_H
+
+#include <stdint.h>
+#include <string>
+#include "TargetSet.h"
+
+// How a device tests hashes against the targets
+namespace LookupStrategy {
+    enum Value {
+        // Compare against every target
+        LIST = 0,
+
+        // Search the TargetSet directly
+        TABLE = 1,
+
+        BLOOM = 2,
+        FUSE8 = 3,
+        FUSE16 = 4,
+        FUSE32 = 5
+    };
+}
+
+// What a device can run
+typedef struct {
+    // Bit mask of (1 << LookupStrategy) the device implements
+    unsigned int strategies;
+
+    // Largest number of targets the LIST strategy takes
+    size_t maxListSize;
+
+    // Bytes available for the list or filter
+    uint64_t memoryBudget;
+
+    // The device's Bloom filter: bits per key, bits set per key, and whether all
+    // bits for a key fall in one 512-bit block
+    double bloomBitsPerKey;
+    int bloomHashes;
+    bool bloomBlocked;
+
+    // Time the candidates on the host. Only meaningful when the device is the host CPU
+    bool benchmark;
+}LookupConstraints;
+
+typedef struct {
+    int strategy;
+
+    // Bytes used by the list or filter
+    uint64_t memory;
+
+    // Fraction of non-target hashes that pass the filter and need an exact lookup
+    double falsePositiveRate;
+
+    // Measured cost of one lookup including false positives, 0 when not benchmarked
+    double nsPerLookup;
+}LookupPlan;
+
+/**
+ Chooses how a device looks up hashes. Candidates that do not fit the memory
+ budget are dropped. With a benchmark each remaining candidate is timed on a
+ batch of random hashes, which is what the search actually looks up, and the
+ cheapest is chosen after adding the cost of the exact lookups its false
+ positives cause. Without one the choice follows the target count: a list
+ for tiny sets, then the Bloom filter, then the smallest fuse filter that
+ fits.
+ */
+class LookupPlanner {
+
+public:
+
+    // filter is a TargetFilterType. Anything but AUTO limits the filters to that one
+    static LookupPlan plan(const TargetSet &targets, const LookupConstraints &constraints, int filter);
+
+    static std::string name(int strategy);
+
+    static void log(const LookupPlan &plan, size_t targets);
+
+    // Expected false positive rate of a Bloom filter
+    static double bloomFalsePositiveRate(double bitsPerKey, int hashes, bool blocked);
+
+    // Fewest whole bits per key, up to 128, for a Bloom filter with at most the given false
+    // positive rate
+    static unsigned int bloomBitsPerKey(double rate, int hashes, bool blocked);
+
+    // Bytes used by each strategy for count targets
+    static uint64_t memoryUsage(int strategy, size_t count, const LookupConstraints &constraints);
+
+    // Fingerprint width of a fuse filter strategy
+    static int fingerprintBits(int strategy);
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "TargetDatabase.h"
+#include "TargetSet.h"
+#include "KeySearchDevice.h"
+
+TargetDatabase::TargetDatabase()
+{
+}
+
+uint64_t TargetDatabase::checksum(const KeySearchTarget *nodes, size_t count)
+{
+    uint64_t h = 0xCBF29CE484222325ULL;
+
+    for(size_t i = 0; i < count; i++) {
+        for(int j = 0; j < 5; j++) {
+            h ^= nodes[i].value[j];
+            h *= 0x100000001B3ULL;
+        }
+    }
+
+    return h;
+}
+
+bool TargetDatabase::isDatabase(const std::string &fileName)
+{
+    FILE *fp = fopen(fileName.c_str(), "rb");
+
+    if(fp == NULL) {
+        return false;
+    }
+
+    uint64_t magic = 0;
+    size_t n = fread(&magic, sizeof(magic), 1, fp);
+    fclose(fp);
+
+    return n == 1 && magic == MAGIC;
+}
+
+std::shared_ptr<TargetDatabase> TargetDatabase::open(const std::string &fileName)
+{
+    std::shared_ptr<TargetDatabase> db(new TargetDatabase());
+
+    if(!db->_file.open(fileName)) {
+        throw KeySearchException("Unable to open '" + fileName + "'");
+    }
+
+    size_t size = db->_file.size();
+
+    if(size < sizeof(TargetDatabaseHeader)) {
+        throw KeySearchException("'" + fileName + "' is not a target database");
+    }
+
+    const TargetDatabaseHeader *header = (const TargetDatabaseHeader *)db->_file.data();
+
+    if(header->magic != MAGIC) {
+        throw KeySearchException("'" + fileName + "' is not a target database");
+    }
+
+    if(header->version != VERSION || header->headerSize < sizeof(TargetDatabaseHeader)) {
+        throw KeySearchException("'" + fileName + "' has an unsupported database version");
+    }
+
+    if(header->headerSize % sizeof(unsigned int) != 0
+        || size < header->headerSize
+        || header->count >= (size - header->headerSize) / sizeof(KeySearchTarget)) {
+        throw KeySearchException("'" + fileName + "' is truncated");
+    }
+
+    if(checksum(db->nodes(), (size_t)header->count + 1) != header->checksum) {
+        throw KeySearchException("'" + fileName + "' failed the checksum");
+    }
+
+    return db;
+}
+
+void TargetDatabase::write(const std::string &fileName, std::vector<KeySearchTarget> &targets)
+{
+    TargetSet set;
+    set.build(targets);
+
+    const TargetSet::Table &table = *set._table;
+
+    TargetDatabaseHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.headerSize = sizeof(TargetDatabaseHeader);
+    header.count = table.size - 1;
+    header.checksum = checksum(table.nodes, table.size);
+
+    FILE *fp = fopen(fileName.c_str(), "wb");
+
+    if(fp == NULL) {
+        throw KeySearchException("Unable to open '" + fileName + "' for writing");
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+        && fwrite(table.nodes, sizeof(KeySearchTarget), table.size, fp) == table.size;
+
+    if(fclose(fp) != 0 || !ok) {
+        throw KeySearchException("Error writing '" + fileName + "'");
+    }
+}
+
+uint64_t TargetDatabase::count() const
+{
+    return ((const TargetDatabaseHeader *)_file.data())->count;
+}
+
+const KeySearchTarget *TargetDatabase::nodes() const
+{
+    const uint8_t *data = _file.data();
+
+    return (const KeySearchTarget *)(data + ((const TargetDatabaseHeader *)data)->headerSize);
+}
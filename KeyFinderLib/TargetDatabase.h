@@ -0,0 +1,66 @@
+#ifndef _TARGET_DATABASE_H
+#define _TARGET_DATABASE_H
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "KeySearchTypes.h"
+#include "MappedFile.h"
+
+/**
+ Precompiled target database. The file holds a header followed by the
+ deduplicated hash160 targets in the same Eytzinger order TargetSet uses, so
+ the table can be memory-mapped and searched in place. Processes that map the
+ same file share its pages.
+
+ Layout (host byte order):
+   TargetDatabaseHeader
+   KeySearchTarget nodes[count + 1]   node 0 is unused
+ */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t count;
+
+    // FNV-1a over the words of the node table
+    uint64_t checksum;
+}TargetDatabaseHeader;
+
+class TargetDatabase {
+
+private:
+
+    util::MappedFile _file;
+
+    TargetDatabase();
+
+    TargetDatabase(const TargetDatabase &);
+    TargetDatabase &operator=(const TargetDatabase &);
+
+    static uint64_t checksum(const KeySearchTarget *nodes, size_t count);
+
+public:
+
+    // "BITRTDB1" read as a little-endian word
+    static const uint64_t MAGIC = 0x3142445452544942ULL;
+
+    static const uint32_t VERSION = 1;
+
+    // True if the file starts with a database header
+    static bool isDatabase(const std::string &fileName);
+
+    // Maps the file read-only and checks the header and checksum. Throws KeySearchException
+    static std::shared_ptr<TargetDatabase> open(const std::string &fileName);
+
+    // Sorts and deduplicates the targets and writes them to fileName
+    static void write(const std::string &fileName, std::vector<KeySearchTarget> &targets);
+
+    uint64_t count() const;
+
+    // count() + 1 nodes in Eytzinger order
+    const KeySearchTarget *nodes() const;
+};
+
+#endif
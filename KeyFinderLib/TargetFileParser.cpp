@@ -0,0 +1,205 @@
+#include <string.h>
+#include <algorithm>
+
+#include "TargetFileParser.h"
+#include "KeySearchDevice.h"
+#include "AddressUtil.h"
+#include "CryptoUtil.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+namespace {
+
+    // Chunks are at least this large so small files are not split up
+    const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+    // Decoded addresses waiting for their checksums
+    const int CHECKSUM_BATCH = 256;
+
+    struct Chunk {
+        const char *begin;
+        const char *end;
+
+        // Lines in this chunk, error line numbers are relative to the chunk
+        uint64_t lines;
+
+        std::vector<KeySearchTarget> targets;
+        std::vector<TargetFileParser::Error> errors;
+    };
+
+    struct PendingLine {
+        uint64_t line;
+        const char *text;
+        size_t len;
+    };
+
+    inline bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    void addError(Chunk &chunk, uint64_t line, const char *text, size_t len)
+    {
+        TargetFileParser::Error e;
+        e.line = line;
+        e.text = std::string(text, len);
+
+        chunk.errors.push_back(e);
+    }
+
+    void checkPending(Chunk &chunk, std::vector<PendingLine> &pending, std::vector<unsigned int> &hashes, std::vector<unsigned int> &expected)
+    {
+        int count = (int)pending.size();
+
+        if(count == 0) {
+            return;
+        }
+
+        unsigned int actual[CHECKSUM_BATCH];
+
+        crypto::checksumBatch(&hashes[0], actual, count);
+
+        for(int i = 0; i < count; i++) {
+            if(actual[i] == expected[i]) {
+                chunk.targets.push_back(KeySearchTarget(&hashes[i * 5]));
+            } else {
+                addError(chunk, pending[i].line, pending[i].text, pending[i].len);
+            }
+        }
+
+        pending.clear();
+        hashes.clear();
+        expected.clear();
+    }
+
+    void parseChunk(Chunk &chunk)
+    {
+        std::vector<PendingLine> pending;
+        std::vector<unsigned int> hashes;
+        std::vector<unsigned int> expected;
+
+        pending.reserve(CHECKSUM_BATCH);
+        hashes.reserve(CHECKSUM_BATCH * 5);
+        expected.reserve(CHECKSUM_BATCH);
+
+        const char *p = chunk.begin;
+
+        chunk.lines = 0;
+
+        while(p < chunk.end) {
+            const char *eol = (const char *)memchr(p, '\n', chunk.end - p);
+            const char *next = eol != NULL ? eol + 1 : chunk.end;
+
+            if(eol == NULL) {
+                eol = chunk.end;
+            }
+
+            chunk.lines++;
+
+            const char *s = p;
+            const char *e = eol;
+
+            while(s < e && isSpace(*s)) {
+                s++;
+            }
+
+            while(e > s && isSpace(e[-1])) {
+                e--;
+            }
+
+            if(s < e) {
+                unsigned int hash[5];
+                unsigned int checksum;
+
+                if(Base58::decodeAddress(s, e - s, hash, checksum)) {
+                    PendingLine l;
+                    l.line = chunk.lines;
+                    l.text = s;
+                    l.len = e - s;
+
+                    pending.push_back(l);
+                    hashes.insert(hashes.end(), hash, hash + 5);
+                    expected.push_back(checksum);
+
+                    if((int)pending.size() == CHECKSUM_BATCH) {
+                        checkPending(chunk, pending, hashes, expected);
+                    }
+                } else {
+                    addError(chunk, chunk.lines, s, e - s);
+                }
+            }
+
+            p = next;
+        }
+
+        checkPending(chunk, pending, hashes, expected);
+    }
+
+    bool lineLess(const TargetFileParser::Error &a, const TargetFileParser::Error &b)
+    {
+        return a.line < b.line;
+    }
+}
+
+uint64_t TargetFileParser::parse(const std::string &fileName, std::vector<KeySearchTarget> &targets, std::vector<Error> &errors, int threads)
+{
+    util::MappedFile file;
+
+    if(!file.open(fileName)) {
+        throw KeySearchException("Unable to open '" + fileName + "'");
+    }
+
+    const char *data = (const char *)file.data();
+    size_t size = file.size();
+
+    util::ThreadPool pool(threads);
+
+    // A few chunks per thread keeps the threads busy when line lengths vary
+    size_t chunkSize = std::max(MIN_CHUNK_SIZE, size / (pool.size() * 4) + 1);
+
+    // Split on line boundaries
+    std::vector<Chunk> chunks;
+    size_t offset = 0;
+
+    while(offset < size) {
+        size_t end = offset + chunkSize;
+
+        if(end >= size) {
+            end = size;
+        } else {
+            const char *eol = (const char *)memchr(data + end, '\n', size - end);
+            end = eol != NULL ? (size_t)(eol - data) + 1 : size;
+        }
+
+        Chunk c;
+        c.begin = data + offset;
+        c.end = data + end;
+        c.lines = 0;
+        chunks.push_back(c);
+
+        offset = end;
+    }
+
+    pool.parallelFor((int)chunks.size(), [&chunks](int i) {
+        parseChunk(chunks[i]);
+    });
+
+    // Merge in file order, turning chunk line numbers into file line numbers
+    uint64_t lines = 0;
+
+    for(size_t i = 0; i < chunks.size(); i++) {
+        targets.insert(targets.end(), chunks[i].targets.begin(), chunks[i].targets.end());
+
+        std::vector<Error> &chunkErrors = chunks[i].errors;
+        std::sort(chunkErrors.begin(), chunkErrors.end(), lineLess);
+
+        for(size_t j = 0; j < chunkErrors.size(); j++) {
+            chunkErrors[j].line += lines;
+            errors.push_back(chunkErrors[j]);
+        }
+
+        lines += chunks[i].lines;
+    }
+
+    return lines;
+}
@@ -0,0 +1,29 @@
+#ifndef _TARGET_FILE_PARSER_H
+#define _TARGET_FILE_PARSER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "KeySearchTypes.h"
+
+/**
+ Parses a text file of addresses, one per line. The file is memory-mapped and
+ split on line boundaries into chunks that are decoded on a thread pool, each
+ chunk checking its Base58Check checksums in batches. Lines that fail to decode
+ are reported with their line number and skipped.
+ */
+class TargetFileParser {
+
+public:
+
+    typedef struct {
+        uint64_t line;
+        std::string text;
+    }Error;
+
+    // Appends the decoded targets and any bad lines, and returns the number of lines read.
+    // Throws KeySearchException if the file cannot be opened
+    static uint64_t parse(const std::string &fileName, std::vector<KeySearchTarget> &targets, std::vector<Error> &errors, int threads = 0);
+};
+
+#endif
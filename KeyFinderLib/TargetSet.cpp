@@ -0,0 +1,152 @@
+#include <algorithm>
+
+#include "TargetSet.h"
+#include "TargetDatabase.h"
+
+namespace {
+
+    // Number of trailing 1 bits in k
+    inline int trailingOnes(size_t k)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll(~(unsigned long long)k);
+#else
+        int n = 0;
+        while(k & 1) {
+            k >>= 1;
+            n++;
+        }
+        return n;
+#endif
+    }
+}
+
+TargetSet::Table::Table(size_t n) : storage(n), nodes(storage.data()), size(n), removed(n), count(0)
+{
+}
+
+TargetSet::Table::Table(const std::shared_ptr<const TargetDatabase> &db)
+    : database(db), nodes(db->nodes()), size((size_t)db->count() + 1), removed(size), count((size_t)db->count())
+{
+}
+
+TargetSet::TargetSet()
+{
+    _table = std::make_shared<Table>(1);
+}
+
+size_t TargetSet::fill(Table &table, const std::vector<KeySearchTarget> &sorted, size_t i, size_t k)
+{
+    // In-order walk of the implicit tree assigns the sorted values
+    if(k < table.size) {
+        i = fill(table, sorted, i, 2 * k);
+        table.storage[k] = sorted[i++];
+        i = fill(table, sorted, i, 2 * k + 1);
+    }
+
+    return i;
+}
+
+void TargetSet::build(std::vector<KeySearchTarget> &targets)
+{
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+    std::shared_ptr<Table> table = std::make_shared<Table>(targets.size() + 1);
+    table->count = targets.size();
+
+    fill(*table, targets, 0, 1);
+
+    _table = table;
+}
+
+void TargetSet::build(const std::shared_ptr<const TargetDatabase> &database)
+{
+    _table = std::make_shared<Table>(database);
+}
+
+size_t TargetSet::find(const unsigned int hash[5]) const
+{
+    const KeySearchTarget *nodes = _table->nodes;
+    KeySearchTarget t(hash);
+    size_t n = _table->size;
+    size_t k = 1;
+
+    // Go right while the node is less than the target
+    while(k < n) {
+        k = 2 * k + (size_t)(nodes[k] < t);
+    }
+
+    // Drop the trailing right turns and the last left turn to reach the lower bound
+    k >>= trailingOnes(k) + 1;
+
+    if(k == 0 || !(nodes[k] == t)) {
+        return 0;
+    }
+
+    return k;
+}
+
+bool TargetSet::contains(const unsigned int hash[5]) const
+{
+    size_t k = find(hash);
+
+    return k != 0 && !_table->removed[k].load(std::memory_order_relaxed);
+}
+
+bool TargetSet::remove(const unsigned int hash[5])
+{
+    size_t k = find(hash);
+
+    // Only the first caller to set the tombstone counts the removal
+    if(k == 0 || _table->removed[k].exchange(1)) {
+        return false;
+    }
+
+    _table->count--;
+
+    return true;
+}
+
+void TargetSet::removeFound(const TargetSet &other)
+{
+    const Table &table = *other._table;
+
+    if(&table == _table.get()) {
+        return;
+    }
+
+    for(size_t k = 1; k < table.size; k++) {
+        if(table.removed[k].load(std::memory_order_relaxed)) {
+            remove(table.nodes[k].value);
+        }
+    }
+}
+
+void TargetSet::clear()
+{
+    _table = std::make_shared<Table>(1);
+}
+
+size_t TargetSet::size() const
+{
+    return _table->count;
+}
+
+size_t TargetSet::memoryUsage() const
+{
+    return _table->size * (sizeof(KeySearchTarget) + sizeof(uint8_t));
+}
+
+void TargetSet::getTargets(std::vector<hash160> &targets) const
+{
+    const Table &table = *_table;
+
+    targets.reserve(targets.size() + table.count);
+
+    for(size_t k = 1; k < table.size; k++) {
+        if(!table.removed[k].load(std::memory_order_relaxed)) {
+            targets.push_back(hash160(table.nodes[k].value));
+        }
+    }
+}
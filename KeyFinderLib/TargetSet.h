@@ -0,0 +1,99 @@
+#ifndef _TARGET_SET_H
+#define _TARGET_SET_H
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "KeySearchTypes.h"
+
+class TargetDatabase;
+
+/**
+ Set of hash160 targets held in one contiguous array. The sorted targets are
+ stored in Eytzinger (BFS) order so a lookup walks down the implicit tree
+ without branching on the comparison, and the top levels stay in cache.
+ Removed targets are marked with a tombstone instead of moving the array.
+
+ Copies share the same table and tombstones, so one set built at startup can
+ be handed to every worker and a target removed through any copy is removed
+ from all of them. The table itself is never modified after build(), and
+ can also live in a memory-mapped TargetDatabase.
+ */
+class TargetSet {
+
+    friend class TargetDatabase;
+
+private:
+
+    struct Table {
+        // Owns the nodes when they are not in a database
+        std::vector<KeySearchTarget> storage;
+
+        std::shared_ptr<const TargetDatabase> database;
+
+        // Node k has children 2k and 2k + 1, index 0 is unused
+        const KeySearchTarget *nodes;
+        size_t size;
+
+        // Non-zero when the target at that node has been removed
+        std::vector<std::atomic<uint8_t>> removed;
+
+        std::atomic<size_t> count;
+
+        Table(size_t n);
+
+        Table(const std::shared_ptr<const TargetDatabase> &db);
+    };
+
+    std::shared_ptr<Table> _table;
+
+    static size_t fill(Table &table, const std::vector<KeySearchTarget> &sorted, size_t i, size_t k);
+
+    size_t find(const unsigned int hash[5]) const;
+
+public:
+
+    TargetSet();
+
+    // Replaces the contents with the given targets, duplicates are dropped. Earlier
+    // copies keep the previous table
+    void build(std::vector<KeySearchTarget> &targets);
+
+    // Searches the database table in place
+    void build(const std::shared_ptr<const TargetDatabase> &database);
+
+    bool contains(const unsigned int hash[5]) const;
+
+    // Returns false if the target was not in the set. Safe to call from several threads
+    bool remove(const unsigned int hash[5]);
+
+    // Removes every target that was removed from other, so targets found before a reload
+    // are not searched for again
+    void removeFound(const TargetSet &other);
+
+    void clear();
+
+    // Number of targets that have not been removed
+    size_t size() const;
+
+    // Bytes used by the table, including the mapped part of a database
+    size_t memoryUsage() const;
+
+    // Appends the remaining targets, in no particular order
+    void getTargets(std::vector<hash160> &targets) const;
+
+    // Calls f(const unsigned int hash[5]) for each remaining target without copying the table
+    template<typename F> void forEach(F f) const
+    {
+        const Table &table = *_table;
+
+        for(size_t k = 1; k < table.size; k++) {
+            if(!table.removed[k].load(std::memory_order_relaxed)) {
+                f(table.nodes[k].value);
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include <sys/stat.h>
+#include <chrono>
+
+#include "TargetWatcher.h"
+#include "KeyFinder.h"
+#include "Logger.h"
+
+bool TargetWatcher::FileState::operator==(const FileState &other) const
+{
+    return exists == other.exists && modified == other.modified && size == other.size;
+}
+
+TargetWatcher::TargetWatcher()
+{
+    _intervalMs = 0;
+    _running = false;
+}
+
+TargetWatcher::~TargetWatcher()
+{
+    stop();
+}
+
+TargetWatcher::FileState TargetWatcher::getState(const std::string &fileName)
+{
+    FileState state;
+
+    struct stat st;
+
+    if(stat(fileName.c_str(), &st) != 0) {
+        state.exists = false;
+        state.modified = 0;
+        state.size = 0;
+    } else {
+        state.exists = true;
+        state.modified = (int64_t)st.st_mtime;
+        state.size = (uint64_t)st.st_size;
+    }
+
+    return state;
+}
+
+void TargetWatcher::start(const std::string &fileName, const TargetSet &targets, uint64_t intervalMs, Callback callback)
+{
+    stop();
+
+    _fileName = fileName;
+    _targets = targets;
+    _intervalMs = intervalMs;
+    _callback = callback;
+    _running = true;
+
+    _thread = std::thread(&TargetWatcher::run, this);
+}
+
+void TargetWatcher::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+    }
+
+    _wake.notify_all();
+
+    if(_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+void TargetWatcher::run()
+{
+    FileState loaded = getState(_fileName);
+    FileState previous = loaded;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while(_running) {
+        _wake.wait_for(lock, std::chrono::milliseconds(_intervalMs), [this] { return !_running; });
+
+        if(!_running) {
+            break;
+        }
+
+        FileState current = getState(_fileName);
+
+        // Still being written if it changed since the last poll
+        bool stable = current == previous;
+        previous = current;
+
+        if(!current.exists || !stable || current == loaded) {
+            continue;
+        }
+
+        loaded = current;
+
+        lock.unlock();
+        reload();
+        lock.lock();
+    }
+}
+
+void TargetWatcher::reload()
+{
+    Logger::log(LogLevel::Info, "Targets file changed, reloading " + _fileName);
+
+    TargetSet targets;
+
+    try {
+        KeyFinder::loadTargets(_fileName, targets);
+    } catch(KeySearchException &ex) {
+        Logger::log(LogLevel::Error, "Targets not reloaded: " + ex.msg);
+        return;
+    }
+
+    // Keys found since the last load are not searched for again
+    targets.removeFound(_targets);
+
+    try {
+        _callback(targets);
+    } catch(KeySearchException &ex) {
+        Logger::log(LogLevel::Error, "Targets not reloaded: " + ex.msg);
+        return;
+    }
+
+    _targets = targets;
+}
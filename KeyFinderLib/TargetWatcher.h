@@ -0,0 +1,76 @@
+#ifndef _TARGET_WATCHER_H
+#define _TARGET_WATCHER_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "TargetSet.h"
+
+/**
+ Polls a targets file or database on a background thread and loads it again
+ when it changes. The new set is passed to the callback with the targets found
+ so far already removed, so the callback can hand it to the running workers.
+
+ The file is only read once its size and modification time are the same on two
+ polls in a row. A database is memory-mapped while it is searched, so replace it
+ by writing the new file next to it and renaming it over the old one, never by
+ writing to it in place.
+ */
+class TargetWatcher {
+
+public:
+
+    typedef std::function<void(const TargetSet &)> Callback;
+
+private:
+
+    struct FileState {
+        bool exists;
+        int64_t modified;
+        uint64_t size;
+
+        bool operator==(const FileState &other) const;
+    };
+
+    std::string _fileName;
+
+    // Set most recently handed to the callback, shares its table with the workers
+    TargetSet _targets;
+
+    uint64_t _intervalMs;
+
+    Callback _callback;
+
+    std::thread _thread;
+
+    std::mutex _mutex;
+
+    std::condition_variable _wake;
+
+    bool _running;
+
+    TargetWatcher(const TargetWatcher &);
+    TargetWatcher &operator=(const TargetWatcher &);
+
+    static FileState getState(const std::string &fileName);
+
+    void run();
+
+    void reload();
+
+public:
+
+    TargetWatcher();
+
+    ~TargetWatcher();
+
+    // Starts watching fileName. targets is the set loaded from it at startup
+    void start(const std::string &fileName, const TargetSet &targets, uint64_t intervalMs, Callback callback);
+
+    void stop();
+};
+
+#endif
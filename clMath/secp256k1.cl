@@ -45,6 +45,17 @@ __constant unsigned int _INFINITY[8] = {
     0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF
 };
 
+/**
+ * Cube roots of unity mod P. (beta * x, y) is the point lambda * (x, y)
+ */
+__constant unsigned int _BETA[8] = {
+    0x7AE96A2B, 0x657C0710, 0x6E64479E, 0xAC3434E9, 0x9CF04975, 0x12F58995, 0xC1396C28, 0x719501EE
+};
+
+__constant unsigned int _BETA2[8] = {
+    0x851695D4, 0x9A83F8EF, 0x919BB861, 0x53CBCB16, 0x630FB68A, 0xED0A766A, 0x3EC693D6, 0x8E6AFA40
+};
+
 void printBigInt(const unsigned int x[8])
 {
     printf("%.8x %.8x %.8x %.8x %.8x %.8x %.8x %.8x\n",
@@ -336,6 +347,14 @@ uint256_t subModP256k(uint256_t a, uint256_t b)
 }
 
 
+uint256_t negModP256k(uint256_t a)
+{
+    uint256_t zero = { {0, 0, 0, 0, 0, 0, 0, 0} };
+
+    return subModP256k(zero, a);
+}
+
+
 uint256_t addModP256k(uint256_t a, uint256_t b)
 {
     unsigned int carry = 0;
@@ -14,11 +14,32 @@ const int DEFAULT_THREADS_PER_BLOCK = 256;
 const int DEFAULT_POINTS_PER_THREAD = 32;
 const int DEFAULT_BLOCKS = 0;  // Auto-detect
 
+// Default CPU settings
+const bool DEFAULT_USE_CPU = true;
+const int DEFAULT_CPU_THREADS = 0;  // Auto-detect
+const int DEFAULT_CPU_POINTS_PER_THREAD = 1024;
+
 // Default search settings
 const std::string DEFAULT_TARGETS_FILE = "address.txt";
 const std::string DEFAULT_OUTPUT_FILE = "Success.txt";
 const std::string DEFAULT_COMPRESSION = "UNCOMPRESSED";
 const bool DEFAULT_RANDOM256 = true;
+const bool DEFAULT_ENDOMORPHISM = false;
+const bool DEFAULT_CENTRE_OUT = false;
+const int DEFAULT_JUMP_INTERVAL_MS = 0;  // Never
+const std::string DEFAULT_KEYSPACE = "";
+const std::string DEFAULT_STRIDE = "1";
+const int DEFAULT_NODE_INDEX = 0;
+const int DEFAULT_NODE_COUNT = 1;
+const std::string DEFAULT_TARGET_FILTER = "auto";
+const int DEFAULT_TARGETS_RELOAD_INTERVAL_MS = 30000;
+const double DEFAULT_FILTER_FALSE_POSITIVE_RATE = 0.0;
+const int DEFAULT_VERIFY_THREADS = 2;
+const std::string DEFAULT_CHECKPOINT_FILE = "";  // No checkpoints
+const int DEFAULT_CHECKPOINT_INTERVAL_MS = 60000;
+const bool DEFAULT_CHECKPOINT_POINTS = false;
+const std::string DEFAULT_COVERAGE_FILE = "";  // No coverage index
+const int DEFAULT_COVERAGE_INTERVAL_MS = 60000;
 
 // Default display settings
 const int DEFAULT_UPDATE_INTERVAL_MS = 1000;
@@ -62,14 +62,34 @@ struct Config {
         int pointsPerThread;
     } gpu;
 
+    struct CPUConfig {
+        bool enabled;
+        int threads;           // 0 = one per core not used by a GPU worker
+        int pointsPerThread;
+    } cpu;
+
     struct SearchConfig {
         std::string targetsFile;
         std::string outputFile;
         std::string compression;
         bool random256;
+        bool endomorphism;     // Also test -k, lambda*k, lambda^2*k... (random256 only)
+        bool centreOut;        // Step each centre point +/- a table of multiples of G
+        int jumpIntervalMs;    // Move each device to a new random key this often (random256 only), 0 = never
+        std::string keyspace;  // "start:end" in hex, shared between the devices. Empty = random256 starts
+        std::string stride;    // Hex distance between keys
+        int nodeIndex;         // Part of the keyspace this machine searches, 0 to nodeCount - 1
+        int nodeCount;         // Machines the keyspace is split between
+        std::string targetFilter; // "auto", "bloom", or "fuse8", "fuse16", "fuse32" for a binary fuse filter
         int statusIntervalMs;
-        std::string checkpointFile;
+        std::string checkpointFile;   // Progress journal to resume from. Empty = no checkpoints
         int checkpointIntervalMs;
+        bool checkpointPoints; // Also save the device points, so a resume skips generating them
+        std::string coverageFile;     // Index of the keys searched by every run, skipped by later ones. Empty = none
+        int coverageIntervalMs;
+        int targetsReloadIntervalMs; // Poll the targets file for changes, 0 = never
+        double filterFalsePositiveRate; // Device filter false positive rate, 0 = device default
+        int verifyThreads;     // Host threads checking filter hits, per GPU
     } search;
 
     struct DisplayConfig {
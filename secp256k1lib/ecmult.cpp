@@ -0,0 +1,494 @@
+#include<atomic>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+#include "secp256k1.h"
+#include "group.h"
+
+using namespace secp256k1;
+
+namespace {
+
+	// The fixed-base table splits the scalar into 8-bit windows. Window w holds
+	// j * 2^(8w) * G for j = 1..255, so k * G is one mixed addition per window.
+	const int WINDOW_BITS = 8;
+	const int WINDOWS = 256 / WINDOW_BITS;
+	const int WINDOW_SIZE = (1 << WINDOW_BITS) - 1;
+
+	// Smaller batches are not worth starting a thread for
+	const size_t MIN_KEYS_PER_THREAD = 256;
+
+	class FixedBaseTable {
+
+	private:
+		std::vector<ge> _table;
+
+	public:
+		ecpoint basePoint;
+
+		FixedBaseTable(const ecpoint &p)
+		{
+			basePoint = p;
+
+			_table.resize(WINDOWS * WINDOW_SIZE);
+
+			std::vector<gej> row(WINDOW_SIZE);
+
+			ge base;
+			geFromEcpoint(base, p);
+
+			for(int w = 0; w < WINDOWS; w++) {
+
+				// j * base for j = 1..255
+				gejSetGe(row[0], base);
+				for(int j = 1; j < WINDOW_SIZE; j++) {
+					gejAddGe(row[j], row[j - 1], base);
+				}
+
+				// 256 * base is the base of the next window
+				gej next;
+				gejAddGe(next, row[WINDOW_SIZE - 1], base);
+
+				gejNormalizeBatch(row.data(), &_table[w * WINDOW_SIZE], WINDOW_SIZE);
+
+				gejNormalizeBatch(&next, &base, 1);
+			}
+		}
+
+		const ge &get(int window, int value) const
+		{
+			return _table[window * WINDOW_SIZE + value - 1];
+		}
+	};
+
+	std::once_flag _tableOnce;
+	FixedBaseTable *_fixedBaseTable = NULL;
+
+	const FixedBaseTable &getFixedBaseTable()
+	{
+		std::call_once(_tableOnce, []() {
+			_fixedBaseTable = new FixedBaseTable(G());
+		});
+
+		return *_fixedBaseTable;
+	}
+
+	// Table for the most recently used base point other than G
+	std::mutex _lastTableMutex;
+	std::shared_ptr<const FixedBaseTable> _lastTable;
+
+	std::shared_ptr<const FixedBaseTable> getTable(const ecpoint &p)
+	{
+		std::lock_guard<std::mutex> lock(_lastTableMutex);
+
+		if(!_lastTable || !(_lastTable->basePoint == p)) {
+			_lastTable = std::make_shared<const FixedBaseTable>(p);
+		}
+
+		return _lastTable;
+	}
+
+	void multiplyGJacobian(gej &r, const uint256 &k, const FixedBaseTable &table)
+	{
+		gejSetInfinity(r);
+
+		for(int w = 0; w < WINDOWS; w++) {
+			int value = (k.v[w / 4] >> ((w % 4) * 8)) & 0xff;
+
+			if(value) {
+				gejAddGe(r, r, table.get(w, value));
+			}
+		}
+	}
+
+	/**
+	 Multiplies every key by the table's base point. The keys are split into one
+	 contiguous range per thread and each range is normalized with its own batch
+	 inversion. Returns false if validate is set and a result is not on the curve.
+	 */
+	bool multiplyBatch(const FixedBaseTable &table, const std::vector<uint256> &k, std::vector<ecpoint> &pointsOut, int threads, bool validate)
+	{
+		size_t count = k.size();
+
+		pointsOut.resize(count);
+
+		if(threads <= 0) {
+			threads = (int)std::thread::hardware_concurrency();
+		}
+
+		size_t maxThreads = (count + MIN_KEYS_PER_THREAD - 1) / MIN_KEYS_PER_THREAD;
+		if((size_t)threads > maxThreads) {
+			threads = (int)maxThreads;
+		}
+		if(threads < 1) {
+			threads = 1;
+		}
+
+		size_t perThread = (count + threads - 1) / threads;
+
+		std::atomic<bool> valid(true);
+
+		auto worker = [&](size_t begin, size_t end) {
+			std::vector<gej> jacobian(end - begin);
+			std::vector<ge> affine(end - begin);
+
+			for(size_t i = begin; i < end; i++) {
+				multiplyGJacobian(jacobian[i - begin], k[i], table);
+			}
+
+			gejNormalizeBatch(jacobian.data(), affine.data(), end - begin);
+
+			for(size_t i = begin; i < end; i++) {
+				pointsOut[i] = geToEcpoint(affine[i - begin]);
+
+				if(validate && !affine[i - begin].infinity && !pointExists(pointsOut[i])) {
+					valid = false;
+				}
+			}
+		};
+
+		std::vector<std::thread> pool;
+
+		for(int t = 1; t < threads; t++) {
+			size_t begin = perThread * t;
+			size_t end = begin + perThread < count ? begin + perThread : count;
+
+			if(begin < end) {
+				pool.push_back(std::thread(worker, begin, end));
+			}
+		}
+
+		worker(0, perThread < count ? perThread : count);
+
+		for(size_t t = 0; t < pool.size(); t++) {
+			pool[t].join();
+		}
+
+		return valid;
+	}
+
+	// Window size for variable-base points: odd multiples 1P, 3P, ..., 15P
+	const int WNAF_WINDOW = 5;
+	const int WNAF_TABLE_SIZE = 1 << (WNAF_WINDOW - 2);
+
+	// Split scalars are below 2^128, the carry out of the top window needs one more digit
+	const int WNAF_MAX_BITS = 129;
+
+	// round(2^384 * b2 / N) and round(2^384 * -b1 / N) for the lattice basis of LAMBDA
+	const unsigned int _G1_WORDS[8] = { 0x45DBB031, 0xE893209A, 0x71E8CA7F, 0x3DAA8A14, 0x9284EB15, 0xE86C90E4, 0xA7D46BCD, 0x3086D221 };
+	const unsigned int _G2_WORDS[8] = { 0x8AC47F71, 0x1571B4AE, 0x9DF506C6, 0x221208AC, 0x0ABFE4C4, 0x6F547FA9, 0x010E8828, 0xE4437ED6 };
+
+	// -b1 and -b2 mod N
+	const unsigned int _MINUS_B1_WORDS[8] = { 0x0ABFE4C3, 0x6F547FA9, 0x010E8828, 0xE4437ED6, 0x00000000, 0x00000000, 0x00000000, 0x00000000 };
+	const unsigned int _MINUS_B2_WORDS[8] = { 0x3DB1562C, 0xD765CDA8, 0x0774346D, 0x8A280AC5, 0xFFFFFFFE, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF };
+
+	// round(a * b / 2^384)
+	uint256 mulShift384(const uint256 &a, const uint256 &b)
+	{
+		unsigned int product[16] = { 0 };
+
+		for(int i = 0; i < 8; i++) {
+			uint64_t carry = 0;
+
+			for(int j = 0; j < 8; j++) {
+				uint64_t t = (uint64_t)a.v[i] * b.v[j] + product[i + j] + carry;
+				product[i + j] = (unsigned int)t;
+				carry = t >> 32;
+			}
+
+			product[i + 8] = (unsigned int)carry;
+		}
+
+		uint256 r;
+		for(int i = 0; i < 4; i++) {
+			r.v[i] = product[12 + i];
+		}
+
+		// Round using bit 383
+		if(product[11] >> 31) {
+			r = r.add(1);
+		}
+
+		return r;
+	}
+
+	bool fitsIn128(const uint256 &x)
+	{
+		return (x.v[4] | x.v[5] | x.v[6] | x.v[7]) == 0;
+	}
+
+	/**
+	 Splits k into k1 + k2 * LAMBDA (mod N). Each half is returned as its absolute
+	 value, below 2^128, with the sign in neg1 and neg2
+	 */
+	void splitLambda(const uint256 &k, uint256 &k1, bool &neg1, uint256 &k2, bool &neg2)
+	{
+		uint256 c1 = mulShift384(k, uint256(_G1_WORDS));
+		uint256 c2 = mulShift384(k, uint256(_G2_WORDS));
+
+		k2 = addModN(multiplyModN(c1, uint256(_MINUS_B1_WORDS)), multiplyModN(c2, uint256(_MINUS_B2_WORDS)));
+		k1 = subModN(k, multiplyModN(k2, LAMBDA));
+
+		neg1 = !fitsIn128(k1);
+		if(neg1) {
+			k1 = negModN(k1);
+		}
+
+		neg2 = !fitsIn128(k2);
+		if(neg2) {
+			k2 = negModN(k2);
+		}
+	}
+
+	// Reads count bits of x starting at bit offset
+	int getBits(const uint256 &x, int offset, int count)
+	{
+		int word = offset / 32;
+		int shift = offset % 32;
+
+		uint64_t bits = x.v[word];
+		if(word < 7) {
+			bits |= (uint64_t)x.v[word + 1] << 32;
+		}
+
+		return (int)((bits >> shift) & ((1u << count) - 1));
+	}
+
+	/**
+	 Width-w NAF of x < 2^128: odd digits in (-2^(w-1), 2^(w-1)) with at least w - 1
+	 zeros between them. Returns the number of digits written to naf.
+	 */
+	int toWnaf(const uint256 &x, bool negate, int naf[WNAF_MAX_BITS])
+	{
+		int len = 0;
+		int carry = 0;
+		int bit = 0;
+
+		for(int i = 0; i < WNAF_MAX_BITS; i++) {
+			naf[i] = 0;
+		}
+
+		while(bit < WNAF_MAX_BITS) {
+			if(getBits(x, bit, 1) == carry) {
+				bit++;
+				continue;
+			}
+
+			int now = WNAF_WINDOW;
+			if(now > WNAF_MAX_BITS - bit) {
+				now = WNAF_MAX_BITS - bit;
+			}
+
+			int digit = getBits(x, bit, now) + carry;
+
+			carry = (digit >> (WNAF_WINDOW - 1)) & 1;
+			digit -= carry << WNAF_WINDOW;
+
+			naf[bit] = negate ? -digit : digit;
+			len = bit + 1;
+			bit += now;
+		}
+
+		return len;
+	}
+
+	// Odd multiples p, 3p, ..., (2 * WNAF_TABLE_SIZE - 1)p in affine coordinates
+	void oddMultiples(const ge &p, ge table[WNAF_TABLE_SIZE])
+	{
+		gej multiples[WNAF_TABLE_SIZE];
+		gej twice;
+		ge twiceAffine;
+
+		gejSetGe(multiples[0], p);
+		gejDouble(twice, multiples[0]);
+		gejNormalizeBatch(&twice, &twiceAffine, 1);
+
+		for(int i = 1; i < WNAF_TABLE_SIZE; i++) {
+			gejAddGe(multiples[i], multiples[i - 1], twiceAffine);
+		}
+
+		gejNormalizeBatch(multiples, table, WNAF_TABLE_SIZE);
+	}
+
+	// LAMBDA * (x, y) = (BETA * x, y)
+	void geMulLambda(ge &r, const ge &p)
+	{
+		fe beta;
+		feFromUint256(beta, BETA);
+
+		feMul(r.x, p.x, beta);
+		r.y = p.y;
+		r.infinity = p.infinity;
+	}
+
+	struct WnafTerm {
+		int naf[WNAF_MAX_BITS];
+		int len;
+		ge table[WNAF_TABLE_SIZE];
+	};
+
+	/**
+	 Strauss' method: the wNAF expansions of all terms share one chain of
+	 doublings, so the cost is about 128 doublings however many terms there are
+	 */
+	void ecmultStrauss(gej &r, const std::vector<WnafTerm> &terms)
+	{
+		int len = 0;
+		for(size_t i = 0; i < terms.size(); i++) {
+			if(terms[i].len > len) {
+				len = terms[i].len;
+			}
+		}
+
+		gejSetInfinity(r);
+
+		for(int bit = len - 1; bit >= 0; bit--) {
+			gejDouble(r, r);
+
+			for(size_t i = 0; i < terms.size(); i++) {
+				int digit = terms[i].naf[bit];
+
+				if(digit > 0) {
+					gejAddGe(r, r, terms[i].table[(digit - 1) / 2]);
+				} else if(digit < 0) {
+					ge neg;
+					geNeg(neg, terms[i].table[(-digit - 1) / 2]);
+					gejAddGe(r, r, neg);
+				}
+			}
+		}
+	}
+}
+
+void secp256k1::gejNormalizeBatch(const gej *in, ge *out, size_t count)
+{
+	std::vector<fe> products(count);
+
+	// Running product of the Z coordinates, skipping points at infinity
+	fe total;
+	feSetInt(total, 1);
+
+	for(size_t i = 0; i < count; i++) {
+		if(!in[i].infinity) {
+			feMul(total, total, in[i].z);
+		}
+		products[i] = total;
+	}
+
+	fe inverse;
+	feInv(inverse, total);
+
+	for(size_t i = count; i-- > 0; ) {
+		if(in[i].infinity) {
+			out[i].infinity = true;
+			continue;
+		}
+
+		// 1 / Z[i] = inverse * (Z[0] * ... * Z[i - 1])
+		fe zInv;
+		if(i > 0) {
+			feMul(zInv, inverse, products[i - 1]);
+		} else {
+			zInv = inverse;
+		}
+
+		feMul(inverse, inverse, in[i].z);
+
+		geSetGejZInv(out[i], in[i], zInv);
+	}
+}
+
+ecpoint secp256k1::multiplyG(const uint256 &k)
+{
+	gej r;
+	ge a;
+
+	multiplyGJacobian(r, k, getFixedBaseTable());
+
+	gejNormalizeBatch(&r, &a, 1);
+
+	return geToEcpoint(a);
+}
+
+void secp256k1::multiplyGBatch(const std::vector<uint256> &k, std::vector<ecpoint> &pointsOut, int threads)
+{
+	multiplyBatch(getFixedBaseTable(), k, pointsOut, threads, false);
+}
+
+void secp256k1::generateKeyPairsBulk(const ecpoint &basePoint, std::vector<uint256> &privKeys, std::vector<ecpoint> &pubKeysOut, int threads, bool validate)
+{
+	bool valid;
+
+	if(basePoint == G()) {
+		valid = multiplyBatch(getFixedBaseTable(), privKeys, pubKeysOut, threads, validate);
+	} else {
+		if(validate && !pointExists(basePoint)) {
+			throw std::string("Point does not exist");
+		}
+
+		valid = multiplyBatch(*getTable(basePoint), privKeys, pubKeysOut, threads, validate);
+	}
+
+	if(!valid) {
+		throw std::string("Point does not exist");
+	}
+}
+
+ecpoint secp256k1::multiplyPoints(const std::vector<uint256> &k, const std::vector<ecpoint> &p)
+{
+	// Each term k * P becomes k1 * P + k2 * (LAMBDA * P) with 128-bit k1, k2
+	std::vector<WnafTerm> terms(2 * k.size());
+
+	for(size_t i = 0; i < k.size(); i++) {
+		WnafTerm &t1 = terms[2 * i];
+		WnafTerm &t2 = terms[2 * i + 1];
+
+		if(isPointAtInfinity(p[i])) {
+			t1.len = 0;
+			t2.len = 0;
+			continue;
+		}
+
+		uint256 scalar = k[i];
+		if(scalar.cmp(N) >= 0) {
+			scalar = scalar - N;
+		}
+
+		uint256 k1;
+		uint256 k2;
+		bool neg1;
+		bool neg2;
+		splitLambda(scalar, k1, neg1, k2, neg2);
+
+		t1.len = toWnaf(k1, neg1, t1.naf);
+		t2.len = toWnaf(k2, neg2, t2.naf);
+
+		ge a;
+		geFromEcpoint(a, p[i]);
+		oddMultiples(a, t1.table);
+
+		for(int j = 0; j < WNAF_TABLE_SIZE; j++) {
+			geMulLambda(t2.table[j], t1.table[j]);
+		}
+	}
+
+	gej r;
+	ge a;
+
+	ecmultStrauss(r, terms);
+
+	gejNormalizeBatch(&r, &a, 1);
+
+	return geToEcpoint(a);
+}
+
+ecpoint secp256k1::multiplyPoint(const uint256 &k, const ecpoint &p)
+{
+	if(p == G()) {
+		return multiplyG(k);
+	}
+
+	return multiplyPoints(std::vector<uint256>(1, k), std::vector<ecpoint>(1, p));
+}
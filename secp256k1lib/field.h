@@ -0,0 +1,305 @@
+#ifndef _HOST_SECP256K1_FIELD_H
+#define _HOST_SECP256K1_FIELD_H
+
+#include<stdint.h>
+
+#include "secp256k1.h"
+
+#if !defined(__SIZEOF_INT128__) && defined(_MSC_VER) && defined(_M_X64)
+#include<intrin.h>
+#endif
+
+namespace secp256k1 {
+
+	/**
+	 Element of the field mod P held in four 64-bit little-endian limbs. The
+	 functions below take fully reduced inputs and return fully reduced outputs.
+	 */
+	struct fe {
+		uint64_t d[4];
+	};
+
+	// P = 2^256 - C
+	const uint64_t _FE_C = 0x1000003D1ULL;
+
+	const uint64_t _FE_P0 = 0xFFFFFFFEFFFFFC2FULL;
+
+	// 64 x 64 -> 128-bit multiply, returns the low half
+	static inline uint64_t mul64(uint64_t a, uint64_t b, uint64_t &hi)
+	{
+#if defined(__SIZEOF_INT128__)
+		unsigned __int128 p = (unsigned __int128)a * b;
+		hi = (uint64_t)(p >> 64);
+		return (uint64_t)p;
+#elif defined(_MSC_VER) && defined(_M_X64)
+		return _umul128(a, b, &hi);
+#else
+		uint64_t aLo = (uint32_t)a;
+		uint64_t aHi = a >> 32;
+		uint64_t bLo = (uint32_t)b;
+		uint64_t bHi = b >> 32;
+
+		uint64_t ll = aLo * bLo;
+		uint64_t lh = aLo * bHi;
+		uint64_t hl = aHi * bLo;
+		uint64_t hh = aHi * bHi;
+
+		uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+
+		hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+		return (mid << 32) | (uint32_t)ll;
+#endif
+	}
+
+	// (c2, c1, c0) += a * b
+	static inline void mulAdd(uint64_t a, uint64_t b, uint64_t &c0, uint64_t &c1, uint64_t &c2)
+	{
+		uint64_t hi;
+		uint64_t lo = mul64(a, b, hi);
+
+		c0 += lo;
+		hi += (c0 < lo);
+		c1 += hi;
+		c2 += (c1 < hi);
+	}
+
+	// (c2, c1, c0) += 2 * a * b
+	static inline void mulAdd2(uint64_t a, uint64_t b, uint64_t &c0, uint64_t &c1, uint64_t &c2)
+	{
+		uint64_t hi;
+		uint64_t lo = mul64(a, b, hi);
+
+		c2 += hi >> 63;
+		hi = (hi << 1) | (lo >> 63);
+		lo <<= 1;
+
+		c0 += lo;
+		hi += (c0 < lo);
+		c1 += hi;
+		c2 += (c1 < hi);
+	}
+
+	static inline void feFromUint256(fe &r, const uint256 &x)
+	{
+		for(int i = 0; i < 4; i++) {
+			r.d[i] = (uint64_t)x.v[2 * i] | ((uint64_t)x.v[2 * i + 1] << 32);
+		}
+	}
+
+	static inline uint256 feToUint256(const fe &x)
+	{
+		uint256 r;
+
+		for(int i = 0; i < 4; i++) {
+			r.v[2 * i] = (uint32_t)x.d[i];
+			r.v[2 * i + 1] = (uint32_t)(x.d[i] >> 32);
+		}
+
+		return r;
+	}
+
+	static inline void feSetInt(fe &r, uint64_t x)
+	{
+		r.d[0] = x;
+		r.d[1] = 0;
+		r.d[2] = 0;
+		r.d[3] = 0;
+	}
+
+	static inline bool feIsZero(const fe &x)
+	{
+		return (x.d[0] | x.d[1] | x.d[2] | x.d[3]) == 0;
+	}
+
+	static inline bool feEqual(const fe &a, const fe &b)
+	{
+		return ((a.d[0] ^ b.d[0]) | (a.d[1] ^ b.d[1]) | (a.d[2] ^ b.d[2]) | (a.d[3] ^ b.d[3])) == 0;
+	}
+
+	static inline bool feIsOdd(const fe &x)
+	{
+		return (x.d[0] & 1) != 0;
+	}
+
+	// r = x + C, returns the carry out of 2^256
+	static inline uint64_t feAddC(fe &r, const fe &x)
+	{
+		r.d[0] = x.d[0] + _FE_C;
+		uint64_t carry = r.d[0] < _FE_C;
+
+		for(int i = 1; i < 4; i++) {
+			r.d[i] = x.d[i] + carry;
+			carry = r.d[i] < carry;
+		}
+
+		return carry;
+	}
+
+	static inline void feAdd(fe &r, const fe &a, const fe &b)
+	{
+		fe s;
+		uint64_t carry = 0;
+
+		for(int i = 0; i < 4; i++) {
+			uint64_t t = a.d[i] + carry;
+			carry = t < carry;
+			s.d[i] = t + b.d[i];
+			carry += s.d[i] < t;
+		}
+
+		// s >= P exactly when s + C overflows 2^256
+		fe t;
+		carry |= feAddC(t, s);
+
+		r = carry ? t : s;
+	}
+
+	static inline void feSub(fe &r, const fe &a, const fe &b)
+	{
+		uint64_t borrow = 0;
+
+		for(int i = 0; i < 4; i++) {
+			uint64_t t = a.d[i] - b.d[i];
+			uint64_t b1 = a.d[i] < b.d[i];
+			r.d[i] = t - borrow;
+			borrow = b1 | (t < borrow);
+		}
+
+		// Adding P is the same as subtracting C mod 2^256
+		if(borrow) {
+			uint64_t t = r.d[0];
+			r.d[0] = t - _FE_C;
+			borrow = t < _FE_C;
+
+			for(int i = 1; i < 4; i++) {
+				t = r.d[i];
+				r.d[i] = t - borrow;
+				borrow = t < borrow;
+			}
+		}
+	}
+
+	static inline void feNeg(fe &r, const fe &x)
+	{
+		fe zero;
+		feSetInt(zero, 0);
+
+		feSub(r, zero, x);
+	}
+
+	/**
+	 Reduces a 512-bit product mod P using 2^256 = C (mod P)
+	 */
+	static inline void feReduce(fe &r, const uint64_t t[8])
+	{
+		// t_low + t_high * C, one limb at a time. The carry stays below 2^35
+		uint64_t carry = 0;
+
+		for(int i = 0; i < 4; i++) {
+			uint64_t hi;
+			uint64_t lo = mul64(t[4 + i], _FE_C, hi);
+
+			lo += carry;
+			hi += (lo < carry);
+
+			lo += t[i];
+			hi += (lo < t[i]);
+
+			r.d[i] = lo;
+			carry = hi;
+		}
+
+		// Fold the remaining high part (at most 35 bits) back in
+		uint64_t hi;
+		uint64_t lo = mul64(carry, _FE_C, hi);
+
+		r.d[0] += lo;
+		carry = r.d[0] < lo;
+
+		uint64_t t1 = hi + carry;
+		r.d[1] += t1;
+		carry = r.d[1] < t1;
+
+		r.d[2] += carry;
+		carry = r.d[2] < carry;
+
+		r.d[3] += carry;
+		carry = r.d[3] < carry;
+
+		// Wrapped past 2^256: the result is small, add C once more
+		if(carry) {
+			feAddC(r, r);
+		}
+
+		// Final subtraction of P
+		if((r.d[1] & r.d[2] & r.d[3]) == 0xFFFFFFFFFFFFFFFFULL && r.d[0] >= _FE_P0) {
+			r.d[0] -= _FE_P0;
+			r.d[1] = 0;
+			r.d[2] = 0;
+			r.d[3] = 0;
+		}
+	}
+
+	static inline void feInv(fe &r, const fe &x)
+	{
+		feFromUint256(r, invModP(feToUint256(x)));
+	}
+
+	static inline void feMul(fe &r, const fe &a, const fe &b)
+	{
+		uint64_t t[8];
+		uint64_t c0 = 0;
+		uint64_t c1 = 0;
+		uint64_t c2 = 0;
+
+		// Column-wise schoolbook product
+		for(int k = 0; k < 7; k++) {
+			int lo = k < 4 ? 0 : k - 3;
+			int hi = k < 4 ? k : 3;
+
+			for(int i = lo; i <= hi; i++) {
+				mulAdd(a.d[i], b.d[k - i], c0, c1, c2);
+			}
+
+			t[k] = c0;
+			c0 = c1;
+			c1 = c2;
+			c2 = 0;
+		}
+		t[7] = c0;
+
+		feReduce(r, t);
+	}
+
+	static inline void feSqr(fe &r, const fe &a)
+	{
+		uint64_t t[8];
+		uint64_t c0 = 0;
+		uint64_t c1 = 0;
+		uint64_t c2 = 0;
+
+		// Each cross product a[i] * a[j] (i != j) appears twice in the square
+		for(int k = 0; k < 7; k++) {
+			int lo = k < 4 ? 0 : k - 3;
+			int hi = k < 4 ? k : 3;
+
+			for(int i = lo; i < k - i; i++) {
+				mulAdd2(a.d[i], a.d[k - i], c0, c1, c2);
+			}
+
+			if((k & 1) == 0 && k / 2 >= lo && k / 2 <= hi) {
+				mulAdd(a.d[k / 2], a.d[k / 2], c0, c1, c2);
+			}
+
+			t[k] = c0;
+			c0 = c1;
+			c1 = c2;
+			c2 = 0;
+		}
+		t[7] = c0;
+
+		feReduce(r, t);
+	}
+}
+
+#endif
@@ -0,0 +1,273 @@
+#ifndef _HOST_SECP256K1_GROUP_H
+#define _HOST_SECP256K1_GROUP_H
+
+#include "secp256k1.h"
+#include "field.h"
+
+namespace secp256k1 {
+
+	// Point in affine coordinates
+	struct ge {
+		fe x;
+		fe y;
+		bool infinity;
+	};
+
+	// Point in Jacobian coordinates, (X / Z^2, Y / Z^3)
+	struct gej {
+		fe x;
+		fe y;
+		fe z;
+		bool infinity;
+	};
+
+	static inline void geFromEcpoint(ge &r, const ecpoint &p)
+	{
+		r.infinity = isPointAtInfinity(p);
+		feFromUint256(r.x, p.x);
+		feFromUint256(r.y, p.y);
+	}
+
+	static inline ecpoint geToEcpoint(const ge &p)
+	{
+		if(p.infinity) {
+			return pointAtInfinity();
+		}
+
+		return ecpoint(feToUint256(p.x), feToUint256(p.y));
+	}
+
+	static inline void gejSetInfinity(gej &r)
+	{
+		feSetInt(r.x, 0);
+		feSetInt(r.y, 0);
+		feSetInt(r.z, 0);
+		r.infinity = true;
+	}
+
+	static inline void gejSetGe(gej &r, const ge &p)
+	{
+		r.x = p.x;
+		r.y = p.y;
+		feSetInt(r.z, 1);
+		r.infinity = p.infinity;
+	}
+
+	static inline void geNeg(ge &r, const ge &p)
+	{
+		r.x = p.x;
+		feNeg(r.y, p.y);
+		r.infinity = p.infinity;
+	}
+
+	// Converts to affine given zInv = 1 / Z
+	static inline void geSetGejZInv(ge &r, const gej &p, const fe &zInv)
+	{
+		if(p.infinity) {
+			r.infinity = true;
+			return;
+		}
+
+		fe zInv2;
+		feSqr(zInv2, zInv);
+
+		feMul(r.x, p.x, zInv2);
+		feMul(r.y, p.y, zInv2);
+		feMul(r.y, r.y, zInv);
+		r.infinity = false;
+	}
+
+	/**
+	 r = 2p. S = 4XY^2, M = 3X^2, X' = M^2 - 2S, Y' = M(S - X') - 8Y^4, Z' = 2YZ
+	 */
+	static inline void gejDouble(gej &r, const gej &p)
+	{
+		if(p.infinity || feIsZero(p.y)) {
+			gejSetInfinity(r);
+			return;
+		}
+
+		fe y2;
+		fe s;
+		fe m;
+		fe t;
+
+		feSqr(y2, p.y);
+
+		// S = 4XY^2
+		feMul(s, p.x, y2);
+		feAdd(s, s, s);
+		feAdd(s, s, s);
+
+		// M = 3X^2
+		feSqr(t, p.x);
+		feAdd(m, t, t);
+		feAdd(m, m, t);
+
+		// Z' = 2YZ
+		feMul(r.z, p.y, p.z);
+		feAdd(r.z, r.z, r.z);
+
+		// X' = M^2 - 2S
+		fe x;
+		feSqr(x, m);
+		feSub(x, x, s);
+		feSub(x, x, s);
+
+		// Y' = M(S - X') - 8Y^4
+		feSqr(t, y2);
+		feAdd(t, t, t);
+		feAdd(t, t, t);
+		feAdd(t, t, t);
+
+		feSub(s, s, x);
+		feMul(r.y, m, s);
+		feSub(r.y, r.y, t);
+
+		r.x = x;
+		r.infinity = false;
+	}
+
+	/**
+	 r = p + q where q is affine. U2 = x2 Z^2, S2 = y2 Z^3, H = U2 - X, R = S2 - Y,
+	 X' = R^2 - H^3 - 2XH^2, Y' = R(XH^2 - X') - YH^3, Z' = ZH
+	 */
+	static inline void gejAddGe(gej &r, const gej &p, const ge &q)
+	{
+		if(q.infinity) {
+			r = p;
+			return;
+		}
+
+		if(p.infinity) {
+			gejSetGe(r, q);
+			return;
+		}
+
+		fe z2;
+		fe u2;
+		fe s2;
+		fe h;
+		fe rr;
+
+		feSqr(z2, p.z);
+		feMul(u2, q.x, z2);
+		feMul(s2, q.y, z2);
+		feMul(s2, s2, p.z);
+
+		feSub(h, u2, p.x);
+		feSub(rr, s2, p.y);
+
+		if(feIsZero(h)) {
+			if(feIsZero(rr)) {
+				gejDouble(r, p);
+			} else {
+				gejSetInfinity(r);
+			}
+			return;
+		}
+
+		fe h2;
+		fe h3;
+		fe v;
+		feSqr(h2, h);
+		feMul(h3, h2, h);
+		feMul(v, p.x, h2);
+
+		fe x;
+		feSqr(x, rr);
+		feSub(x, x, h3);
+		feSub(x, x, v);
+		feSub(x, x, v);
+
+		fe y;
+		feSub(y, v, x);
+		feMul(y, y, rr);
+		feMul(h3, h3, p.y);
+		feSub(y, y, h3);
+
+		feMul(r.z, p.z, h);
+		r.x = x;
+		r.y = y;
+		r.infinity = false;
+	}
+
+	/**
+	 r = p + q for two Jacobian points. U1 = X1 Z2^2, U2 = X2 Z1^2, S1 = Y1 Z2^3, S2 = Y2 Z1^3,
+	 H = U2 - U1, R = S2 - S1, X' = R^2 - H^3 - 2U1H^2, Y' = R(U1H^2 - X') - S1H^3, Z' = Z1Z2H
+	 */
+	static inline void gejAdd(gej &r, const gej &p, const gej &q)
+	{
+		if(q.infinity) {
+			r = p;
+			return;
+		}
+
+		if(p.infinity) {
+			r = q;
+			return;
+		}
+
+		fe z1z1;
+		fe z2z2;
+		fe u1;
+		fe u2;
+		fe s1;
+		fe s2;
+
+		feSqr(z1z1, p.z);
+		feSqr(z2z2, q.z);
+
+		feMul(u1, p.x, z2z2);
+		feMul(u2, q.x, z1z1);
+
+		feMul(s1, p.y, z2z2);
+		feMul(s1, s1, q.z);
+		feMul(s2, q.y, z1z1);
+		feMul(s2, s2, p.z);
+
+		fe h;
+		fe rr;
+		feSub(h, u2, u1);
+		feSub(rr, s2, s1);
+
+		if(feIsZero(h)) {
+			if(feIsZero(rr)) {
+				gejDouble(r, p);
+			} else {
+				gejSetInfinity(r);
+			}
+			return;
+		}
+
+		fe h2;
+		fe h3;
+		fe v;
+		feSqr(h2, h);
+		feMul(h3, h2, h);
+		feMul(v, u1, h2);
+
+		fe x;
+		feSqr(x, rr);
+		feSub(x, x, h3);
+		feSub(x, x, v);
+		feSub(x, x, v);
+
+		fe y;
+		feSub(y, v, x);
+		feMul(y, y, rr);
+		feMul(h3, h3, s1);
+		feSub(y, y, h3);
+
+		feMul(r.z, p.z, q.z);
+		feMul(r.z, r.z, h);
+		r.x = x;
+		r.y = y;
+		r.infinity = false;
+	}
+
+	// Converts count Jacobian points to affine using a single inversion
+	void gejNormalizeBatch(const gej *in, ge *out, size_t count);
+}
+
+#endif
@@ -0,0 +1,382 @@
+#include<stdint.h>
+
+#include "secp256k1.h"
+
+using namespace secp256k1;
+
+#if defined(__SIZEOF_INT128__)
+
+/**
+ Modular inversion using the safegcd algorithm of Bernstein and Yang
+ ("Fast constant-time gcd computation and modular inversion"), variable time
+ variant. Numbers are held in five signed 62-bit limbs and the divsteps are
+ applied 62 at a time through a 2x2 transition matrix.
+ */
+
+typedef __int128 int128_t;
+
+namespace {
+
+	const uint64_t M62 = UINT64_MAX >> 2;
+
+	// Value in signed 62-bit limbs: v[0] + v[1] * 2^62 + ... + v[4] * 2^248
+	struct signed62 {
+		int64_t v[5];
+	};
+
+	struct modInfo {
+		signed62 modulus;
+
+		// Inverse of the modulus mod 2^62
+		uint64_t modulusInv62;
+	};
+
+	// Transition matrix for 62 divsteps, scaled by 2^62
+	struct trans2x2 {
+		int64_t u;
+		int64_t v;
+		int64_t q;
+		int64_t r;
+	};
+
+	// P = 2^256 - 2^32 - 977
+	const modInfo _P_INFO = { { { -0x1000003D1LL, 0, 0, 0, 256 } }, 0x27C7F6E22DDACACFULL };
+
+	// N = 2^256 - 0x14551231950B75FC4402DA1732FC9BEBF
+	const modInfo _N_INFO = { { { 0x3FD25E8CD0364141LL, 0x2ABB739ABD2280EELL, -0x15LL, 0, 256 } }, 0x34F20099AA774EC1ULL };
+
+	signed62 toSigned62(const uint256 &x)
+	{
+		uint64_t a[4];
+
+		for(int i = 0; i < 4; i++) {
+			a[i] = (uint64_t)x.v[2 * i] | ((uint64_t)x.v[2 * i + 1] << 32);
+		}
+
+		signed62 r;
+		r.v[0] = (int64_t)(a[0] & M62);
+		r.v[1] = (int64_t)((a[0] >> 62 | a[1] << 2) & M62);
+		r.v[2] = (int64_t)((a[1] >> 60 | a[2] << 4) & M62);
+		r.v[3] = (int64_t)((a[2] >> 58 | a[3] << 6) & M62);
+		r.v[4] = (int64_t)(a[3] >> 56);
+
+		return r;
+	}
+
+	// Input must be normalized to [0, modulus)
+	uint256 fromSigned62(const signed62 &x)
+	{
+		uint64_t a[4];
+
+		a[0] = (uint64_t)x.v[0] | (uint64_t)x.v[1] << 62;
+		a[1] = (uint64_t)x.v[1] >> 2 | (uint64_t)x.v[2] << 60;
+		a[2] = (uint64_t)x.v[2] >> 4 | (uint64_t)x.v[3] << 58;
+		a[3] = (uint64_t)x.v[3] >> 6 | (uint64_t)x.v[4] << 56;
+
+		uint256 r;
+
+		for(int i = 0; i < 4; i++) {
+			r.v[2 * i] = (uint32_t)a[i];
+			r.v[2 * i + 1] = (uint32_t)(a[i] >> 32);
+		}
+
+		return r;
+	}
+
+	/**
+	 Performs 62 divsteps on the low bits of f and g, starting from eta = -delta.
+	 Runs of zero bits in g are skipped at once and up to 6 bits of g are cancelled
+	 per iteration. Returns the new eta and stores the transition matrix in t.
+	 */
+	int64_t divsteps62(int64_t eta, uint64_t f0, uint64_t g0, trans2x2 &t)
+	{
+		uint64_t u = 1;
+		uint64_t v = 0;
+		uint64_t q = 0;
+		uint64_t r = 1;
+		uint64_t f = f0;
+		uint64_t g = g0;
+		uint64_t m;
+		uint32_t w;
+		int i = 62;
+		int limit;
+		int zeros;
+
+		for(;;) {
+			// Use a sentinel bit to count zeros only up to i
+			zeros = __builtin_ctzll(g | (UINT64_MAX << i));
+
+			// Each zero bit is a divstep that just halves g
+			g >>= zeros;
+			u <<= zeros;
+			v <<= zeros;
+			eta -= zeros;
+			i -= zeros;
+
+			if(i == 0) {
+				break;
+			}
+
+			// If eta is negative, negate it and replace f, g with g, -f
+			if(eta < 0) {
+				uint64_t tmp;
+				eta = -eta;
+
+				tmp = f;
+				f = g;
+				g = 0 - tmp;
+
+				tmp = u;
+				u = q;
+				q = 0 - tmp;
+
+				tmp = v;
+				v = r;
+				r = 0 - tmp;
+
+				// Cancel up to 6 bits of g, but no more than i or eta + 1
+				limit = ((int)eta + 1) > i ? i : ((int)eta + 1);
+				m = (UINT64_MAX >> (64 - limit)) & 63U;
+				w = (uint32_t)((f * g * (f * f - 2)) & m);
+			} else {
+				// Cancel up to 4 bits of g
+				limit = ((int)eta + 1) > i ? i : ((int)eta + 1);
+				m = (UINT64_MAX >> (64 - limit)) & 15U;
+				w = (uint32_t)(f + (((f + 1) & 4) << 1));
+				w = (uint32_t)((0 - (uint64_t)w * g) & m);
+			}
+
+			g += f * w;
+			q += u * w;
+			r += v * w;
+		}
+
+		t.u = (int64_t)u;
+		t.v = (int64_t)v;
+		t.q = (int64_t)q;
+		t.r = (int64_t)r;
+
+		return eta;
+	}
+
+	/**
+	 Computes (t / 2^62) * [d, e] mod modulus. A multiple of the modulus is added
+	 first so that the low 62 bits vanish and the division is exact.
+	 */
+	void updateDE(signed62 &d, signed62 &e, const trans2x2 &t, const modInfo &info)
+	{
+		const int64_t u = t.u;
+		const int64_t v = t.v;
+		const int64_t q = t.q;
+		const int64_t r = t.r;
+
+		// md, me start as zero, plus [u, q] if d is negative, plus [v, r] if e is negative
+		int64_t sd = d.v[4] >> 63;
+		int64_t se = e.v[4] >> 63;
+		int64_t md = (u & sd) + (v & se);
+		int64_t me = (q & sd) + (r & se);
+
+		int128_t cd = (int128_t)u * d.v[0] + (int128_t)v * e.v[0];
+		int128_t ce = (int128_t)q * d.v[0] + (int128_t)r * e.v[0];
+
+		// Choose md, me so that t * [d, e] + modulus * [md, me] has 62 zero bottom bits
+		md -= (int64_t)((info.modulusInv62 * (uint64_t)cd + (uint64_t)md) & M62);
+		me -= (int64_t)((info.modulusInv62 * (uint64_t)ce + (uint64_t)me) & M62);
+
+		cd += (int128_t)info.modulus.v[0] * md;
+		ce += (int128_t)info.modulus.v[0] * me;
+
+		cd >>= 62;
+		ce >>= 62;
+
+		for(int i = 1; i < 5; i++) {
+			cd += (int128_t)u * d.v[i] + (int128_t)v * e.v[i];
+			ce += (int128_t)q * d.v[i] + (int128_t)r * e.v[i];
+
+			// Skip the zero limbs of sparse moduli
+			if(info.modulus.v[i]) {
+				cd += (int128_t)info.modulus.v[i] * md;
+				ce += (int128_t)info.modulus.v[i] * me;
+			}
+
+			d.v[i - 1] = (int64_t)((uint64_t)cd & M62);
+			e.v[i - 1] = (int64_t)((uint64_t)ce & M62);
+
+			cd >>= 62;
+			ce >>= 62;
+		}
+
+		d.v[4] = (int64_t)cd;
+		e.v[4] = (int64_t)ce;
+	}
+
+	// Computes (t / 2^62) * [f, g] over the lowest len limbs
+	void updateFG(int len, signed62 &f, signed62 &g, const trans2x2 &t)
+	{
+		const int64_t u = t.u;
+		const int64_t v = t.v;
+		const int64_t q = t.q;
+		const int64_t r = t.r;
+
+		int128_t cf = (int128_t)u * f.v[0] + (int128_t)v * g.v[0];
+		int128_t cg = (int128_t)q * f.v[0] + (int128_t)r * g.v[0];
+
+		cf >>= 62;
+		cg >>= 62;
+
+		for(int i = 1; i < len; i++) {
+			int64_t fi = f.v[i];
+			int64_t gi = g.v[i];
+
+			cf += (int128_t)u * fi + (int128_t)v * gi;
+			cg += (int128_t)q * fi + (int128_t)r * gi;
+
+			f.v[i - 1] = (int64_t)((uint64_t)cf & M62);
+			g.v[i - 1] = (int64_t)((uint64_t)cg & M62);
+
+			cf >>= 62;
+			cg >>= 62;
+		}
+
+		f.v[len - 1] = (int64_t)cf;
+		g.v[len - 1] = (int64_t)cg;
+	}
+
+	/**
+	 Brings r from (-2 * modulus, modulus) into [0, modulus), negating it first
+	 when sign is negative
+	 */
+	void normalize(signed62 &r, int64_t sign, const modInfo &info)
+	{
+		const int64_t m62 = (int64_t)M62;
+
+		int64_t condAdd = r.v[4] >> 63;
+		for(int i = 0; i < 5; i++) {
+			r.v[i] += info.modulus.v[i] & condAdd;
+		}
+
+		int64_t condNegate = sign >> 63;
+		for(int i = 0; i < 5; i++) {
+			r.v[i] = (r.v[i] ^ condNegate) - condNegate;
+		}
+
+		for(int i = 0; i < 4; i++) {
+			r.v[i + 1] += r.v[i] >> 62;
+			r.v[i] &= m62;
+		}
+
+		condAdd = r.v[4] >> 63;
+		for(int i = 0; i < 5; i++) {
+			r.v[i] += info.modulus.v[i] & condAdd;
+		}
+
+		for(int i = 0; i < 4; i++) {
+			r.v[i + 1] += r.v[i] >> 62;
+			r.v[i] &= m62;
+		}
+	}
+
+	uint256 invMod(const uint256 &x, const modInfo &info)
+	{
+		// d = 0, e = 1, f = modulus, g = x, eta = -1 (delta = 1)
+		signed62 d = { { 0, 0, 0, 0, 0 } };
+		signed62 e = { { 1, 0, 0, 0, 0 } };
+		signed62 f = info.modulus;
+		signed62 g = toSigned62(x);
+		int len = 5;
+		int64_t eta = -1;
+
+		for(;;) {
+			trans2x2 t;
+
+			eta = divsteps62(eta, (uint64_t)f.v[0], (uint64_t)g.v[0], t);
+
+			updateDE(d, e, t, info);
+
+			updateFG(len, f, g, t);
+
+			// Done when g is zero
+			if(g.v[0] == 0) {
+				int64_t cond = 0;
+
+				for(int j = 1; j < len; j++) {
+					cond |= g.v[j];
+				}
+
+				if(cond == 0) {
+					break;
+				}
+			}
+
+			// If the top limbs of f and g are both 0 or -1, drop a limb
+			int64_t fn = f.v[len - 1];
+			int64_t gn = g.v[len - 1];
+
+			int64_t cond = ((int64_t)len - 2) >> 63;
+			cond |= fn ^ (fn >> 63);
+			cond |= gn ^ (gn >> 63);
+
+			if(cond == 0) {
+				f.v[len - 2] = (int64_t)((uint64_t)f.v[len - 2] | (uint64_t)fn << 62);
+				g.v[len - 2] = (int64_t)((uint64_t)g.v[len - 2] | (uint64_t)gn << 62);
+				len--;
+			}
+		}
+
+		// f is now +/- 1, the sign of the result follows it
+		normalize(d, f.v[len - 1], info);
+
+		return fromSigned62(d);
+	}
+}
+
+uint256 secp256k1::invModP(const uint256 &x)
+{
+	return invMod(x, _P_INFO);
+}
+
+uint256 secp256k1::invModN(const uint256 &x)
+{
+	return invMod(x, _N_INFO);
+}
+
+#else
+
+/**
+ Compilers without 128-bit integers invert with Fermat's little theorem,
+ x^(m - 2) mod m, using the 64-bit-limb field arithmetic
+ */
+
+uint256 secp256k1::invModP(const uint256 &x)
+{
+	uint256 e = P - uint256(2);
+	uint256 r(1);
+
+	for(int i = 255; i >= 0; i--) {
+		r = sqrModP(r);
+
+		if(e.bit(i)) {
+			r = multiplyModP(r, x);
+		}
+	}
+
+	return r;
+}
+
+uint256 secp256k1::invModN(const uint256 &x)
+{
+	uint256 e = N - uint256(2);
+	uint256 r(1);
+
+	for(int i = 255; i >= 0; i--) {
+		r = multiplyModN(r, r);
+
+		if(e.bit(i)) {
+			r = multiplyModN(r, x);
+		}
+	}
+
+	return r;
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include"CryptoUtil.h"
 
 #include "secp256k1.h"
+#include "field.h"
 
 
 using namespace secp256k1;
@@ -31,22 +32,6 @@ static inline void subc(unsigned int a, unsigned int b, unsigned int borrowIn, u
 
 
 
-static bool lessThanEqualTo(const unsigned int *a, const unsigned int *b, int len)
-{
-	for(int i = len - 1; i >= 0; i--) {
-		if(a[i] < b[i]) {
-			// is greater than
-			return true;
-		} else if(a[i] > b[i]) {
-			// is less than
-			return false;
-		}
-	}
-
-	// is equal
-	return true;
-}
-
 static bool greaterThanEqualTo(const unsigned int *a, const unsigned int *b, int len)
 {
 	for(int i = len - 1; i >= 0; i--) {
@@ -276,39 +261,6 @@ uint256 uint256::sub(const uint256 &val) const
     return result;
 }
 
-static bool isOne(const uint256 &x)
-{
-	if(x.v[0] != 1) {
-		return false;
-	}
-
-	for(int i = 1; i < 8; i++) {
-		if(x.v[i] != 0) {
-			return false;
-		}
-	}
-
-	return true;
-}
-
-static uint256 divBy2(const uint256 &x)
-{
-	uint256 r;
-
-	for(int i = 0; i < 7; i++) {
-		r.v[i] = (x.v[i] >> 1) | (x.v[i + 1] << 31);
-	}
-	r.v[7] = x.v[7] >> 1;
-
-	return r;
-}
-
-
-static bool isEven(const uint256 &x)
-{
-	return (x.v[0] & 1) == 0;
-}
-
 ecpoint secp256k1::pointAtInfinity()
 {
 	uint256 x(_POINT_AT_INFINITY_WORDS);
@@ -324,131 +276,16 @@ ecpoint secp256k1::G()
 	return ecpoint(x, y);
 }
 
-uint256 secp256k1::invModP(const uint256 &x)
-{
-	uint256 u = x;
-	uint256 v = P;
-	uint256 x1 = _ONE;
-	uint256 x2 = _ZERO;
-
-	// Signed part of the 256-bit words
-	int x1Signed = 0;
-	int x2Signed = 0;
-
-	while(!isOne(u) && !isOne(v)) {
-
-		while(isEven(u)) {
-
-			u = divBy2(u);
-
-			if(isEven(x1)) {
-				x1 = divBy2(x1);
-
-				// Shift right (signed bit is preserved)
-				x1.v[7] |= ((unsigned int)x1Signed & 0x01) << 31;
-
-				x1Signed >>= 1;
-			} else {
-				int carry = add(x1.v, P.v, x1.v, 8);
-
-				x1 = divBy2(x1);
-
-				x1Signed += carry;
-
-				x1.v[7] |= ((unsigned int)x1Signed & 0x01) << 31;
-
-				x1Signed >>= 1;
-			}
-
-		}
-
-		while(isEven(v)) {
-
-			v = divBy2(v);
-
-			if(isEven(x2)) {
-
-				x2 = divBy2(x2);
-
-				x2.v[7] |= ((unsigned int)x2Signed & 0x01) << 31;
-
-				x2Signed >>= 1;
-			} else {
-				int carry = add(x2.v, P.v, x2.v, 8);
-
-				x2 = divBy2(x2);
-
-				x2Signed += carry;
-
-				x2.v[7] |= ((unsigned int)x2Signed & 0x01) << 31;
-
-				x2Signed >>= 1;
-			}
-		}
-
-		if(lessThanEqualTo(v.v, u.v, 8)) {
-			sub(u.v, v.v, u.v, 8);
-
-			// x1 = x1 - x2
-			int borrow = sub(x1.v, x2.v, x1.v, 8);
-			x1Signed -= x2Signed;
-			x1Signed -= borrow;
-		} else {
-			sub(v.v, u.v, v.v, 8);
-			int borrow = sub(x2.v, x1.v, x2.v, 8);
-			x2Signed -= x1Signed;
-			x2Signed -= borrow;
-		}
-	}
-
-	uint256 output;
-
-	if(isOne(u)) {
-	
-		while(x1Signed < 0) {
-			x1Signed += add(x1.v, P.v, x1.v, 8);
-		}
-	
-		while(x1Signed > 0) {
-			x1Signed -= sub(x1.v, P.v, x1.v, 8);
-		}
-	
-		for(int i = 0; i < 8; i++) {
-			output.v[i] = x1.v[i];
-		}
-	
-	} else {
-	
-		while(x2Signed < 0) {
-			x2Signed += add(x2.v, P.v, x2.v,  8);
-		}
-	
-		while(x2Signed > 0) {
-			x2Signed -= sub(x2.v, P.v, x2.v, 8);
-		}
-	
-		for(int i = 0; i < 8; i++) {
-			output.v[i] = x2.v[i];
-		}
-	}
-
-	return output;
-}
-
-
-
 uint256 secp256k1::addModP(const uint256 &a, const uint256 &b)
 {
-	uint256 sum;
-
-	int overflow = add(a.v, b.v, sum.v, 8);
+	fe x;
+	fe y;
 
-	// mod P
-	if(overflow || greaterThanEqualTo(sum.v, P.v, 8)) {
-		sub(sum.v, P.v, sum.v, 8);
-	}
+	feFromUint256(x, a);
+	feFromUint256(y, b);
+	feAdd(x, x, y);
 
-	return sum;
+	return feToUint256(x);
 }
 
 uint256 secp256k1::addModN(const uint256 &a, const uint256 &b)
@@ -478,13 +315,14 @@ uint256 secp256k1::subModN(const uint256 &a, const uint256 &b)
 
 uint256 secp256k1::subModP(const uint256 &a, const uint256 &b)
 {
-	uint256 diff;
+	fe x;
+	fe y;
 
-	if(sub(a.v, b.v, diff.v, 8)) {
-		add(diff.v, P.v, diff.v, 8);
-	}
+	feFromUint256(x, a);
+	feFromUint256(y, b);
+	feSub(x, x, y);
 
-	return diff;
+	return feToUint256(x);
 }
 
 
@@ -499,60 +337,58 @@ uint256 secp256k1::negModN(const uint256 &x)
 	return subModN(N, x);
 }
 
-uint256 secp256k1::multiplyModP(const uint256 &a, const uint256 &b)
+uint256 secp256k1::endomorphismKey(const uint256 &k, int image)
 {
-	unsigned int product[16];
-
-	multiply(a.v, 8, b.v, 8, product);
+	uint256 r = k;
 
-	unsigned int tmp[10] = { 0 };
-	unsigned int tmp2[10] = { 0 };
-	unsigned int s = 977;
-
-	//multiply by high 8 words by 2^32 + 977
-	for(int i = 0; i < 8; i++) {
-		tmp2[1 + i] = product[8 + i];
+	for(int i = 0; i < image / 2; i++) {
+		r = multiplyModN(r, LAMBDA);
 	}
 
-	multiply(&s, 1, &product[8], 8, &tmp[0]);
-	add(tmp, tmp2, tmp, 10);
-
-	// clear top 8 words of product
-	for(int i = 8; i < 16; i++) {
-		product[i] = 0;
+	if(image & 1) {
+		r = negModN(r);
 	}
 
-	//add to product
-	add(&product[0], tmp, &product[0], 10);
+	return r;
+}
+
+ecpoint secp256k1::endomorphismPoint(const ecpoint &p, int image)
+{
+	ecpoint r = p;
 
+	for(int i = 0; i < image / 2; i++) {
+		r.x = multiplyModP(r.x, BETA);
+	}
 
-	//multiply high 2 words by 2^32 + 977
-	for(int i = 0; i < 8; i++) {
-		tmp2[1 + i] = product[8 + i];
+	if(image & 1) {
+		r.y = negModP(r.y);
 	}
-	//multiply(&s, 1, &product[8], 2, &tmp[1]);
-	multiply(&s, 1, &product[8], 8, &tmp[0]);
-	add(tmp, tmp2, tmp, 10);
 
+	return r;
+}
 
+uint256 secp256k1::multiplyModP(const uint256 &a, const uint256 &b)
+{
+	fe x;
+	fe y;
 
-	// add to low 8 words
-	int overflow = add(&product[0], &tmp[0], &product[0], 8);
+	feFromUint256(x, a);
+	feFromUint256(y, b);
+	feMul(x, x, y);
 
-	if(overflow || greaterThanEqualTo(&product[0], P.v, 8)) {
-		sub(&product[0], P.v, &product[0], 8);
-	}
+	return feToUint256(x);
+}
 
-	uint256 result;
+uint256 secp256k1::sqrModP(const uint256 &a)
+{
+	fe x;
 
-	for(int i = 0; i < 8; i++) {
-		result.v[i] = product[i];
-	}
+	feFromUint256(x, a);
+	feSqr(x, x);
 
-	return result;
+	return feToUint256(x);
 }
 
-
 static void reduceModN(const unsigned int *x, unsigned int *r)
 {
 	unsigned int barrettN[] = { 0x2fc9bec0, 0x402da173, 0x50b75fc4, 0x45512319, 0x00000001, 0x00000000, 0x00000000, 0x00000000, 00000001 };
@@ -657,22 +493,40 @@ bool secp256k1::isPointAtInfinity(const ecpoint &p)
 
 ecpoint secp256k1::doublePoint(const ecpoint &p)
 {
+	fe px;
+	fe py;
+
+	feFromUint256(px, p.x);
+	feFromUint256(py, p.y);
+
 	// 1 / 2y
-	uint256 yInv = invModP(addModP(p.y, p.y));
+	fe yInv;
+	feAdd(yInv, py, py);
+	feInv(yInv, yInv);
 
 	// s = 3x^2 / 2y
-	uint256 x3 = multiplyModP(p.x, p.x);
-	uint256 s = multiplyModP(addModP(addModP(x3, x3), x3), yInv);
+	fe x2;
+	fe s;
+	feSqr(x2, px);
+	feAdd(s, x2, x2);
+	feAdd(s, s, x2);
+	feMul(s, s, yInv);
 
 	//rx = s^2 - 2x
-	uint256 rx = subModP(subModP(multiplyModP(s, s), p.x), p.x);
+	fe rx;
+	feSqr(rx, s);
+	feSub(rx, rx, px);
+	feSub(rx, rx, px);
 
 	//ry = s * (px - rx) - py
-	uint256 ry = subModP(multiplyModP(s, subModP(p.x, rx)), p.y);
+	fe ry;
+	feSub(ry, px, rx);
+	feMul(ry, s, ry);
+	feSub(ry, ry, py);
 
 	ecpoint result;
-	result.x = rx;
-	result.y = ry;
+	result.x = feToUint256(rx);
+	result.y = feToUint256(ry);
 
 	return result;
 }
@@ -695,38 +549,40 @@ ecpoint secp256k1::addPoints(const ecpoint &p1, const ecpoint &p2)
 		return p1;
 	}
 
-	uint256 rise = subModP(p1.y, p2.y);
-	uint256 run = subModP(p1.x, p2.x);
+	fe px;
+	fe py;
+	fe qx;
+	fe qy;
+
+	feFromUint256(px, p1.x);
+	feFromUint256(py, p1.y);
+	feFromUint256(qx, p2.x);
+	feFromUint256(qy, p2.y);
 
-	uint256 s = multiplyModP(rise, invModP(run));
+	fe rise;
+	fe run;
+	feSub(rise, py, qy);
+	feSub(run, px, qx);
+
+	fe s;
+	feInv(run, run);
+	feMul(s, rise, run);
 
 	//rx = (s*s - px - qx) % _p;
-	uint256 rx = subModP(subModP(multiplyModP(s, s), p1.x), p2.x);
+	fe rx;
+	feSqr(rx, s);
+	feSub(rx, rx, px);
+	feSub(rx, rx, qx);
 
 	//ry = (s * (px - rx) - py) % _p;
-	uint256 ry = subModP(multiplyModP(s, subModP(p1.x, rx)), p1.y);
+	fe ry;
+	feSub(ry, px, rx);
+	feMul(ry, s, ry);
+	feSub(ry, ry, py);
 
 	ecpoint sum;
-	sum.x = rx;
-	sum.y = ry;
-
-	return sum;
-}
-
-ecpoint secp256k1::multiplyPoint(const uint256 &k, const ecpoint &p)
-{
-	ecpoint sum = pointAtInfinity();
-	ecpoint d = p;
-
-	for(int i = 0; i < 256; i++) {
-		unsigned int mask = 1 << (i % 32);
-
-		if(k.v[i / 32] & mask) {
-			sum = addPoints(sum, d);
-		}
-
-		d = doublePoint(d);
-	}
+	sum.x = feToUint256(rx);
+	sum.y = feToUint256(ry);
 
 	return sum;
 }
@@ -742,44 +598,34 @@ uint256 generatePrivateKey()
 	return k;
 }
 
-bool secp256k1::pointExists(const ecpoint &p)
+static bool pointExists(const fe &x, const fe &y)
 {
-	uint256 y = multiplyModP(p.y, p.y);
+	fe y2;
+	fe x3;
+	fe seven;
+
+	feSqr(y2, y);
 
-	uint256 x = addModP(multiplyModP(multiplyModP(p.x, p.x), p.x), uint256(7));
+	feSqr(x3, x);
+	feMul(x3, x3, x);
+	feSetInt(seven, 7);
+	feAdd(x3, x3, seven);
 
-	return y == x;
+	return feEqual(y2, x3);
 }
 
-static void bulkInversionModP(std::vector<uint256> &in)
+bool secp256k1::pointExists(const ecpoint &p)
 {
+	fe x;
+	fe y;
 
-	std::vector<uint256> products;
-	uint256 total(1);
-
-	for(unsigned int i = 0; i < in.size(); i++) {
-		total = secp256k1::multiplyModP(total, in[i]);
-
-		products.push_back(total);
-	}
-
-	// Do the inversion
+	feFromUint256(x, p.x);
+	feFromUint256(y, p.y);
 
-	uint256 inverse = secp256k1::invModP(total);
-
-	for(int i = (int)in.size() - 1; i >= 0; i--) {
-
-		if(i > 0) {
-			uint256 newValue = secp256k1::multiplyModP(products[i - 1], inverse);
-			inverse = multiplyModP(inverse, in[i]);
-			in[i] = newValue;
-		} else {
-			in[i] = inverse;
-		}
-	}
+	return ::pointExists(x, y);
 }
 
-void secp256k1::generateKeyPairsBulk(unsigned int count, const ecpoint &basePoint, std::vector<uint256> &privKeysOut, std::vector<ecpoint> &pubKeysOut)
+void secp256k1::generateKeyPairsBulk(unsigned int count, const ecpoint &basePoint, std::vector<uint256> &privKeysOut, std::vector<ecpoint> &pubKeysOut, int threads, bool validate)
 {
 	privKeysOut.clear();
 
@@ -787,87 +633,7 @@ void secp256k1::generateKeyPairsBulk(unsigned int count, const ecpoint &basePoin
 		privKeysOut.push_back(generatePrivateKey());
 	}
 
-	generateKeyPairsBulk(basePoint, privKeysOut, pubKeysOut);
-}
-
-void secp256k1::generateKeyPairsBulk(const ecpoint &basePoint, std::vector<uint256> &privKeys, std::vector<ecpoint> &pubKeysOut)
-{
-	unsigned int count = (unsigned int)privKeys.size();
-
-	//privKeysOut.clear();
-	pubKeysOut.clear();
-
-	// generate a table of points G, 2G, 4G, 8G...(2^255)G
-	std::vector<ecpoint> table;
-
-	table.push_back(basePoint);
-	for(int i = 1; i < 256; i++) {
-
-		ecpoint p = doublePoint(table[i-1]);
-		if(!pointExists(p)) {
-			throw std::string("Point does not exist!");
-		}
-		table.push_back(p);
-	}
-
-	for(unsigned int i = 0; i < count; i++) {
-		pubKeysOut.push_back(ecpoint());
-	}
-
-	for(int i = 0; i < 256; i++) {
-
-		std::vector<uint256> runList;
-
-		// calculate (Px - Qx)
-		for(unsigned int j = 0; j < count; j++) {
-			uint256 run;
-			uint256 k = privKeys[j];
-
-			if(k.bit(i)) {
-				if(isPointAtInfinity(pubKeysOut[j])) {
-					run = uint256(2);
-				} else {
-					run = subModP(pubKeysOut[j].x, table[i].x);
-				}
-			} else {
-				run = uint256(2);
-			}
-
-			runList.push_back(run);
-		}
-
-		// calculate 1/(Px - Qx)
-		bulkInversionModP(runList);
-
-		// complete the addition
-		for(unsigned int j = 0; j < count; j++) {
-			uint256 rise;
-			uint256 k = privKeys[j];
-
-			if(k.bit(i)) {
-				if(isPointAtInfinity(pubKeysOut[j])) {
-					pubKeysOut[j] = table[i];
-				} else {
-					rise = subModP(pubKeysOut[j].y, table[i].y);
-
-					// s = (Py - Qy)/(Px - Qx)
-					uint256 s = multiplyModP(rise, runList[j]);
-
-					//rx = (s*s - px - qx) % _p;
-					uint256 rx = subModP(subModP(multiplyModP(s, s), pubKeysOut[j].x), table[i].x);
-
-					//ry = (s * (px - rx) - py) % _p;
-					uint256 ry = subModP(multiplyModP(s, subModP(pubKeysOut[j].x, rx)), pubKeysOut[j].y);
-
-					ecpoint r(rx, ry);
-					if(!pointExists(r)) {
-						throw std::string("Point does not exist");
-					}
-					pubKeysOut[j] = r;
-				}
-			}
-		}
-	}
+	generateKeyPairsBulk(basePoint, privKeysOut, pubKeysOut, threads, validate);
 }
 
 /**
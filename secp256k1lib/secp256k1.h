@@ -345,25 +345,47 @@ namespace secp256k1 {
 	uint256 addModP(const uint256 &a, const uint256 &b);
 	uint256 subModP(const uint256 &a, const uint256 &b);
 	uint256 multiplyModP(const uint256 &a, const uint256&b);
+	uint256 sqrModP(const uint256 &a);
 	uint256 multiplyModN(const uint256 &a, const uint256 &b);
 
 	ecpoint addPoints(const ecpoint &p, const ecpoint &q);
 	ecpoint doublePoint(const ecpoint &p);
 
 	uint256 invModP(const uint256 &x);
+	uint256 invModN(const uint256 &x);
 
 	bool isPointAtInfinity(const ecpoint &p);
 	ecpoint multiplyPoint(const uint256 &k, const ecpoint &p);
 
+	// k * G using the cached fixed-base table, with a single inversion
+	ecpoint multiplyG(const uint256 &k);
+
+	// k[i] * G for every key, split across threads (0 for all cores) with one inversion per thread
+	void multiplyGBatch(const std::vector<uint256> &k, std::vector<ecpoint> &pointsOut, int threads = 0);
+
+	// Sum of k[i] * p[i], splitting each scalar with the endomorphism and sharing the doublings
+	ecpoint multiplyPoints(const std::vector<uint256> &k, const std::vector<ecpoint> &p);
+
 	uint256 addModN(const uint256 &a, const uint256 &b);
 	uint256 subModN(const uint256 &a, const uint256 &b);
 
+	// Number of keys sharing the work of one point under the endomorphism and negation
+	const int ENDOMORPHISM_IMAGES = 6;
+
+	// Image i of the key k: LAMBDA^(i / 2) * k, negated when i is odd
+	uint256 endomorphismKey(const uint256 &k, int image);
+
+	// Image i of the point p = k * G: (BETA^(i / 2) * x, y), with y negated when i is odd
+	ecpoint endomorphismPoint(const ecpoint &p, int image);
+
 	uint256 generatePrivateKey();
 
 	bool pointExists(const ecpoint &p);
 
-	void generateKeyPairsBulk(unsigned int count, const ecpoint &basePoint, std::vector<uint256> &privKeysOut, std::vector<ecpoint> &pubKeysOut);
-	void generateKeyPairsBulk(const ecpoint &basePoint, std::vector<uint256> &privKeys, std::vector<ecpoint> &pubKeysOut);
+	// basePoint * k for every key using a cached fixed-base table, split across threads
+	// (0 for all cores). validate checks that every result is on the curve
+	void generateKeyPairsBulk(unsigned int count, const ecpoint &basePoint, std::vector<uint256> &privKeysOut, std::vector<ecpoint> &pubKeysOut, int threads = 0, bool validate = false);
+	void generateKeyPairsBulk(const ecpoint &basePoint, std::vector<uint256> &privKeys, std::vector<ecpoint> &pubKeysOut, int threads = 0, bool validate = false);
 
 	ecpoint parsePublicKey(const std::string &pubKeyString);
 }
@@ -29,7 +29,8 @@ BitrecoverEngine::~BitrecoverEngine() {
     stop();
 }
 
-bool BitrecoverEngine::initialize(const std::string& configFile) {
+bool BitrecoverEngine::initialize(const std::string& configFile,
+                                  const std::vector<std::pair<std::string, std::string>>& overrides) {
     if (initialized_) {
         Logger::log(LogLevel::Warning, "Engine already initialized");
         return true;
@@ -39,6 +40,15 @@ bool BitrecoverEngine::initialize(const std::string& configFile) {
     if (!loadConfiguration(configFile)) {
         Logger::log(LogLevel::Warning, "Using default configuration");
     }
+
+    for (const auto& option : overrides) {
+        try {
+            configManager_->setValue(option.first, option.second);
+        } catch (const std::exception&) {
+            Logger::log(LogLevel::Error, "Invalid value '" + option.second + "' for " + option.first);
+            return false;
+        }
+    }
     
     config_ = configManager_->getConfig();
     
@@ -58,6 +68,7 @@ bool BitrecoverEngine::initialize(const std::string& configFile) {
     if (!gpuManager_->initializeAllGPUs(
             config_.search.targetsFile,
             config_.gpu,
+            config_.cpu,
             config_.search)) {
         Logger::log(LogLevel::Error, "Failed to initialize GPUs");
         return false;
@@ -106,6 +117,10 @@ bool BitrecoverEngine::gatherSystemInfo() {
             gpuInfo.cudaMinor = dev.cudaMinor;
             if (dev.type == DeviceManager::DeviceType::CUDA) {
                 gpuInfo.type = "CUDA";
+            } else if (dev.type == DeviceManager::DeviceType::CPU) {
+                gpuInfo.type = "CPU";
+                gpuInfo.cudaMajor = 0;
+                gpuInfo.cudaMinor = 0;
             } else {
                 gpuInfo.type = "OpenCL";
                 gpuInfo.cudaMajor = 0;
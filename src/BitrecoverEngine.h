@@ -4,6 +4,8 @@
 #include "bitrecover/types.h"
 #include <string>
 #include <memory>
+#include <utility>
+#include <vector>
 
 class ConfigManager;
 class MultiGPUManager;
@@ -15,7 +17,9 @@ public:
     BitrecoverEngine();
     ~BitrecoverEngine();
 
-    bool initialize(const std::string& configFile);
+    // overrides are config file keys and values that take precedence over the file
+    bool initialize(const std::string& configFile,
+                    const std::vector<std::pair<std::string, std::string>>& overrides = {});
     int run();
     void stop();
 
@@ -27,12 +27,32 @@ ConfigManager::ConfigManager() {
     config_.gpu.threadsPerBlock = bitrecover::DEFAULT_THREADS_PER_BLOCK;
     config_.gpu.blocks = bitrecover::DEFAULT_BLOCKS;
     config_.gpu.pointsPerThread = bitrecover::DEFAULT_POINTS_PER_THREAD;
+
+    config_.cpu.enabled = bitrecover::DEFAULT_USE_CPU;
+    config_.cpu.threads = bitrecover::DEFAULT_CPU_THREADS;
+    config_.cpu.pointsPerThread = bitrecover::DEFAULT_CPU_POINTS_PER_THREAD;
     
     config_.search.targetsFile = bitrecover::DEFAULT_TARGETS_FILE;
     config_.search.outputFile = bitrecover::DEFAULT_OUTPUT_FILE;
     config_.search.compression = bitrecover::DEFAULT_COMPRESSION;
     config_.search.random256 = bitrecover::DEFAULT_RANDOM256;
+    config_.search.endomorphism = bitrecover::DEFAULT_ENDOMORPHISM;
+    config_.search.centreOut = bitrecover::DEFAULT_CENTRE_OUT;
+    config_.search.jumpIntervalMs = bitrecover::DEFAULT_JUMP_INTERVAL_MS;
+    config_.search.keyspace = bitrecover::DEFAULT_KEYSPACE;
+    config_.search.stride = bitrecover::DEFAULT_STRIDE;
+    config_.search.nodeIndex = bitrecover::DEFAULT_NODE_INDEX;
+    config_.search.nodeCount = bitrecover::DEFAULT_NODE_COUNT;
+    config_.search.targetFilter = bitrecover::DEFAULT_TARGET_FILTER;
+    config_.search.targetsReloadIntervalMs = bitrecover::DEFAULT_TARGETS_RELOAD_INTERVAL_MS;
+    config_.search.filterFalsePositiveRate = bitrecover::DEFAULT_FILTER_FALSE_POSITIVE_RATE;
+    config_.search.verifyThreads = bitrecover::DEFAULT_VERIFY_THREADS;
     config_.search.statusIntervalMs = bitrecover::DEFAULT_UPDATE_INTERVAL_MS;
+    config_.search.checkpointFile = bitrecover::DEFAULT_CHECKPOINT_FILE;
+    config_.search.checkpointIntervalMs = bitrecover::DEFAULT_CHECKPOINT_INTERVAL_MS;
+    config_.search.checkpointPoints = bitrecover::DEFAULT_CHECKPOINT_POINTS;
+    config_.search.coverageFile = bitrecover::DEFAULT_COVERAGE_FILE;
+    config_.search.coverageIntervalMs = bitrecover::DEFAULT_COVERAGE_INTERVAL_MS;
     
     config_.display.realTime = bitrecover::DEFAULT_REAL_TIME;
     config_.display.updateIntervalMs = bitrecover::DEFAULT_UPDATE_INTERVAL_MS;
@@ -95,12 +115,30 @@ void ConfigManager::parseConfigKey(const std::string& key, const std::string& va
         config_.email.username = value;
     } else if (key.find("password") != std::string::npos && key.find("email") != std::string::npos) {
         config_.email.password = value;
+    } else if (key.find("use_cpu") != std::string::npos) {
+        config_.cpu.enabled = (value == "true" || value == "1");
+    } else if (key.find("cpu_threads") != std::string::npos) {
+        config_.cpu.threads = std::stoi(value);
+    } else if (key.find("cpu_points_per_thread") != std::string::npos) {
+        config_.cpu.pointsPerThread = std::stoi(value);
     } else if (key.find("use_all_gpus") != std::string::npos) {
         config_.gpu.useAllGPUs = (value == "true" || value == "1");
     } else if (key.find("threads_per_block") != std::string::npos) {
         config_.gpu.threadsPerBlock = std::stoi(value);
     } else if (key.find("points_per_thread") != std::string::npos) {
         config_.gpu.pointsPerThread = std::stoi(value);
+    } else if (key.find("coverage_file") != std::string::npos) {
+        config_.search.coverageFile = value;
+    } else if (key.find("coverage_interval_ms") != std::string::npos) {
+        config_.search.coverageIntervalMs = std::stoi(value);
+    } else if (key.find("checkpoint_file") != std::string::npos) {
+        config_.search.checkpointFile = value;
+    } else if (key.find("checkpoint_interval_ms") != std::string::npos) {
+        config_.search.checkpointIntervalMs = std::stoi(value);
+    } else if (key.find("checkpoint_points") != std::string::npos) {
+        config_.search.checkpointPoints = (value == "true" || value == "1");
+    } else if (key.find("targets_reload_interval_ms") != std::string::npos) {
+        config_.search.targetsReloadIntervalMs = std::stoi(value);
     } else if (key.find("targets_file") != std::string::npos) {
         config_.search.targetsFile = value;
     } else if (key.find("output_file") != std::string::npos) {
@@ -109,9 +147,33 @@ void ConfigManager::parseConfigKey(const std::string& key, const std::string& va
         config_.search.compression = value;
     } else if (key.find("random256") != std::string::npos) {
         config_.search.random256 = (value == "true" || value == "1");
+    } else if (key.find("endomorphism") != std::string::npos) {
+        config_.search.endomorphism = (value == "true" || value == "1");
+    } else if (key.find("centre_out") != std::string::npos) {
+        config_.search.centreOut = (value == "true" || value == "1");
+    } else if (key.find("jump_interval_ms") != std::string::npos) {
+        config_.search.jumpIntervalMs = std::stoi(value);
+    } else if (key.find("keyspace") != std::string::npos) {
+        config_.search.keyspace = value;
+    } else if (key.find("stride") != std::string::npos) {
+        config_.search.stride = value;
+    } else if (key.find("node_index") != std::string::npos) {
+        config_.search.nodeIndex = std::stoi(value);
+    } else if (key.find("node_count") != std::string::npos) {
+        config_.search.nodeCount = std::stoi(value);
+    } else if (key.find("target_filter") != std::string::npos) {
+        config_.search.targetFilter = value;
+    } else if (key.find("filter_false_positive_rate") != std::string::npos) {
+        config_.search.filterFalsePositiveRate = std::stod(value);
+    } else if (key.find("verify_threads") != std::string::npos) {
+        config_.search.verifyThreads = std::stoi(value);
     }
 }
 
+void ConfigManager::setValue(const std::string& key, const std::string& value) {
+    parseConfigKey(key, value);
+}
+
 bitrecover::Config ConfigManager::getConfig() const {
     return config_;
 }
@@ -10,6 +10,8 @@ public:
     ~ConfigManager() = default;
 
     bool loadFromFile(const std::string& filename);
+    // Sets one value by its config file key, e.g. from the command line
+    void setValue(const std::string& key, const std::string& value);
     bitrecover::Config getConfig() const;
     void setConfig(const bitrecover::Config& config);
     std::string getHostname() const;
@@ -1,9 +1,12 @@
 #include "MultiGPUManager.h"
+#include "bitrecover/constants.h"
 #ifdef WE_HAVE_OPENCL
 #include "CLKeySearchDevice.h"
 #endif
+#include "CpuKeySearchDevice.h"
 #include "RandomKeyGenerator.h"
 #include "Logger.h"
+#include "util.h"
 #include "AddressUtil.h"
 #include "KeySearchTypes.h"
 #include <fstream>
@@ -35,6 +38,28 @@ static void staticStatusCallback(KeySearchStatus status) {
     }
 }
 
+// Parses "start:end" in hex. Both keys are searched, end is returned one past the last key
+static bool parseKeyspace(const std::string& keyspace, secp256k1::uint256& start, secp256k1::uint256& end) {
+    size_t pos = keyspace.find(':');
+    if (pos == std::string::npos) {
+        return false;
+    }
+
+    try {
+        start = secp256k1::uint256(keyspace.substr(0, pos));
+        end = secp256k1::uint256(keyspace.substr(pos + 1));
+    } catch (const std::string&) {
+        return false;
+    }
+
+    if (start.isZero() || end.cmp(start) < 0 || end.cmp(secp256k1::N) >= 0) {
+        return false;
+    }
+
+    end = end + 1;
+    return true;
+}
+
 MultiGPUManager::MultiGPUManager() {
 }
 
@@ -44,6 +69,7 @@ MultiGPUManager::~MultiGPUManager() {
 
 bool MultiGPUManager::initializeAllGPUs(const std::string& targetsFile,
                                        const bitrecover::Config::GPUConfig& gpuConfig,
+                                       const bitrecover::Config::CPUConfig& cpuConfig,
                                        const bitrecover::Config::SearchConfig& searchConfig) {
     try {
         std::vector<DeviceManager::DeviceInfo> devices = DeviceManager::getDevices();
@@ -65,43 +91,99 @@ bool MultiGPUManager::initializeAllGPUs(const std::string& targetsFile,
             }
         }
         
+        // The CPU device shares the host with the GPU workers, each of which keeps a core busy
+        int gpuWorkerCount = 0;
+        for (const auto& dev : selectedDevices) {
+            if (dev.type != DeviceManager::DeviceType::CPU) {
+                gpuWorkerCount++;
+            }
+        }
+
+        if (!cpuConfig.enabled) {
+            selectedDevices.erase(std::remove_if(selectedDevices.begin(), selectedDevices.end(),
+                [](const DeviceManager::DeviceInfo& dev) { return dev.type == DeviceManager::DeviceType::CPU; }),
+                selectedDevices.end());
+        }
+
         if (selectedDevices.empty()) {
             Logger::log(LogLevel::Error, "No valid GPU devices selected");
             return false;
         }
         
-        // Load targets as vector of strings (addresses)
-        std::vector<std::string> targetAddresses;
-        Logger::log(LogLevel::Info, "Opening targets file: " + targetsFile);
-        std::ifstream file(targetsFile);
-        if (file.is_open()) {
-            std::string line;
-            int lineCount = 0;
-            while (std::getline(file, line)) {
-                lineCount++;
-                // Remove whitespace
-                line.erase(0, line.find_first_not_of(" \t\r\n"));
-                if (!line.empty() && line.find_last_not_of(" \t\r\n") != std::string::npos) {
-                    line.erase(line.find_last_not_of(" \t\r\n") + 1);
-                }
-                
-                if (!line.empty()) {
-                    targetAddresses.push_back(line);
-                }
-            }
-            file.close();
-            Logger::log(LogLevel::Info, "Read " + std::to_string(lineCount) + " lines, found " + 
-                        std::to_string(targetAddresses.size()) + " addresses");
-        } else {
-            Logger::log(LogLevel::Error, "Could not open targets file: " + targetsFile);
+        // Decode the targets once. Every worker shares this set, so a target found
+        // on one device is removed from all of them
+        TargetSet targets;
+
+        try {
+            KeyFinder::loadTargets(targetsFile, targets);
+        } catch (const KeySearchException& e) {
+            Logger::log(LogLevel::Error, e.msg);
             return false;
         }
-        
-        if (targetAddresses.empty()) {
-            Logger::log(LogLevel::Error, "No target addresses loaded from file: " + targetsFile);
+
+        // A configured keyspace is split between the devices in work units
+        bool ranged = !searchConfig.keyspace.empty();
+        secp256k1::uint256 rangeStart;
+        secp256k1::uint256 rangeEnd;
+        if (ranged && !parseKeyspace(searchConfig.keyspace, rangeStart, rangeEnd)) {
+            Logger::log(LogLevel::Error, "Invalid keyspace '" + searchConfig.keyspace + "', expected start:end in hex");
             return false;
         }
-        
+
+        secp256k1::uint256 stride(1);
+        try {
+            stride = secp256k1::uint256(searchConfig.stride);
+        } catch (const std::string&) {
+            stride = secp256k1::uint256(0);
+        }
+        if (stride.isZero() || stride.cmp(secp256k1::N) >= 0) {
+            Logger::log(LogLevel::Error, "Invalid stride '" + searchConfig.stride + "'");
+            return false;
+        }
+
+        // Each node searches its own part of the keyspace, worked out from the same
+        // settings on every node so no coordinator is needed
+        if (searchConfig.nodeCount < 1 || searchConfig.nodeIndex < 0 || searchConfig.nodeIndex >= searchConfig.nodeCount) {
+            Logger::log(LogLevel::Error, "Node index must be from 0 to the node count - 1");
+            return false;
+        }
+
+        if (ranged) {
+            KeyspaceScheduler::partition(rangeStart, rangeEnd, stride, searchConfig.nodeIndex, searchConfig.nodeCount, rangeStart, rangeEnd);
+
+            if (rangeEnd.cmp(rangeStart) <= 0) {
+                Logger::log(LogLevel::Error, "Node " + std::to_string(searchConfig.nodeIndex) + " has no keys to search");
+                return false;
+            }
+        } else if (searchConfig.nodeCount > 1) {
+            Logger::log(LogLevel::Warning, "The node count only applies to a keyspace, ignoring it");
+        }
+
+        // The extra keys tested by the endomorphism are outside any sequential range
+        bool endomorphism = searchConfig.endomorphism && searchConfig.random256 && !ranged;
+        if (searchConfig.endomorphism && !endomorphism) {
+            Logger::log(LogLevel::Warning, "Endomorphism mode requires random256 and no keyspace, disabling it");
+        }
+
+        int targetFilter = TargetFilterType::AUTO;
+        if (searchConfig.targetFilter == "bloom") {
+            targetFilter = TargetFilterType::BLOOM;
+        } else if (searchConfig.targetFilter == "fuse8") {
+            targetFilter = TargetFilterType::FUSE8;
+        } else if (searchConfig.targetFilter == "fuse16") {
+            targetFilter = TargetFilterType::FUSE16;
+        } else if (searchConfig.targetFilter == "fuse32") {
+            targetFilter = TargetFilterType::FUSE32;
+        } else if (searchConfig.targetFilter != "auto") {
+            Logger::log(LogLevel::Warning, "Unknown target filter '" + searchConfig.targetFilter + "', choosing automatically");
+        }
+
+        double falsePositiveRate = searchConfig.filterFalsePositiveRate;
+        if (falsePositiveRate < 0.0 || falsePositiveRate >= 0.01) {
+            Logger::log(LogLevel::Warning, "Filter false positive rate must be below 0.01, using the device default");
+            falsePositiveRate = 0.0;
+        }
+
         // Initialize workers
         RandomKeyGenerator rng;
         for (size_t i = 0; i < selectedDevices.size(); ++i) {
@@ -123,11 +205,17 @@ bool MultiGPUManager::initializeAllGPUs(const std::string& targetsFile,
                 worker.device = new CudaKeySearchDevice(deviceInfo.id, threads, pointsPerThread, blocks);
             } else if (deviceInfo.type == DeviceManager::DeviceType::OpenCL) {
 #ifdef WE_HAVE_OPENCL
-                worker.device = new CLKeySearchDevice(deviceInfo.id, threads, pointsPerThread, blocks);
+                worker.device = new CLKeySearchDevice(deviceInfo.id, threads, pointsPerThread, blocks, endomorphism, searchConfig.centreOut);
 #else
                 Logger::log(LogLevel::Warning, "OpenCL support not compiled. Skipping device " + std::to_string(deviceInfo.id));
                 continue;
 #endif
+            } else if (deviceInfo.type == DeviceManager::DeviceType::CPU) {
+                int cpuThreads = cpuConfig.threads;
+                if (cpuThreads <= 0) {
+                    cpuThreads = std::max(1, util::getCpuCount() - gpuWorkerCount);
+                }
+                worker.device = new CpuKeySearchDevice(cpuThreads, cpuConfig.pointsPerThread, endomorphism, searchConfig.centreOut);
             } else {
                 Logger::log(LogLevel::Warning, "Unknown device type");
                 continue;
@@ -138,7 +226,6 @@ bool MultiGPUManager::initializeAllGPUs(const std::string& targetsFile,
             unsigned int maxWords[8] = {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 
                                         0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF};
             secp256k1::uint256 endKey(maxWords, secp256k1::uint256::LittleEndian);
-            secp256k1::uint256 stride(1);
             
             int compression = 0; // UNCOMPRESSED
             if (searchConfig.compression == "COMPRESSED") {
@@ -147,16 +234,119 @@ bool MultiGPUManager::initializeAllGPUs(const std::string& targetsFile,
                 compression = 2;
             }
             
+            worker.device->setTargetFilter(targetFilter);
+            worker.device->setFalsePositiveRate(falsePositiveRate);
+            worker.device->setVerifyThreads(searchConfig.verifyThreads);
             worker.finder = new KeyFinder(startKey, endKey, compression, worker.device, stride);
-            worker.finder->setTargets(targetAddresses);
+            worker.finder->setTargets(targets);
             
             workers_.push_back(std::move(worker));
             
             Logger::log(LogLevel::Info, 
                 "Initialized GPU " + std::to_string(deviceInfo.id) + ": " + deviceInfo.name);
         }
-        
-        return !workers_.empty();
+
+        if (workers_.empty()) {
+            return false;
+        }
+
+        if (ranged) {
+            std::vector<uint64_t> keysPerStep;
+            for (auto& worker : workers_) {
+                keysPerStep.push_back(worker.device->keysPerStep());
+            }
+
+            scheduler_.reset(new KeyspaceScheduler(rangeStart, rangeEnd, stride, keysPerStep));
+
+            for (size_t i = 0; i < workers_.size(); ++i) {
+                workers_[i].finder->setScheduler(scheduler_.get(), static_cast<int>(i));
+            }
+
+            Logger::log(LogLevel::Info, "Node " + std::to_string(searchConfig.nodeIndex) + " of " + std::to_string(searchConfig.nodeCount)
+                + ": searching keys " + rangeStart.toString() + " to " + (rangeEnd - secp256k1::uint256(1)).toString()
+                + ", stride " + stride.toString());
+        }
+
+        // Random starts sample more of the keyspace by jumping to new keys now and then
+        if (!ranged && searchConfig.random256 && searchConfig.jumpIntervalMs > 0) {
+            for (auto& worker : workers_) {
+                worker.finder->setJumpInterval(searchConfig.jumpIntervalMs);
+            }
+        }
+
+        // Carry on from the progress saved by an earlier run of the same search
+        if (!searchConfig.checkpointFile.empty()) {
+            std::string search = ranged ? "keyspace " + rangeStart.toString() + " " + rangeEnd.toString() : std::string("random");
+            search += " stride " + stride.toString() + " " + searchConfig.compression;
+
+            journal_.reset(new CheckpointJournal());
+
+            try {
+                journal_->open(searchConfig.checkpointFile, search);
+            } catch (const KeySearchException& e) {
+                Logger::log(LogLevel::Error, e.msg);
+                journal_.reset();
+                return false;
+            }
+
+            if (ranged) {
+                std::vector<CheckpointJournal::Range> completed = journal_->getCompleted();
+                for (size_t i = 0; i < completed.size(); ++i) {
+                    scheduler_->exclude(completed[i].begin, completed[i].end);
+                }
+
+                if (!completed.empty()) {
+                    Logger::log(LogLevel::Info, scheduler_->remaining().toString() + " (hex) keys left to search");
+                }
+            }
+
+            int interval = searchConfig.checkpointIntervalMs > 0 ? searchConfig.checkpointIntervalMs : bitrecover::DEFAULT_CHECKPOINT_INTERVAL_MS;
+
+            for (size_t i = 0; i < workers_.size(); ++i) {
+                workers_[i].finder->setCheckpoint(journal_.get(), static_cast<int>(i), interval, searchConfig.checkpointPoints);
+            }
+        }
+
+        // Skip the keys any run sharing the coverage index has already searched
+        if (!searchConfig.coverageFile.empty()) {
+            coverage_.reset(new CoverageIndex());
+
+            try {
+                coverage_->open(searchConfig.coverageFile);
+            } catch (const KeySearchException& e) {
+                Logger::log(LogLevel::Error, e.msg);
+                coverage_.reset();
+                return false;
+            }
+
+            if (ranged) {
+                std::vector<CoverageIndex::Range> covered = coverage_->getRanges(rangeStart, stride);
+                for (size_t i = 0; i < covered.size(); ++i) {
+                    scheduler_->exclude(covered[i].start, covered[i].end);
+                }
+
+                Logger::log(LogLevel::Info, coverage_->countCovered(rangeStart, rangeEnd, stride).toString()
+                    + " (hex) keys already searched, " + scheduler_->remaining().toString() + " (hex) keys left to search");
+            }
+
+            int interval = searchConfig.coverageIntervalMs > 0 ? searchConfig.coverageIntervalMs : bitrecover::DEFAULT_COVERAGE_INTERVAL_MS;
+
+            for (auto& worker : workers_) {
+                worker.finder->setCoverage(coverage_.get(), interval);
+            }
+        }
+
+        if (searchConfig.targetsReloadIntervalMs > 0) {
+            targetWatcher_.start(targetsFile, targets, searchConfig.targetsReloadIntervalMs,
+                [this](const TargetSet& newTargets) {
+                    // Each device builds its lookup here and swaps it in after its current step
+                    for (auto& worker : workers_) {
+                        worker.finder->reloadTargets(newTargets);
+                    }
+                });
+        }
+
+        return true;
     } catch (const std::exception& e) {
         Logger::log(LogLevel::Error, "Failed to initialize GPUs: " + std::string(e.what()));
         return false;
@@ -238,6 +428,17 @@ void MultiGPUManager::handleStatus(const KeySearchStatus& status, int workerInde
     w.stats.speedMKeysPerSec = w.speedMKeysPerSec;
     w.stats.isRunning = w.running;
     w.stats.utilizationPercent = 95.0;
+
+    // Measured filter false positive rate and how fast the host checks the hits
+    const KeySearchVerifierStats& v = status.verifier;
+    if (v.hashes > 0) {
+        w.stats.status = "Filter FPR: " + util::format("%.2e", (double)v.falsePositives / (double)v.hashes)
+            + " (" + util::formatThousands(v.falsePositives) + " false positives)";
+
+        if (v.time > 0) {
+            w.stats.status += ", verifying " + util::formatThousands((uint64_t)((double)v.candidates * 1.0e6 / (double)v.time)) + " candidates/s";
+        }
+    }
     
     if (statusCallback_) {
         statusCallback_(w.stats);
@@ -246,6 +447,9 @@ void MultiGPUManager::handleStatus(const KeySearchStatus& status, int workerInde
 
 void MultiGPUManager::stopAll() {
     stopRequested_ = true;
+
+    // The watcher calls into the finders, stop it before they are deleted
+    targetWatcher_.stop();
     
     for (auto& worker : workers_) {
         if (worker.finder) {
@@ -269,6 +473,12 @@ void MultiGPUManager::stopAll() {
     }
     
     workers_.clear();
+
+    scheduler_.reset();
+
+    // The finders write a last checkpoint and add their last keys to the coverage when they stop
+    journal_.reset();
+    coverage_.reset();
 }
 
 bool MultiGPUManager::isAnyRunning() const {
@@ -302,6 +512,8 @@ std::string MultiGPUManager::getDeviceTypeName(const DeviceManager::DeviceInfo&
         return "CUDA";
     } else if (device.type == DeviceManager::DeviceType::OpenCL) {
         return "OpenCL";
+    } else if (device.type == DeviceManager::DeviceType::CPU) {
+        return "CPU";
     }
     return "Unknown";
 }
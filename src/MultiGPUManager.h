@@ -7,6 +7,10 @@
 #include "KeyFinder.h"
 #include "DeviceManager.h"
 #include "CudaKeySearchDevice.h"
+#include "TargetWatcher.h"
+#include "KeyspaceScheduler.h"
+#include "CheckpointJournal.h"
+#include "CoverageIndex.h"
 #include <vector>
 #include <thread>
 #include <atomic>
@@ -22,6 +26,7 @@ public:
 
     bool initializeAllGPUs(const std::string& targetsFile,
                           const bitrecover::Config::GPUConfig& gpuConfig,
+                          const bitrecover::Config::CPUConfig& cpuConfig,
                           const bitrecover::Config::SearchConfig& searchConfig);
     
     void startParallelSearch(const bitrecover::Config::SearchConfig& config);
@@ -86,6 +91,18 @@ private:
     std::function<void(const bitrecover::GPUStats&)> statusCallback_;
     mutable std::mutex statsMutex_;
     std::atomic<bool> stopRequested_{false};
+
+    // Reloads the targets file into the running workers when it changes
+    TargetWatcher targetWatcher_;
+
+    // Splits a configured keyspace between the workers, null for random starts
+    std::unique_ptr<KeyspaceScheduler> scheduler_;
+
+    // Progress of the search, null without a checkpoint file
+    std::unique_ptr<CheckpointJournal> journal_;
+
+    // Keys searched by this and earlier runs, null without a coverage file
+    std::unique_ptr<CoverageIndex> coverage_;
     
     void workerThread(int workerIndex);
     std::string getDeviceTypeName(const DeviceManager::DeviceInfo& device);
@@ -14,6 +14,11 @@ void printUsage() {
     std::cout << "  --targets FILE         Target addresses file (default: address.txt)\n";
     std::cout << "  --output FILE          Output file for matches (default: Success.txt)\n";
     std::cout << "  --random256            Use random 256-bit keys (pre-2012 wallets)\n";
+    std::cout << "  --keyspace START:END   Search the keys START to END (hex) once, then exit\n";
+    std::cout << "  --stride N             Distance between keys in the keyspace (hex, default: 1)\n";
+    std::cout << "  --node-index I         Search part I of the keyspace, from 0 (default: 0)\n";
+    std::cout << "  --node-count N         Number of machines sharing the keyspace (default: 1)\n";
+    std::cout << "  --coverage FILE        Skip the keys in this coverage index and add the keys searched\n";
     std::cout << "  --gpu ID               Use specific GPU ID (can specify multiple)\n";
     std::cout << "  --all-gpus             Use all available GPUs (default)\n";
     std::cout << "  --list-devices         List available GPU devices\n";
@@ -23,6 +28,8 @@ void printUsage() {
     std::cout << "  bitrecover --config config/config.json\n";
     std::cout << "  bitrecover --targets address.txt --output Success.txt --random256\n";
     std::cout << "  bitrecover --gpu 0 --gpu 1  # Use GPUs 0 and 1\n";
+    std::cout << "  bitrecover --keyspace 20000000000000000:3ffffffffffffffff --node-index 1 --node-count 4\n";
+    std::cout << "  bitrecover --keyspace 20000000000000000:3ffffffffffffffff --coverage coverage.txt\n";
     std::cout << "\n";
 }
 
@@ -42,6 +49,8 @@ void listDevices() {
                 typeStr = "CUDA";
             } else if (dev.type == DeviceManager::DeviceType::OpenCL) {
                 typeStr = "OpenCL";
+            } else if (dev.type == DeviceManager::DeviceType::CPU) {
+                typeStr = "CPU";
             }
             std::cout << "  Type: " << typeStr << "\n";
             std::cout << "  Memory: " << (dev.memory / (1024 * 1024)) << " MB\n";
@@ -60,6 +69,11 @@ int main(int argc, char** argv) {
     parser.add("", "--targets", true);
     parser.add("", "--output", true);
     parser.add("", "--random256", false);
+    parser.add("", "--keyspace", true);
+    parser.add("", "--stride", true);
+    parser.add("", "--node-index", true);
+    parser.add("", "--node-count", true);
+    parser.add("", "--coverage", true);
     parser.add("", "--gpu", true);
     parser.add("", "--all-gpus", false);
     parser.add("", "--list-devices", false);
@@ -102,8 +116,24 @@ int main(int argc, char** argv) {
         }
     }
     
+    // Command line options that replace config file settings
+    std::vector<std::pair<std::string, std::string>> overrides;
+    for (const auto& arg : args) {
+        if (arg.equals("", "--keyspace")) {
+            overrides.push_back({"keyspace", arg.arg});
+        } else if (arg.equals("", "--stride")) {
+            overrides.push_back({"stride", arg.arg});
+        } else if (arg.equals("", "--node-index")) {
+            overrides.push_back({"node_index", arg.arg});
+        } else if (arg.equals("", "--node-count")) {
+            overrides.push_back({"node_count", arg.arg});
+        } else if (arg.equals("", "--coverage")) {
+            overrides.push_back({"coverage_file", arg.arg});
+        }
+    }
+    
     // Initialize engine
-    if (!engine.initialize(configFile)) {
+    if (!engine.initialize(configFile, overrides)) {
         std::cerr << "Failed to initialize Bitrecover engine" << std::endl;
         return 1;
     }
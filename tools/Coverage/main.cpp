@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "util.h"
+#include "CmdParse.h"
+#include "KeySearchDevice.h"
+#include "KeyspaceScheduler.h"
+#include "CoverageIndex.h"
+
+using namespace secp256k1;
+
+static void usage()
+{
+    std::cout << "Usage: coverage merge OUTPUT INDEX..." << std::endl;
+    std::cout << "       coverage report INDEX [--keyspace START:END] [--stride N]" << std::endl;
+    std::cout << "merge    Combines the coverage indexes of several machines into OUTPUT" << std::endl;
+    std::cout << "report   Shows the ranges in an index, and how much of the keyspace START to END (hex)" << std::endl;
+    std::cout << "         with the distance N (hex, default: 1) between keys has been searched" << std::endl;
+}
+
+static double toDouble(const uint256 &x)
+{
+    double d = 0.0;
+
+    for(int i = 7; i >= 0; i--) {
+        d = d * 4294967296.0 + (double)x.v[i];
+    }
+
+    return d;
+}
+
+static bool open(CoverageIndex &index, const std::string &fileName)
+{
+    try {
+        index.open(fileName);
+    } catch(KeySearchException ex) {
+        std::cout << ex.msg << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static int merge(const std::vector<std::string> &operands)
+{
+    if(operands.size() < 3) {
+        usage();
+        return 1;
+    }
+
+    CoverageIndex merged;
+
+    for(size_t i = 2; i < operands.size(); i++) {
+        CoverageIndex index;
+
+        if(!open(index, operands[i])) {
+            return 1;
+        }
+
+        merged.merge(index);
+    }
+
+    if(!merged.saveAs(operands[1])) {
+        std::cout << "Could not write '" << operands[1] << "'" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Merged " << (operands.size() - 2) << " indexes into '" << operands[1] << "', "
+        << util::formatThousands(merged.getRanges().size()) << " ranges" << std::endl;
+
+    return 0;
+}
+
+static int report(const std::vector<std::string> &operands, const std::string &keyspace, const std::string &strideText)
+{
+    if(operands.size() != 2) {
+        usage();
+        return 1;
+    }
+
+    CoverageIndex index;
+
+    if(!open(index, operands[1])) {
+        return 1;
+    }
+
+    std::vector<CoverageIndex::Range> ranges = index.getRanges();
+
+    std::cout << util::formatThousands(ranges.size()) << " ranges in '" << operands[1] << "'" << std::endl;
+
+    for(size_t i = 0; i < ranges.size(); i++) {
+        const CoverageIndex::Range &r = ranges[i];
+        uint256 keys = KeyspaceScheduler::divide(r.end - r.start, r.stride);
+
+        std::cout << r.start.toString() << " " << r.end.toString() << " stride " << r.stride.toString()
+            << " (" << keys.toString() << " keys)" << std::endl;
+    }
+
+    if(keyspace.empty()) {
+        return 0;
+    }
+
+    uint256 start;
+    uint256 end;
+    uint256 stride;
+
+    size_t pos = keyspace.find(':');
+
+    try {
+        if(pos == std::string::npos) {
+            throw std::string("no ':'");
+        }
+
+        start = uint256(keyspace.substr(0, pos));
+        end = uint256(keyspace.substr(pos + 1)) + uint256(1);
+        stride = uint256(strideText);
+    } catch(std::string) {
+        std::cout << "Invalid keyspace '" << keyspace << "' or stride '" << strideText << "'" << std::endl;
+        return 1;
+    }
+
+    if(end.cmp(start) <= 0 || stride.isZero()) {
+        std::cout << "Invalid keyspace '" << keyspace << "' or stride '" << strideText << "'" << std::endl;
+        return 1;
+    }
+
+    uint256 total = KeyspaceScheduler::divide(end - start + stride - uint256(1), stride);
+    uint256 covered = index.countCovered(start, end, stride);
+
+    char percent[32];
+    snprintf(percent, sizeof(percent), "%.6f", toDouble(covered) / toDouble(total) * 100.0);
+
+    std::cout << "Searched " << covered.toString() << " of " << total.toString() << " keys (" << percent << "%)" << std::endl;
+
+    uint256 next = index.nextUncovered(start, stride);
+
+    if(next.cmp(end) < 0) {
+        std::cout << "Next key to search: " << next.toString() << std::endl;
+    } else {
+        std::cout << "The whole keyspace has been searched" << std::endl;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    CmdParse parser;
+
+    parser.add("-h", "--help", false);
+    parser.add("", "--keyspace", true);
+    parser.add("", "--stride", true);
+
+    try {
+        parser.parse(argc, argv);
+    } catch(std::string err) {
+        std::cout << "Error: " << err << std::endl;
+        return 1;
+    }
+
+    std::vector<OptArg> args = parser.getArgs();
+
+    std::string keyspace;
+    std::string stride = "1";
+
+    for(unsigned int i = 0; i < args.size(); i++) {
+        if(args[i].equals("-h", "--help")) {
+            usage();
+            return 0;
+        } else if(args[i].equals("", "--keyspace")) {
+            keyspace = args[i].arg;
+        } else if(args[i].equals("", "--stride")) {
+            stride = args[i].arg;
+        }
+    }
+
+    std::vector<std::string> operands = parser.getOperands();
+
+    if(operands.size() > 0 && operands[0] == "merge") {
+        return merge(operands);
+    }
+
+    if(operands.size() > 0 && operands[0] == "report") {
+        return report(operands, keyspace, stride);
+    }
+
+    usage();
+    return 1;
+}
@@ -0,0 +1,74 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "util.h"
+#include "CmdParse.h"
+#include "KeySearchDevice.h"
+#include "TargetDatabase.h"
+#include "TargetFileParser.h"
+
+static void usage()
+{
+    std::cout << "Usage: targetdb ADDRESS_FILE DATABASE_FILE" << std::endl;
+    std::cout << "Converts a file of addresses, one per line, to a precompiled target database" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    CmdParse parser;
+
+    parser.add("-h", "--help", false);
+
+    try {
+        parser.parse(argc, argv);
+    } catch(std::string err) {
+        std::cout << "Error: " << err << std::endl;
+        return 1;
+    }
+
+    std::vector<OptArg> args = parser.getArgs();
+
+    for(unsigned int i = 0; i < args.size(); i++) {
+        if(args[i].equals("-h", "--help")) {
+            usage();
+            return 0;
+        }
+    }
+
+    std::vector<std::string> operands = parser.getOperands();
+
+    if(operands.size() != 2) {
+        usage();
+        return 1;
+    }
+
+    std::vector<KeySearchTarget> targets;
+    std::vector<TargetFileParser::Error> errors;
+
+    try {
+        TargetFileParser::parse(operands[0], targets, errors);
+    } catch(KeySearchException ex) {
+        std::cout << ex.msg << std::endl;
+        return 1;
+    }
+
+    for(size_t i = 0; i < errors.size(); i++) {
+        std::cout << "Line " << errors[i].line << ": invalid address '" << errors[i].text << "'" << std::endl;
+    }
+
+    try {
+        TargetDatabase::write(operands[1], targets);
+    } catch(KeySearchException ex) {
+        std::cout << ex.msg << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << util::formatThousands(targets.size()) << " targets to '" << operands[1] << "'";
+    if(errors.size() > 0) {
+        std::cout << ", skipped " << util::formatThousands(errors.size()) << " invalid lines";
+    }
+    std::cout << std::endl;
+
+    return errors.size() > 0 ? 2 : 0;
+}
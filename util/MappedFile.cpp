@@ -0,0 +1,205 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace util {
+
+    MappedFile::MappedFile()
+    {
+        _data = NULL;
+        _size = 0;
+        _file = NULL;
+        _mapping = NULL;
+        _writable = false;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    bool MappedFile::open(const std::string &fileName)
+    {
+        close();
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if(file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        _file = file;
+
+        LARGE_INTEGER size;
+        if(!GetFileSizeEx(file, &size)) {
+            close();
+            return false;
+        }
+        _size = (size_t)size.QuadPart;
+
+        if(_size > 0) {
+            HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if(mapping == NULL) {
+                close();
+                return false;
+            }
+            _mapping = mapping;
+
+            _data = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if(_data == NULL) {
+                close();
+                return false;
+            }
+        }
+#else
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if(fd < 0) {
+            return false;
+        }
+
+        struct stat st;
+        if(fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        _size = (size_t)st.st_size;
+
+        if(_size > 0) {
+            void *ptr = mmap(NULL, _size, PROT_READ, MAP_SHARED, fd, 0);
+
+            if(ptr == MAP_FAILED) {
+                ::close(fd);
+                _size = 0;
+                return false;
+            }
+
+            _data = (const uint8_t *)ptr;
+        }
+
+        // The mapping stays valid after the descriptor is closed
+        ::close(fd);
+#endif
+
+        return true;
+    }
+
+    bool MappedFile::create(const std::string &fileName, size_t size)
+    {
+        close();
+
+        if(size == 0) {
+            return false;
+        }
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if(file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        _file = file;
+
+        LARGE_INTEGER length;
+        length.QuadPart = (LONGLONG)size;
+
+        // Sets the file size when the mapping is created
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, length.HighPart, length.LowPart, NULL);
+        if(mapping == NULL) {
+            close();
+            return false;
+        }
+        _mapping = mapping;
+
+        _data = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+        if(_data == NULL) {
+            close();
+            return false;
+        }
+#else
+        int fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0) {
+            return false;
+        }
+
+        if(ftruncate(fd, (off_t)size) != 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        ::close(fd);
+
+        if(ptr == MAP_FAILED) {
+            return false;
+        }
+
+        _data = (const uint8_t *)ptr;
+#endif
+
+        _size = size;
+        _writable = true;
+
+        return true;
+    }
+
+    bool MappedFile::flush()
+    {
+        if(!_writable) {
+            return true;
+        }
+
+#ifdef _WIN32
+        return FlushViewOfFile(_data, 0) && FlushFileBuffers((HANDLE)_file);
+#else
+        return msync((void *)_data, _size, MS_SYNC) == 0;
+#endif
+    }
+
+    void MappedFile::close()
+    {
+#ifdef _WIN32
+        if(_data != NULL) {
+            UnmapViewOfFile(_data);
+        }
+
+        if(_mapping != NULL) {
+            CloseHandle((HANDLE)_mapping);
+        }
+
+        if(_file != NULL) {
+            CloseHandle((HANDLE)_file);
+        }
+#else
+        if(_data != NULL) {
+            munmap((void *)_data, _size);
+        }
+#endif
+
+        _data = NULL;
+        _size = 0;
+        _file = NULL;
+        _mapping = NULL;
+        _writable = false;
+    }
+
+    const uint8_t *MappedFile::data() const
+    {
+        return _data;
+    }
+
+    size_t MappedFile::size() const
+    {
+        return _size;
+    }
+
+    uint8_t *MappedFile::writable() const
+    {
+        return _writable ? (uint8_t *)_data : NULL;
+    }
+}
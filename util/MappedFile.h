@@ -0,0 +1,59 @@
+#ifndef _MAPPED_FILE_H
+#define _MAPPED_FILE_H
+
+#include <stdint.h>
+#include <string>
+
+namespace util {
+
+/**
+ Memory mapping of a whole file. The pages are shared with any other process
+ that maps the same file. open() maps an existing file read-only, create()
+ makes a new file of a given size that can be written through writable().
+ */
+class MappedFile {
+
+private:
+    const uint8_t *_data;
+
+    size_t _size;
+
+    bool _writable;
+
+    // Platform handles for the mapping
+    void *_file;
+
+    void *_mapping;
+
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+public:
+    MappedFile();
+
+    ~MappedFile();
+
+    // Returns false if the file cannot be opened or mapped. An empty file maps to
+    // size() == 0 and data() == NULL
+    bool open(const std::string &fileName);
+
+    // Creates or truncates fileName to size bytes and maps it for writing. Returns false
+    // on failure
+    bool create(const std::string &fileName, size_t size);
+
+    // Writes the changed pages to disk. Returns false on failure
+    bool flush();
+
+    void close();
+
+    const uint8_t *data() const;
+
+    size_t size() const;
+
+    // NULL unless the file was opened with create()
+    uint8_t *writable() const;
+};
+
+}
+
+#endif
@@ -0,0 +1,123 @@
+#include "ThreadPool.h"
+
+namespace util {
+
+    ThreadPool::ThreadPool(int numThreads)
+    {
+        _job = NULL;
+        _jobCount = 0;
+        _nextIndex = 0;
+        _pending = 0;
+        _generation = 0;
+        _shutdown = false;
+
+        if(numThreads <= 0) {
+            numThreads = (int)std::thread::hardware_concurrency();
+        }
+
+        if(numThreads <= 0) {
+            numThreads = 1;
+        }
+
+        // The calling thread also executes tasks, so it counts as one of the workers
+        for(int i = 1; i < numThreads; i++) {
+            _threads.push_back(std::thread(&ThreadPool::workerLoop, this));
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _shutdown = true;
+        }
+        _workAvailable.notify_all();
+
+        for(size_t i = 0; i < _threads.size(); i++) {
+            _threads[i].join();
+        }
+    }
+
+    int ThreadPool::size() const
+    {
+        return (int)_threads.size() + 1;
+    }
+
+    void ThreadPool::runTasks(std::unique_lock<std::mutex> &lock)
+    {
+        while(_nextIndex < _jobCount) {
+            int idx = _nextIndex++;
+            const std::function<void(int)> *job = _job;
+
+            lock.unlock();
+            std::exception_ptr err;
+            try {
+                (*job)(idx);
+            } catch(...) {
+                err = std::current_exception();
+            }
+            lock.lock();
+
+            if(err && !_error) {
+                _error = err;
+            }
+
+            if(--_pending == 0) {
+                _workDone.notify_all();
+            }
+        }
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        uint64_t seen = 0;
+
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        while(true) {
+            _workAvailable.wait(lock, [&] { return _shutdown || _generation != seen; });
+
+            if(_shutdown) {
+                return;
+            }
+
+            seen = _generation;
+
+            runTasks(lock);
+        }
+    }
+
+    void ThreadPool::parallelFor(int count, const std::function<void(int)> &fn)
+    {
+        if(count <= 0) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        _job = &fn;
+        _jobCount = count;
+        _nextIndex = 0;
+        _pending = count;
+        _error = nullptr;
+        _generation++;
+
+        _workAvailable.notify_all();
+
+        runTasks(lock);
+
+        _workDone.wait(lock, [&] { return _pending == 0; });
+
+        _job = NULL;
+        _jobCount = 0;
+
+        std::exception_ptr err = _error;
+        _error = nullptr;
+
+        lock.unlock();
+
+        if(err) {
+            std::rethrow_exception(err);
+        }
+    }
+}
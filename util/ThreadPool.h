@@ -0,0 +1,62 @@
+#ifndef _THREAD_POOL_H
+#define _THREAD_POOL_H
+
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+namespace util {
+
+/**
+ A fixed set of worker threads that execute parallel-for style jobs. The
+ threads are created once and reused for every job, so the pool can be
+ driven once per search step without paying thread creation costs.
+ */
+class ThreadPool {
+
+private:
+    std::vector<std::thread> _threads;
+
+    std::mutex _mutex;
+
+    std::condition_variable _workAvailable;
+
+    std::condition_variable _workDone;
+
+    const std::function<void(int)> *_job;
+
+    int _jobCount;
+
+    int _nextIndex;
+
+    int _pending;
+
+    uint64_t _generation;
+
+    bool _shutdown;
+
+    std::exception_ptr _error;
+
+    void workerLoop();
+
+    void runTasks(std::unique_lock<std::mutex> &lock);
+
+public:
+    ThreadPool(int numThreads = 0);
+
+    ~ThreadPool();
+
+    int size() const;
+
+    // Calls fn(i) for each i in [0, count) across the pool. Blocks until every
+    // call has returned. The first exception thrown by a task is re-thrown here.
+    void parallelFor(int count, const std::function<void(int)> &fn);
+};
+
+}
+
+#endif
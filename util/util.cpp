@@ -5,11 +5,13 @@
 #include<set>
 #include<algorithm>
 #include<cinttypes>
+#include<thread>
 
 #include"util.h"
 
 #ifdef _WIN32
 #include<windows.h>
+#include<io.h>
 #else
 #include<unistd.h>
 #include<sys/stat.h>
@@ -54,6 +56,39 @@ namespace util {
 #endif
     }
 
+    int getCpuCount()
+    {
+        int count = (int)std::thread::hardware_concurrency();
+
+        return count > 0 ? count : 1;
+    }
+
+    uint64_t getTotalSystemMemory()
+    {
+#ifdef _WIN32
+        MEMORYSTATUSEX status;
+        status.dwLength = sizeof(status);
+        GlobalMemoryStatusEx(&status);
+        return status.ullTotalPhys;
+#else
+        return (uint64_t)sysconf(_SC_PHYS_PAGES) * (uint64_t)sysconf(_SC_PAGE_SIZE);
+#endif
+    }
+
+    uint64_t getAvailableSystemMemory()
+    {
+#ifdef _WIN32
+        MEMORYSTATUSEX status;
+        status.dwLength = sizeof(status);
+        GlobalMemoryStatusEx(&status);
+        return status.ullAvailPhys;
+#elif defined(_SC_AVPHYS_PAGES)
+        return (uint64_t)sysconf(_SC_AVPHYS_PAGES) * (uint64_t)sysconf(_SC_PAGE_SIZE);
+#else
+        return getTotalSystemMemory();
+#endif
+    }
+
 	std::string formatThousands(uint64_t x)
 	{
 		char buf[32] = "";
@@ -218,6 +253,28 @@ namespace util {
 		return true;
 	}
 
+	bool syncFile(FILE *fp)
+	{
+		if(fflush(fp) != 0) {
+			return false;
+		}
+
+#ifdef _WIN32
+		return _commit(_fileno(fp)) == 0;
+#else
+		return fsync(fileno(fp)) == 0;
+#endif
+	}
+
+	bool replaceFile(const std::string &from, const std::string &to)
+	{
+#ifdef _WIN32
+		return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+		return rename(from.c_str(), to.c_str()) == 0;
+#endif
+	}
+
     std::string format(const char *formatStr, double value)
 	{
 		char buf[100] = { 0 };
@@ -294,6 +351,10 @@ namespace util {
         size_t left = s.find_first_not_of(c);
         size_t right = s.find_last_not_of(c);
 
+        if(left == std::string::npos) {
+            return "";
+        }
+
         return s.substr(left, right - left + 1);
     }
 }
\ No newline at end of file
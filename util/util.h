@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <stdint.h>
+#include <stdio.h>
 
 namespace util {
 
@@ -21,6 +22,10 @@ public:
 uint64_t getSystemTime();
 void sleep(int seconds);
 
+int getCpuCount();
+uint64_t getTotalSystemMemory();
+uint64_t getAvailableSystemMemory();
+
 std::string formatThousands(uint64_t x);
 std::string formatSeconds(unsigned int seconds);
 
@@ -28,6 +33,12 @@ uint32_t parseUInt32(std::string s);
 uint64_t parseUInt64(std::string s);
 bool isHex(const std::string &s);
 bool appendToFile(const std::string &fileName, const std::string &s);
+
+// Flushes fp and waits until the data is on disk
+bool syncFile(FILE *fp);
+
+// Renames from to to in one step, replacing to if it exists
+bool replaceFile(const std::string &from, const std::string &to);
 bool readLinesFromStream(std::istream &in, std::vector<std::string> &lines);
 bool readLinesFromStream(const std::string &fileName, std::vector<std::string> &lines);
 